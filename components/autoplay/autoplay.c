@@ -0,0 +1,381 @@
+/**
+ * Demo player. Moves are searched on a row bitboard: every placement of the
+ * current piece is dropped, locked in and scored, optionally along with every
+ * placement of the piece after it, and the bot then steers the real piece to
+ * the best one through the same moves a player would make.
+ */
+
+#include "autoplay.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// score for a piece that can't be placed at all, ie game over
+#define TOPPED_OUT (INT32_MIN / 16)
+
+/**
+ * One orientation of a piece, as row masks
+ */
+typedef struct autoplay_shape {
+  uint8_t rows[4];    // cells in each row, leftmost column in bit 0
+  int8_t row_offset;  // first row with cells, from the piece's loc.row
+  int8_t col_offset;  // first column with cells, from the piece's loc.col
+  uint8_t height;     // rows with cells
+  uint8_t width;      // columns with cells
+  bool duplicate;     // same cells as an earlier orientation
+} autoplay_shape;
+
+static autoplay_shape shapes[NUM_TETROMINOS][NUM_ORIENTATIONS];
+static bool shapes_built;
+
+static void build_shapes(void) {
+  for (int type = 0; type < NUM_TETROMINOS; type++) {
+    for (int o = 0; o < NUM_ORIENTATIONS; o++) {
+      const Coord *cells    = TETROMINOS[type][o];
+      autoplay_shape *shape = &shapes[type][o];
+      int min_row = cells[0].row, max_row = cells[0].row;
+      int min_col = cells[0].col, max_col = cells[0].col;
+      for (int i = 1; i < 4; i++) {
+        min_row = cells[i].row < min_row ? cells[i].row : min_row;
+        max_row = cells[i].row > max_row ? cells[i].row : max_row;
+        min_col = cells[i].col < min_col ? cells[i].col : min_col;
+        max_col = cells[i].col > max_col ? cells[i].col : max_col;
+      }
+
+      memset(shape, 0, sizeof(*shape));
+      shape->row_offset = min_row;
+      shape->col_offset = min_col;
+      shape->height     = max_row - min_row + 1;
+      shape->width      = max_col - min_col + 1;
+      for (int i = 0; i < 4; i++) {
+        shape->rows[cells[i].row - min_row] |= 1u << (cells[i].col - min_col);
+      }
+
+      // rotations that land the same cells in the same place aren't worth
+      //  searching twice
+      for (int prev = 0; prev < o && !shape->duplicate; prev++) {
+        const autoplay_shape *other = &shapes[type][prev];
+        shape->duplicate = other->row_offset == shape->row_offset &&
+                           other->col_offset == shape->col_offset &&
+                           memcmp(other->rows, shape->rows,
+                                  sizeof(shape->rows)) == 0;
+      }
+    }
+  }
+}
+
+/**
+ * Bitboard of the cells of `tb` that have settled. The library draws the
+ * falling piece into the board, so its cells are left out.
+ * @param falling - piece to leave out, NULL if there isn't one
+ */
+void autoplay_board_from_game(autoplay_board *out, const TetrisBoard *tb,
+                              const TetrisPiece *falling) {
+  for (int row = 0; row < TETRIS_ROWS; row++) {
+    uint8_t bits = 0;
+    for (int col = 0; col < TETRIS_COLS; col++) {
+      bits |= (tb->board[row][col] != BG_COLOR) << col;
+    }
+    out->rows[row] = bits;
+  }
+  if (falling != NULL) {
+    for (int i = 0; i < 4; i++) {
+      const Coord *cell =
+          &TETROMINOS[falling->ptype][falling->orientation][i];
+      int row = falling->loc.row + cell->row;
+      int col = falling->loc.col + cell->col;
+      if (row >= 0 && row < TETRIS_ROWS && col >= 0 && col < TETRIS_COLS) {
+        out->rows[row] &= ~(1u << col);
+      }
+    }
+  }
+}
+
+static bool shape_fits(const autoplay_board *board,
+                       const autoplay_shape *shape, int row, int col) {
+  int top   = row + shape->row_offset;
+  int shift = col + shape->col_offset;
+  if (top < 0 || top + shape->height > TETRIS_ROWS || shift < 0 ||
+      shift + shape->width > TETRIS_COLS) {
+    return false;
+  }
+  for (int r = 0; r < shape->height; r++) {
+    if (board->rows[top + r] & (shape->rows[r] << shift)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @returns true if the piece fits with its loc at `row`, `col`
+ */
+bool autoplay_fits(const autoplay_board *board, uint8_t ptype,
+                   uint8_t orientation, int row, int col) {
+  return shape_fits(board, &shapes[ptype][orientation], row, col);
+}
+
+// @returns first row with anything in it, TETRIS_ROWS if the board is empty
+static int stack_top(const autoplay_board *board) {
+  int row = 0;
+  while (row < TETRIS_ROWS && board->rows[row] == 0) {
+    row++;
+  }
+  return row;
+}
+
+// `top` is stack_top(board); everything above it is empty, so the piece can
+//  skip straight to just above it
+static int shape_drop(const autoplay_board *board,
+                      const autoplay_shape *shape, int row, int col, int top) {
+  int clear_row = top - shape->row_offset - shape->height;
+  row           = clear_row > row ? clear_row : row;
+  while (shape_fits(board, shape, row + 1, col)) {
+    row++;
+  }
+  return row;
+}
+
+/**
+ * @returns the row the piece comes to rest on falling straight down from
+ * `row`, which it has to fit at
+ */
+int autoplay_drop(const autoplay_board *board, uint8_t ptype,
+                  uint8_t orientation, int row, int col) {
+  return shape_drop(board, &shapes[ptype][orientation], row, col,
+                    stack_top(board));
+}
+
+static int shape_place(autoplay_board *board, const autoplay_shape *shape,
+                       int row, int col) {
+  int top      = row + shape->row_offset;
+  int shift    = col + shape->col_offset;
+  bool cleared = false;
+  for (int r = 0; r < shape->height; r++) {
+    board->rows[top + r] |= shape->rows[r] << shift;
+    cleared |= board->rows[top + r] == AUTOPLAY_FULL_ROW;
+  }
+  if (!cleared) {
+    return 0;
+  }
+
+  // only the rows the piece landed in can have filled up; everything above
+  //  the lowest one cleared moves down
+  int lines = 0;
+  int dst   = top + shape->height - 1;
+  for (int src = dst; src >= 0; src--) {
+    if (board->rows[src] == AUTOPLAY_FULL_ROW) {
+      lines++;
+    } else {
+      board->rows[dst--] = board->rows[src];
+    }
+  }
+  memset(board->rows, 0, lines);
+  return lines;
+}
+
+/**
+ * Lock the piece into `board` at `row`, `col` and clear any lines it fills
+ * @returns number of lines cleared
+ */
+int autoplay_place(autoplay_board *board, uint8_t ptype, uint8_t orientation,
+                   int row, int col) {
+  return shape_place(board, &shapes[ptype][orientation], row, col);
+}
+
+/**
+ * Score what's left on `board` after clearing `lines` lines. Columns are
+ * scanned top down all at once: `covered` has a bit set for every column
+ * that's had a filled cell so far, so the empty cells under it are holes.
+ */
+int32_t autoplay_evaluate(const autoplay_board *board, int lines,
+                          const autoplay_weights *weights) {
+  uint8_t covered                  = 0;
+  int height                       = 0;
+  int holes                        = 0;
+  uint8_t col_heights[TETRIS_COLS] = {0};
+
+  // nothing to count above the top of the stack
+  for (int row = stack_top(board); row < TETRIS_ROWS; row++) {
+    uint8_t tops = board->rows[row] & ~covered;
+    covered |= board->rows[row];
+    holes += __builtin_popcount(covered & ~board->rows[row]);
+    height += __builtin_popcount(covered);
+    for (; tops != 0; tops &= tops - 1) {
+      col_heights[__builtin_ctz(tops)] = TETRIS_ROWS - row;
+    }
+  }
+
+  int bumpiness = 0;
+  for (int col = 0; col < TETRIS_COLS - 1; col++) {
+    bumpiness += abs(col_heights[col] - col_heights[col + 1]);
+  }
+  return weights->lines * lines + weights->height * height +
+         weights->holes * holes + weights->bumpiness * bumpiness;
+}
+
+/**
+ * Best score of any placement of `ptype` dropped from the top of `board`
+ */
+static int32_t best_score(const autoplay_board *board, uint8_t ptype,
+                          int lines, const autoplay_weights *weights,
+                          uint32_t *evals) {
+  int32_t best = TOPPED_OUT;
+  int top      = stack_top(board);
+  for (int o = 0; o < NUM_ORIENTATIONS; o++) {
+    const autoplay_shape *shape = &shapes[ptype][o];
+    if (shape->duplicate) {
+      continue;
+    }
+    int row = -shape->row_offset;
+    for (int col = -shape->col_offset;
+         col + shape->col_offset + shape->width <= TETRIS_COLS; col++) {
+      if (!shape_fits(board, shape, row, col)) {
+        continue;
+      }
+      autoplay_board after = *board;
+      int landed           = shape_drop(board, shape, row, col, top);
+      int cleared          = shape_place(&after, shape, landed, col);
+      int32_t score = autoplay_evaluate(&after, lines + cleared, weights);
+      (*evals)++;
+      best = score > best ? score : best;
+    }
+  }
+  return best;
+}
+
+/**
+ * Try every placement of `piece` reachable by rotating and sliding it from
+ * where it is, then dropping it
+ * @param next_ptype - piece to look ahead at: a piece type, AUTOPLAY_ANY_PIECE
+ * to add up the best score for every type, or AUTOPLAY_NO_PIECE
+ * @param evals - incremented by the number of placements scored
+ * @returns best placement, with score INT32_MIN if there's nowhere to go
+ */
+autoplay_placement autoplay_best_placement(const autoplay_board *board,
+                                           const TetrisPiece *piece,
+                                           uint8_t next_ptype,
+                                           const autoplay_weights *weights,
+                                           uint32_t *evals) {
+  autoplay_placement best = {.orientation = piece->orientation,
+                             .row         = piece->loc.row,
+                             .col         = piece->loc.col,
+                             .score       = INT32_MIN};
+  int top                 = stack_top(board);
+
+  for (int o = 0; o < NUM_ORIENTATIONS; o++) {
+    const autoplay_shape *shape = &shapes[piece->ptype][o];
+    if (shape->duplicate) {
+      continue;
+    }
+    for (int col = -shape->col_offset;
+         col + shape->col_offset + shape->width <= TETRIS_COLS; col++) {
+      if (!shape_fits(board, shape, piece->loc.row, col)) {
+        continue;
+      }
+      int row = shape_drop(board, shape, piece->loc.row, col, top);
+      autoplay_board after = *board;
+      int lines            = shape_place(&after, shape, row, col);
+
+      int32_t score;
+      if (next_ptype == AUTOPLAY_NO_PIECE) {
+        score = autoplay_evaluate(&after, lines, weights);
+        (*evals)++;
+      } else if (next_ptype == AUTOPLAY_ANY_PIECE) {
+        score = 0;
+        for (int type = 0; type < NUM_TETROMINOS; type++) {
+          score += best_score(&after, type, lines, weights, evals);
+        }
+      } else {
+        score = best_score(&after, next_ptype, lines, weights, evals);
+      }
+
+      if (score > best.score) {
+        best = (autoplay_placement){o, row, col, score};
+      }
+    }
+  }
+  return best;
+}
+
+/**
+ * @param lookahead - AUTOPLAY_ANY_PIECE to weigh up every piece that could
+ * come next, AUTOPLAY_NO_PIECE to only look at the current one
+ */
+void autoplay_init(autoplay_bot *bot, const autoplay_weights *weights,
+                   uint8_t lookahead) {
+  assert(lookahead == AUTOPLAY_NO_PIECE || lookahead == AUTOPLAY_ANY_PIECE);
+  // only the first call writes the tables, so once that's done bots can be
+  //  set up from any number of threads
+  if (!shapes_built) {
+    build_shapes();
+    shapes_built = true;
+  }
+  memset(bot, 0, sizeof(*bot));
+  bot->weights   = *weights;
+  bot->lookahead = lookahead;
+}
+
+// the move to make from where `tp` is now, towards the plan
+static enum player_move steer(autoplay_bot *bot, const TetrisPiece *tp) {
+  if (bot->resting) {
+    return T_NONE;
+  }
+  // a blocked rotation is given up on rather than tried forever
+  if (tp->orientation != bot->target.orientation && bot->turns_left > 0) {
+    bot->turns_left--;
+    return T_UP;
+  }
+  if (!bot->slide_blocked && tp->loc.col < bot->target.col) {
+    return T_RIGHT;
+  }
+  if (!bot->slide_blocked && tp->loc.col > bot->target.col) {
+    return T_LEFT;
+  }
+  return T_DOWN;
+}
+
+/**
+ * @returns the move to make with tg_tick() next. A new piece is planned for
+ * the first time it's seen, then rotated, slid across and soft dropped. Once
+ * a soft drop stops moving it, T_NONE until the next piece.
+ */
+enum player_move autoplay_next_move(autoplay_bot *bot, const TetrisGame *tg) {
+  const TetrisPiece *tp = &tg->active_piece;
+  if (tg->game_over) {
+    return T_NONE;
+  }
+
+  // the same piece only ever moves down, so a new one is either a different
+  //  type or higher up
+  if (!bot->planned || tp->ptype != bot->ptype ||
+      tp->loc.row < bot->last_row) {
+    autoplay_board board;
+    autoplay_board_from_game(&board, &tg->active_board, tp);
+    bot->target        = autoplay_best_placement(&board, tp, bot->lookahead,
+                                                 &bot->weights, &bot->evals);
+    bot->ptype         = tp->ptype;
+    bot->turns_left    = NUM_ORIENTATIONS - 1;
+    bot->planned       = true;
+    bot->last_move     = T_NONE;
+    bot->slide_blocked = false;
+    bot->resting       = false;
+    bot->pieces++;
+  }
+
+  // a move is a whole tick, which may not include gravity, so moves that
+  //  don't get anywhere would hold the piece up forever
+  bool slid = bot->last_move == T_LEFT || bot->last_move == T_RIGHT;
+  if (slid && tp->loc.col == bot->last_col) {
+    bot->slide_blocked = true;
+  }
+  if (bot->last_move == T_DOWN && tp->loc.row == bot->last_row) {
+    bot->resting = true;
+  }
+  bot->last_row  = tp->loc.row;
+  bot->last_col  = tp->loc.col;
+  bot->last_move = steer(bot, tp);
+  return bot->last_move;
+}
@@ -0,0 +1,91 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "tetris.h"
+
+#define AUTOPLAY_ATTRACT_DELAY_S CONFIG_AUTOPLAY_ATTRACT_DELAY_S
+
+_Static_assert(TETRIS_COLS <= 8, "board rows are packed into a uint8_t");
+#define AUTOPLAY_FULL_ROW ((uint8_t)((1u << TETRIS_COLS) - 1))
+
+// next piece to look ahead at, if not a piece type
+#define AUTOPLAY_NO_PIECE  0xff  // only place the current piece
+#define AUTOPLAY_ANY_PIECE 0xfe  // try every piece type it could be
+
+/**
+ * Row bitboard copy of a TetrisBoard: bit `col` of rows[row] is set where
+ * that cell is filled. Dropping, placing and clearing lines are a handful of
+ * ANDs and ORs per row.
+ */
+typedef struct autoplay_board {
+  uint8_t rows[TETRIS_ROWS];
+} autoplay_board;
+
+/**
+ * How much each feature of the board a placement leaves behind is worth.
+ * Positive is good; height, holes and bumpiness are usually negative.
+ */
+typedef struct autoplay_weights {
+  int16_t lines;      // per line cleared
+  int16_t height;     // per filled or covered cell, ie sum of column heights
+  int16_t holes;      // per empty cell with something above it
+  int16_t bumpiness;  // per step in height between neighbouring columns
+} autoplay_weights;
+
+/**
+ * Where to put a piece, as the library's TetrisPiece orientation and location
+ */
+typedef struct autoplay_placement {
+  uint8_t orientation;
+  int8_t row;
+  int8_t col;
+  int32_t score;
+} autoplay_placement;
+
+/**
+ * Bot that plays through tg_tick(), one move per call. It plans once per
+ * piece, when the piece appears, then steers it there and soft drops it until
+ * it stops, leaving the rest to gravity. Moves that get nowhere are given
+ * up on, so they never hold off gravity.
+ */
+typedef struct autoplay_bot {
+  autoplay_weights weights;
+  uint8_t lookahead;  // AUTOPLAY_NO_PIECE or AUTOPLAY_ANY_PIECE
+  autoplay_placement target;
+  uint8_t ptype;       // piece the target is for
+  int8_t last_row;     // where that piece was at the last move
+  int8_t last_col;
+  uint8_t last_move;   // enum player_move
+  uint8_t turns_left;  // rotations to try before giving up on orientation
+  bool planned;
+  bool slide_blocked;  // a slide didn't move the piece, drop it where it is
+  bool resting;        // a soft drop didn't move the piece, gravity locks it
+  uint32_t pieces;  // pieces planned for
+  uint32_t evals;   // placements evaluated, over all pieces
+} autoplay_bot;
+
+void autoplay_board_from_game(autoplay_board *out, const TetrisBoard *tb,
+                              const TetrisPiece *falling);
+bool autoplay_fits(const autoplay_board *board, uint8_t ptype,
+                   uint8_t orientation, int row, int col);
+int autoplay_drop(const autoplay_board *board, uint8_t ptype,
+                  uint8_t orientation, int row, int col);
+int autoplay_place(autoplay_board *board, uint8_t ptype, uint8_t orientation,
+                   int row, int col);
+int32_t autoplay_evaluate(const autoplay_board *board, int lines,
+                          const autoplay_weights *weights);
+autoplay_placement autoplay_best_placement(const autoplay_board *board,
+                                           const TetrisPiece *piece,
+                                           uint8_t next_ptype,
+                                           const autoplay_weights *weights,
+                                           uint32_t *evals);
+
+void autoplay_init(autoplay_bot *bot, const autoplay_weights *weights,
+                   uint8_t lookahead);
+enum player_move autoplay_next_move(autoplay_bot *bot, const TetrisGame *tg);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef AUTOPLAY_WEIGHTS_H
+#define AUTOPLAY_WEIGHTS_H
+
+#include "autoplay.h"
+
+// hand tuned starting point, roughly the classic lines/height/holes/bumpiness
+//  heuristic scaled to integers
+static const autoplay_weights AUTOPLAY_WEIGHTS = {
+    .lines     = 76,
+    .height    = -51,
+    .holes     = -36,
+    .bumpiness = -18,
+};
+
+#endif
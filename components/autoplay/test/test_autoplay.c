@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "autoplay.h"
+#include "autoplay_weights.h"
+#include "unity.h"
+
+// only one part of the board weighted, to check features one at a time
+static const autoplay_weights LINES_ONLY     = {.lines = 1};
+static const autoplay_weights HEIGHT_ONLY    = {.height = 1};
+static const autoplay_weights HOLES_ONLY     = {.holes = 1};
+static const autoplay_weights BUMPINESS_ONLY = {.bumpiness = 1};
+
+static autoplay_bot bot;
+
+/**
+ * @returns the I piece's upright orientation, and in `col_offset` which
+ * column its cells are in relative to loc.col
+ */
+static uint8_t upright_i(int *col_offset) {
+  for (uint8_t o = 0; o < NUM_ORIENTATIONS; o++) {
+    const Coord *cells = TETROMINOS[I_CELL_COLOR][o];
+    if (cells[0].col == cells[3].col) {
+      *col_offset = cells[0].col;
+      return o;
+    }
+  }
+  TEST_FAIL_MESSAGE("no upright I piece");
+  return 0;
+}
+
+// bottom four rows full apart from the rightmost column
+static void make_well(autoplay_board *board) {
+  memset(board, 0, sizeof(*board));
+  for (int row = TETRIS_ROWS - 4; row < TETRIS_ROWS; row++) {
+    board->rows[row] = AUTOPLAY_FULL_ROW >> 1;
+  }
+}
+
+TEST_CASE("autoplay bitboard leaves out the falling piece", "[autoplay]") {
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_NO_PIECE);
+  TetrisBoard tb = init_board();
+  tb.board[TETRIS_ROWS - 1][0] = L_CELL_COLOR;
+  tb.board[TETRIS_ROWS - 1][7] = S_CELL_COLOR;
+
+  TetrisPiece piece = {.ptype = T_CELL_COLOR, .loc = {4, 2}};
+  for (int i = 0; i < 4; i++) {
+    const Coord *cell = &TETROMINOS[piece.ptype][piece.orientation][i];
+    tb.board[piece.loc.row + cell->row][piece.loc.col + cell->col] =
+        piece.ptype;
+  }
+
+  autoplay_board board;
+  autoplay_board_from_game(&board, &tb, &piece);
+  for (int row = 0; row < TETRIS_ROWS - 1; row++) {
+    TEST_ASSERT_EQUAL_HEX8(0, board.rows[row]);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x81, board.rows[TETRIS_ROWS - 1]);
+}
+
+TEST_CASE("autoplay clears lines and drops what's above", "[autoplay]") {
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_NO_PIECE);
+  autoplay_board board;
+  make_well(&board);
+  board.rows[TETRIS_ROWS - 5] = 0x01;
+
+  int col_offset;
+  uint8_t o = upright_i(&col_offset);
+  int col   = TETRIS_COLS - 1 - col_offset;
+  int row   = autoplay_drop(&board, I_CELL_COLOR, o, 0, col);
+  TEST_ASSERT_TRUE(autoplay_fits(&board, I_CELL_COLOR, o, row, col));
+  TEST_ASSERT_FALSE(autoplay_fits(&board, I_CELL_COLOR, o, row + 1, col));
+
+  TEST_ASSERT_EQUAL(4, autoplay_place(&board, I_CELL_COLOR, o, row, col));
+  for (int row = 0; row < TETRIS_ROWS - 1; row++) {
+    TEST_ASSERT_EQUAL_HEX8(0, board.rows[row]);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x01, board.rows[TETRIS_ROWS - 1]);
+}
+
+TEST_CASE("autoplay scores height, holes, bumpiness and lines",
+          "[autoplay]") {
+  autoplay_board board = {0};
+  // column 0 three high with a hole in it, column 1 one high
+  board.rows[TETRIS_ROWS - 3] = 0x01;
+  board.rows[TETRIS_ROWS - 1] = 0x03;
+
+  TEST_ASSERT_EQUAL(4, autoplay_evaluate(&board, 0, &HEIGHT_ONLY));
+  TEST_ASSERT_EQUAL(1, autoplay_evaluate(&board, 0, &HOLES_ONLY));
+  // 3 -> 1 -> 0, then flat
+  TEST_ASSERT_EQUAL(3, autoplay_evaluate(&board, 0, &BUMPINESS_ONLY));
+  TEST_ASSERT_EQUAL(2, autoplay_evaluate(&board, 2, &LINES_ONLY));
+}
+
+TEST_CASE("autoplay drops an I piece down the well", "[autoplay]") {
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_NO_PIECE);
+  autoplay_board board;
+  make_well(&board);
+  TetrisPiece piece = {.ptype = I_CELL_COLOR, .loc = {0, 2}};
+
+  uint8_t lookaheads[] = {AUTOPLAY_NO_PIECE, AUTOPLAY_ANY_PIECE};
+  for (int i = 0; i < 2; i++) {
+    uint32_t evals        = 0;
+    autoplay_placement to = autoplay_best_placement(
+        &board, &piece, lookaheads[i], &AUTOPLAY_WEIGHTS, &evals);
+    TEST_ASSERT_TRUE(evals > 0);
+
+    autoplay_board after = board;
+    TEST_ASSERT_EQUAL(4, autoplay_place(&after, piece.ptype, to.orientation,
+                                        to.row, to.col));
+  }
+}
+
+TEST_CASE("autoplay bot steers the piece to its plan", "[autoplay]") {
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_ANY_PIECE);
+  static TetrisGame tg;
+  tg.active_board = init_board();
+  for (int row = TETRIS_ROWS - 4; row < TETRIS_ROWS; row++) {
+    for (int col = 0; col < TETRIS_COLS - 1; col++) {
+      tg.active_board.board[row][col] = J_CELL_COLOR;
+    }
+  }
+  tg.active_piece = (TetrisPiece){.ptype = I_CELL_COLOR, .loc = {0, 2}};
+
+  // rotate and slide the piece as the library would, until the bot drops it
+  enum player_move move;
+  int moves = 0;
+  while ((move = autoplay_next_move(&bot, &tg)) != T_DOWN && moves++ < 16) {
+    TetrisPiece *tp = &tg.active_piece;
+    if (move == T_UP) {
+      tp->orientation = (tp->orientation + 1) % NUM_ORIENTATIONS;
+    } else {
+      tp->loc.col += move == T_RIGHT ? 1 : -1;
+    }
+  }
+  TEST_ASSERT_EQUAL(T_DOWN, move);
+  TEST_ASSERT_EQUAL_UINT32(1, bot.pieces);
+
+  int col_offset;
+  TEST_ASSERT_EQUAL(upright_i(&col_offset), tg.active_piece.orientation);
+  TEST_ASSERT_EQUAL(TETRIS_COLS - 1, tg.active_piece.loc.col + col_offset);
+
+  // soft drops carry on while they move the piece, then gravity is left to
+  //  lock it in place
+  tg.active_piece.loc.row++;
+  TEST_ASSERT_EQUAL(T_DOWN, autoplay_next_move(&bot, &tg));
+  TEST_ASSERT_EQUAL(T_NONE, autoplay_next_move(&bot, &tg));
+  TEST_ASSERT_EQUAL(T_NONE, autoplay_next_move(&bot, &tg));
+  TEST_ASSERT_EQUAL_UINT32(1, bot.pieces);
+}
+
+TEST_CASE("autoplay bot drops a piece it can't slide", "[autoplay]") {
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_NO_PIECE);
+  static TetrisGame tg;
+  tg.active_board = init_board();
+  for (int row = TETRIS_ROWS - 4; row < TETRIS_ROWS; row++) {
+    for (int col = 0; col < TETRIS_COLS - 1; col++) {
+      tg.active_board.board[row][col] = J_CELL_COLOR;
+    }
+  }
+  tg.active_piece = (TetrisPiece){.ptype = I_CELL_COLOR, .loc = {0, 2}};
+
+  // the bot wants the well on the right, but the library never lets the
+  //  piece slide; it has to give up and drop rather than try forever
+  enum player_move move;
+  int moves  = 0;
+  int slides = 0;
+  while ((move = autoplay_next_move(&bot, &tg)) != T_DOWN && moves++ < 16) {
+    TetrisPiece *tp = &tg.active_piece;
+    if (move == T_UP) {
+      tp->orientation = (tp->orientation + 1) % NUM_ORIENTATIONS;
+    } else {
+      slides++;
+    }
+  }
+  TEST_ASSERT_EQUAL(T_DOWN, move);
+  TEST_ASSERT_EQUAL(1, slides);
+}
+
+/**
+ * Not a pass/fail test - prints how fast placements are scored, and how long
+ * planning a piece takes with lookahead, on whatever this runs on
+ */
+TEST_CASE("benchmark autoplay evaluations", "[autoplay][bench]") {
+  const int pieces = 200;
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_ANY_PIECE);
+
+  // ragged stack with a few holes, about a third of the way up
+  autoplay_board board = {0};
+  for (int row = TETRIS_ROWS - 10; row < TETRIS_ROWS; row++) {
+    board.rows[row] = AUTOPLAY_FULL_ROW & ~(1u << (row * 5 % TETRIS_COLS)) &
+                      ~(1u << (row * 3 % TETRIS_COLS));
+  }
+
+  uint32_t evals = 0;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < pieces; i++) {
+    TetrisPiece piece = {.ptype = i % NUM_TETROMINOS, .loc = {0, 2}};
+    autoplay_best_placement(&board, &piece, AUTOPLAY_ANY_PIECE,
+                            &AUTOPLAY_WEIGHTS, &evals);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double us = (end.tv_sec - start.tv_sec) * 1e6 +
+              (end.tv_nsec - start.tv_nsec) / 1e3;
+  printf("autoplay: %.0f evals/s, %.0f us/piece with lookahead\n",
+         evals / us * 1e6, us / pieces);
+}
@@ -0,0 +1,78 @@
+/**
+ * Fixed-timestep game clock with deterministic catch-up
+ */
+
+#include "game_clock.h"
+
+#include <string.h>
+
+/**
+ * @param period_us - time between game ticks
+ * @param max_catchup - most ticks game_clock_ticks_due() will ever return
+ * @param now_us - current time; the first tick is due one period from now
+ */
+void game_clock_init(game_clock *clock, int64_t period_us,
+                     uint32_t max_catchup, int64_t now_us) {
+  memset(clock, 0, sizeof(*clock));
+  clock->period_us   = period_us;
+  clock->max_catchup = max_catchup;
+  latency_hist_reset(&clock->stats.lateness);
+  game_clock_resync(clock, now_us);
+}
+
+/**
+ * Restart the tick grid from `now_us`, e.g. after unpausing, so time spent
+ * paused isn't counted as an overrun
+ */
+void game_clock_resync(game_clock *clock, int64_t now_us) {
+  clock->next_tick_us = now_us + clock->period_us;
+}
+
+/**
+ * Work out how many game ticks should run now. Every deadline that has
+ * passed gets a tick, up to max_catchup; anything beyond that is dropped
+ * and the grid skips ahead, staying in phase.
+ * @returns number of ticks to run, 0 if the next one isn't due yet
+ */
+uint32_t game_clock_ticks_due(game_clock *clock, int64_t now_us) {
+  if (now_us < clock->next_tick_us) {
+    return 0;
+  }
+
+  int64_t late_us = now_us - clock->next_tick_us;
+  uint32_t due    = 1 + late_us / clock->period_us;
+  latency_hist_record(&clock->stats.lateness, late_us);
+  clock->next_tick_us += (int64_t)due * clock->period_us;
+
+  if (due > 1) {
+    clock->stats.overruns++;
+  }
+  if (due > clock->max_catchup) {
+    clock->stats.dropped_ticks += due - clock->max_catchup;
+    due = clock->max_catchup;
+  }
+  clock->stats.ticks += due;
+  return due;
+}
+
+/**
+ * Run the next tick now rather than at its deadline, e.g. to apply a press
+ * without waiting for it. The tick counts as run, so the deadline moves on a
+ * period and the game goes no faster overall. The clock only ever gets one
+ * tick ahead of real time.
+ * @returns false if it's already a tick ahead; the caller has to wait for the
+ * next tick due instead
+ */
+bool game_clock_take_tick(game_clock *clock, int64_t now_us) {
+  if (clock->next_tick_us - now_us > clock->period_us) {
+    return false;
+  }
+  clock->next_tick_us += clock->period_us;
+  clock->stats.ticks++;
+  clock->stats.early_ticks++;
+  return true;
+}
+
+int64_t game_clock_next_deadline(const game_clock *clock) {
+  return clock->next_tick_us;
+}
@@ -0,0 +1,40 @@
+#ifndef GAME_CLOCK_H
+#define GAME_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "latency_hist.h"
+#include "sdkconfig.h"
+
+#define GAME_CLOCK_TICK_US           CONFIG_GAME_CLOCK_TICK_US
+#define GAME_CLOCK_MAX_CATCHUP_TICKS CONFIG_GAME_CLOCK_MAX_CATCHUP_TICKS
+
+typedef struct game_clock_stats {
+  uint32_t ticks;          // ticks handed out to run
+  uint32_t overruns;       // times a whole period or more was missed
+  uint32_t dropped_ticks;  // ticks skipped to get back in step
+  uint32_t early_ticks;    // ticks taken ahead of their deadline
+  latency_hist lateness;   // how long after each deadline it was noticed
+} game_clock_stats;
+
+/**
+ * Fixed-timestep game clock. Deadlines are kept on an exact grid of
+ * `period_us` from when the clock was started, so the tick rate doesn't
+ * drift with how long each tick takes or how late the task wakes up.
+ */
+typedef struct game_clock {
+  int64_t period_us;
+  uint32_t max_catchup;
+  int64_t next_tick_us;
+  game_clock_stats stats;
+} game_clock;
+
+void game_clock_init(game_clock *clock, int64_t period_us,
+                     uint32_t max_catchup, int64_t now_us);
+void game_clock_resync(game_clock *clock, int64_t now_us);
+uint32_t game_clock_ticks_due(game_clock *clock, int64_t now_us);
+bool game_clock_take_tick(game_clock *clock, int64_t now_us);
+int64_t game_clock_next_deadline(const game_clock *clock);
+
+#endif
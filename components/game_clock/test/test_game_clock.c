@@ -0,0 +1,79 @@
+#include "game_clock.h"
+#include "unity.h"
+
+#define PERIOD_US 15000
+
+static game_clock clk;
+
+TEST_CASE("game clock ticks once per period on time", "[game_clock]") {
+  game_clock_init(&clk, PERIOD_US, 4, 1000);
+  TEST_ASSERT_EQUAL(1000 + PERIOD_US, game_clock_next_deadline(&clk));
+  TEST_ASSERT_EQUAL_UINT32(0, game_clock_ticks_due(&clk, PERIOD_US + 999));
+
+  for (int i = 1; i <= 100; i++) {
+    int64_t now_us = 1000 + i * PERIOD_US;
+    TEST_ASSERT_EQUAL_UINT32(1, game_clock_ticks_due(&clk, now_us));
+  }
+  TEST_ASSERT_EQUAL_UINT32(100, clk.stats.ticks);
+  TEST_ASSERT_EQUAL_UINT32(0, clk.stats.overruns);
+  TEST_ASSERT_EQUAL_UINT32(0, clk.stats.lateness.max_us);
+}
+
+TEST_CASE("game clock doesn't drift when woken late", "[game_clock]") {
+  game_clock_init(&clk, PERIOD_US, 4, 0);
+
+  // every wake up is 4ms late, but deadlines stay on the 15ms grid
+  for (int i = 1; i <= 100; i++) {
+    int64_t now_us = i * PERIOD_US + 4000;
+    TEST_ASSERT_EQUAL_UINT32(1, game_clock_ticks_due(&clk, now_us));
+    TEST_ASSERT_EQUAL((i + 1) * PERIOD_US, game_clock_next_deadline(&clk));
+  }
+  TEST_ASSERT_EQUAL_UINT32(4000,
+                           latency_hist_percentile(&clk.stats.lateness, 50));
+}
+
+TEST_CASE("game clock catches up after an overrun", "[game_clock]") {
+  game_clock_init(&clk, PERIOD_US, 4, 0);
+
+  // stalled for just under 3 periods: all three ticks run at once
+  TEST_ASSERT_EQUAL_UINT32(3, game_clock_ticks_due(&clk, 4 * PERIOD_US - 1));
+  TEST_ASSERT_EQUAL(4 * PERIOD_US, game_clock_next_deadline(&clk));
+  TEST_ASSERT_EQUAL_UINT32(1, clk.stats.overruns);
+  TEST_ASSERT_EQUAL_UINT32(0, clk.stats.dropped_ticks);
+
+  // stalled for 10 periods: only 4 run, and the grid stays in phase
+  TEST_ASSERT_EQUAL_UINT32(4, game_clock_ticks_due(&clk, 13 * PERIOD_US));
+  TEST_ASSERT_EQUAL(14 * PERIOD_US, game_clock_next_deadline(&clk));
+  TEST_ASSERT_EQUAL_UINT32(6, clk.stats.dropped_ticks);
+  TEST_ASSERT_EQUAL_UINT32(7, clk.stats.ticks);
+}
+
+TEST_CASE("game clock resync doesn't count a pause as an overrun",
+          "[game_clock]") {
+  game_clock_init(&clk, PERIOD_US, 4, 0);
+  game_clock_resync(&clk, 1000 * PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT32(0, game_clock_ticks_due(&clk, 1000 * PERIOD_US));
+  TEST_ASSERT_EQUAL_UINT32(1, game_clock_ticks_due(&clk, 1001 * PERIOD_US));
+  TEST_ASSERT_EQUAL_UINT32(0, clk.stats.overruns);
+}
+
+TEST_CASE("game clock only takes one tick early", "[game_clock]") {
+  game_clock_init(&clk, PERIOD_US, 4, 0);
+
+  // a press right after starting gets the first tick straight away, but a
+  // second one has to wait for the tick after it
+  TEST_ASSERT_TRUE(game_clock_take_tick(&clk, 1000));
+  TEST_ASSERT_FALSE(game_clock_take_tick(&clk, 2000));
+  TEST_ASSERT_EQUAL(2 * PERIOD_US, game_clock_next_deadline(&clk));
+
+  // the tick taken early isn't run again at its deadline
+  TEST_ASSERT_EQUAL_UINT32(0, game_clock_ticks_due(&clk, PERIOD_US));
+  TEST_ASSERT_TRUE(game_clock_take_tick(&clk, PERIOD_US));
+  TEST_ASSERT_EQUAL_UINT32(0, game_clock_ticks_due(&clk, 2 * PERIOD_US));
+  TEST_ASSERT_EQUAL_UINT32(1, game_clock_ticks_due(&clk, 3 * PERIOD_US));
+
+  // three periods in, still exactly three ticks
+  TEST_ASSERT_EQUAL_UINT32(3, clk.stats.ticks);
+  TEST_ASSERT_EQUAL_UINT32(2, clk.stats.early_ticks);
+  TEST_ASSERT_EQUAL_UINT32(0, clk.stats.overruns);
+}
@@ -0,0 +1,140 @@
+/**
+ * Game snapshots for deep sleep. Packing the board at 3 bits per cell takes
+ * it from 256 bytes to 96; the rest of the game is a few dozen bytes more.
+ *
+ * Everything in the TetrisGame outside the cells is saved byte for byte.
+ * Games hold no pointers (main.c copies them around by value), so the bytes
+ * mean the same after waking up. State the library keeps outside the
+ * TetrisGame, if any, isn't saved.
+ */
+
+#include "game_snapshot.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define CELL_MASK ((1u << GAME_SNAPSHOT_CELL_BITS) - 1)
+#define CELLS_END (GAME_SNAPSHOT_CELLS_OFFSET + GAME_SNAPSHOT_CELLS_BYTES)
+
+_Static_assert(sizeof(TetrisGame) <= UINT16_MAX,
+               "game_bytes must hold the size of a game");
+
+static uint32_t snapshot_check(const game_snapshot *snap) {
+  // FNV-1a, over every byte before `check`
+  const uint8_t *bytes = (const uint8_t *)snap;
+  uint32_t hash        = 0x811c9dc5;
+  for (size_t i = 0; i < offsetof(game_snapshot, check); i++) {
+    hash = (hash ^ bytes[i]) * 0x01000193;
+  }
+  return hash;
+}
+
+/**
+ * Pack `tg` into `snap`
+ * @param resume - enum game_snapshot_resume, what waking up goes back to
+ * @param rng_seed - what the RNG was just seeded with, so it carries on the
+ * same way after restoring
+ */
+void game_snapshot_save(game_snapshot *snap, const TetrisGame *tg,
+                        uint8_t resume, uint8_t brightness,
+                        uint32_t rng_seed) {
+  // zeroed first so padding doesn't change the check value
+  memset(snap, 0, sizeof(*snap));
+  snap->magic      = GAME_SNAPSHOT_MAGIC;
+  snap->version    = GAME_SNAPSHOT_VERSION;
+  snap->resume     = resume;
+  snap->brightness = brightness;
+  snap->game_bytes = sizeof(TetrisGame);
+  snap->rng_seed   = rng_seed;
+
+  const uint8_t *game = (const uint8_t *)tg;
+  memcpy(snap->game, game, GAME_SNAPSHOT_CELLS_OFFSET);
+  memcpy(&snap->game[GAME_SNAPSHOT_CELLS_OFFSET], &game[CELLS_END],
+         sizeof(TetrisGame) - CELLS_END);
+
+  // cells go in a bit stream, least significant bits first
+  uint32_t bits = 0;
+  int num_bits  = 0;
+  size_t out    = 0;
+  for (int row = 0; row < TETRIS_ROWS; row++) {
+    for (int col = 0; col < TETRIS_COLS; col++) {
+      uint32_t cell = tg->active_board.board[row][col] + 1;
+      bits |= (cell & CELL_MASK) << num_bits;
+      num_bits += GAME_SNAPSHOT_CELL_BITS;
+      while (num_bits >= 8) {
+        snap->board[out++] = bits;
+        bits >>= 8;
+        num_bits -= 8;
+      }
+    }
+  }
+  if (num_bits > 0) {
+    snap->board[out] = bits;
+  }
+  snap->check = snapshot_check(snap);
+}
+
+// the falling piece, out of the saved game bytes
+static TetrisPiece saved_piece(const game_snapshot *snap) {
+  size_t offset = offsetof(TetrisGame, active_piece);
+  if (offset >= CELLS_END) {
+    offset -= GAME_SNAPSHOT_CELLS_BYTES;
+  }
+  TetrisPiece piece;
+  memcpy(&piece, &snap->game[offset], sizeof(piece));
+  return piece;
+}
+
+/**
+ * @returns true if `snap` holds a snapshot saved by this firmware, intact
+ */
+bool game_snapshot_valid(const game_snapshot *snap) {
+  if (snap->magic != GAME_SNAPSHOT_MAGIC ||
+      snap->version != GAME_SNAPSHOT_VERSION ||
+      snap->resume == GAME_SNAPSHOT_RESUME_NONE ||
+      snap->game_bytes != sizeof(TetrisGame) ||
+      snap->check != snapshot_check(snap)) {
+    return false;
+  }
+  TetrisPiece piece = saved_piece(snap);
+  return piece.ptype < NUM_TETROMINOS && piece.orientation < NUM_ORIENTATIONS;
+}
+
+/**
+ * Unpack `snap` into `tg`, all of it: the game comes back exactly as it was
+ * saved, whatever `tg` held before.
+ * @returns false, leaving `tg` alone, if the snapshot isn't valid
+ */
+bool game_snapshot_restore(const game_snapshot *snap, TetrisGame *tg) {
+  if (!game_snapshot_valid(snap)) {
+    return false;
+  }
+
+  uint8_t *game = (uint8_t *)tg;
+  memcpy(game, snap->game, GAME_SNAPSHOT_CELLS_OFFSET);
+  memcpy(&game[CELLS_END], &snap->game[GAME_SNAPSHOT_CELLS_OFFSET],
+         sizeof(TetrisGame) - CELLS_END);
+
+  uint32_t bits = 0;
+  int num_bits  = 0;
+  size_t in     = 0;
+  for (int row = 0; row < TETRIS_ROWS; row++) {
+    for (int col = 0; col < TETRIS_COLS; col++) {
+      if (num_bits < GAME_SNAPSHOT_CELL_BITS) {
+        bits |= (uint32_t)snap->board[in++] << num_bits;
+        num_bits += 8;
+      }
+      tg->active_board.board[row][col] = (int8_t)(bits & CELL_MASK) - 1;
+      bits >>= GAME_SNAPSHOT_CELL_BITS;
+      num_bits -= GAME_SNAPSHOT_CELL_BITS;
+    }
+  }
+  return true;
+}
+
+/**
+ * Mark `snap` as used up, so the next wake doesn't restore it again
+ */
+void game_snapshot_clear(game_snapshot *snap) {
+  memset(snap, 0, sizeof(*snap));
+}
@@ -0,0 +1,63 @@
+#ifndef GAME_SNAPSHOT_H
+#define GAME_SNAPSHOT_H
+
+/**
+ * Compact copy of a game, small enough to keep in RTC memory through deep
+ * sleep: board cells packed at 3 bits each, every other byte of the
+ * TetrisGame copied as it is, and a seed to carry the RNG on from. Checked on
+ * the way back in, since RTC memory holds whatever it likes after a brownout.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tetris.h"
+
+#define GAME_SNAPSHOT_MAGIC   0x5350534e  // "NSPS"
+#define GAME_SNAPSHOT_VERSION 2
+
+// a cell is stored as its color + 1, so BG_COLOR is 0
+#define GAME_SNAPSHOT_CELL_BITS 3
+_Static_assert(NUM_TETROMINOS + 1 <= 1 << GAME_SNAPSHOT_CELL_BITS,
+               "every cell color must fit in a snapshot cell");
+#define GAME_SNAPSHOT_BOARD_BYTES \
+  ((TETRIS_ROWS * TETRIS_COLS * GAME_SNAPSHOT_CELL_BITS + 7) / 8)
+
+// where the board's cells sit in a TetrisGame. The bytes around them, the
+//  piece, score and level along with whatever the library counts gravity
+//  and levels with, are kept whole, so nothing it tracks is lost
+#define GAME_SNAPSHOT_CELLS_OFFSET \
+  (offsetof(TetrisGame, active_board) + offsetof(TetrisBoard, board))
+#define GAME_SNAPSHOT_CELLS_BYTES (sizeof(((TetrisBoard *)0)->board))
+#define GAME_SNAPSHOT_GAME_BYTES \
+  (sizeof(TetrisGame) - GAME_SNAPSHOT_CELLS_BYTES)
+
+// what to go back to when the snapshot is restored
+enum game_snapshot_resume {
+  GAME_SNAPSHOT_RESUME_NONE,  // no snapshot; start from scratch
+  GAME_SNAPSHOT_RESUME_GAME,  // the game, paused
+  GAME_SNAPSHOT_RESUME_MENU,  // the play again screen, showing the last game
+};
+
+typedef struct game_snapshot {
+  uint32_t magic;  // GAME_SNAPSHOT_MAGIC
+  uint8_t version;
+  uint8_t resume;  // enum game_snapshot_resume
+  uint8_t brightness;
+  uint16_t game_bytes;  // sizeof(TetrisGame) it was saved from
+  uint32_t rng_seed;    // srand() this to carry on
+  uint8_t board[GAME_SNAPSHOT_BOARD_BYTES];
+  // the TetrisGame with the cells cut out
+  uint8_t game[GAME_SNAPSHOT_GAME_BYTES];
+  uint32_t check;  // FNV-1a of everything above
+} game_snapshot;
+
+void game_snapshot_save(game_snapshot *snap, const TetrisGame *tg,
+                        uint8_t resume, uint8_t brightness,
+                        uint32_t rng_seed);
+bool game_snapshot_valid(const game_snapshot *snap);
+bool game_snapshot_restore(const game_snapshot *snap, TetrisGame *tg);
+void game_snapshot_clear(game_snapshot *snap);
+
+#endif
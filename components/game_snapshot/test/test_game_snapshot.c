@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "game_snapshot.h"
+#include "unity.h"
+
+static game_snapshot snap;
+
+// a game part way through: every color on the board, and a piece falling
+static void make_game(TetrisGame *tg) {
+  memset(tg, 0, sizeof(*tg));
+  tg->active_board = init_board();
+  for (int row = TETRIS_ROWS - 6; row < TETRIS_ROWS; row++) {
+    for (int col = 0; col < TETRIS_COLS; col++) {
+      tg->active_board.board[row][col] = (row * 3 + col) % 8 - 1;
+    }
+  }
+  tg->active_board.highest_occupied_cell = TETRIS_ROWS - 6;
+  tg->active_piece.ptype                 = I_CELL_COLOR;
+  tg->active_piece.orientation           = 3;
+  tg->active_piece.loc.row               = 12;
+  tg->active_piece.loc.col               = -1;
+  tg->score                              = 123456;
+  tg->level                              = 7;
+}
+
+TEST_CASE("game snapshot packs cells at 3 bits", "[game_snapshot]") {
+  TEST_ASSERT_EQUAL(TETRIS_ROWS * TETRIS_COLS * 3 / 8,
+                    GAME_SNAPSHOT_BOARD_BYTES);
+  TEST_ASSERT_TRUE(sizeof(game_snapshot) < sizeof(TetrisBoard));
+}
+
+TEST_CASE("game snapshot restores the game it saved", "[game_snapshot]") {
+  TetrisGame saved, restored;
+  make_game(&saved);
+  game_snapshot_save(&snap, &saved, GAME_SNAPSHOT_RESUME_GAME, 2, 0xc0ffee);
+  TEST_ASSERT_TRUE(game_snapshot_valid(&snap));
+  TEST_ASSERT_EQUAL(GAME_SNAPSHOT_RESUME_GAME, snap.resume);
+  TEST_ASSERT_EQUAL(2, snap.brightness);
+  TEST_ASSERT_EQUAL_HEX32(0xc0ffee, snap.rng_seed);
+
+  memset(&restored, 0, sizeof(restored));
+  restored.active_board = init_board();
+  TEST_ASSERT_TRUE(game_snapshot_restore(&snap, &restored));
+  TEST_ASSERT_EQUAL_MEMORY(&saved.active_board, &restored.active_board,
+                           sizeof(saved.active_board));
+  TEST_ASSERT_EQUAL(saved.active_piece.ptype, restored.active_piece.ptype);
+  TEST_ASSERT_EQUAL(saved.active_piece.orientation,
+                    restored.active_piece.orientation);
+  TEST_ASSERT_EQUAL(saved.active_piece.loc.row, restored.active_piece.loc.row);
+  TEST_ASSERT_EQUAL(saved.active_piece.loc.col, restored.active_piece.loc.col);
+  TEST_ASSERT_EQUAL(saved.score, restored.score);
+  TEST_ASSERT_EQUAL(saved.level, restored.level);
+  TEST_ASSERT_FALSE(restored.game_over);
+}
+
+TEST_CASE("game snapshot keeps the library's own state", "[game_snapshot]") {
+  TetrisGame saved, restored;
+  make_game(&saved);
+  // every byte outside the cells stands in for counters the library keeps,
+  //  like gravity timing, that the snapshot can't know about by name
+  TetrisBoard board = saved.active_board;
+  uint8_t *bytes    = (uint8_t *)&saved;
+  for (size_t i = 0; i < sizeof(saved); i++) {
+    bytes[i] = i * 7 + 1;
+  }
+  memcpy(saved.active_board.board, board.board, sizeof(board.board));
+  saved.active_piece.ptype       = T_CELL_COLOR;
+  saved.active_piece.orientation = 1;
+  game_snapshot_save(&snap, &saved, GAME_SNAPSHOT_RESUME_GAME, 0, 1);
+  TEST_ASSERT_EQUAL(sizeof(TetrisGame), snap.game_bytes);
+
+  memset(&restored, 0xff, sizeof(restored));
+  TEST_ASSERT_TRUE(game_snapshot_restore(&snap, &restored));
+  TEST_ASSERT_EQUAL_MEMORY(&saved, &restored, sizeof(saved));
+}
+
+TEST_CASE("game snapshot rejects damaged snapshots", "[game_snapshot]") {
+  TetrisGame saved, restored;
+  make_game(&saved);
+  game_snapshot_save(&snap, &saved, GAME_SNAPSHOT_RESUME_MENU, 0, 1);
+
+  // a bit flipped anywhere, padding included
+  game_snapshot damaged;
+  for (size_t i = 0; i < sizeof(snap); i++) {
+    damaged = snap;
+    ((uint8_t *)&damaged)[i] ^= 0x10;
+    TEST_ASSERT_FALSE(game_snapshot_valid(&damaged));
+  }
+
+  memset(&restored, 0, sizeof(restored));
+  restored.score = 99;
+  TEST_ASSERT_FALSE(game_snapshot_restore(&damaged, &restored));
+  TEST_ASSERT_EQUAL(99, restored.score);
+
+  // used up snapshots, and RTC memory that never held one
+  game_snapshot_clear(&snap);
+  TEST_ASSERT_FALSE(game_snapshot_valid(&snap));
+  memset(&snap, 0xa5, sizeof(snap));
+  TEST_ASSERT_FALSE(game_snapshot_valid(&snap));
+}
@@ -0,0 +1,35 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+// each power of two is split into LATENCY_HIST_SUBS buckets, so a bucket is
+// never more than 25% wide
+#define LATENCY_HIST_SUB_BITS 2
+#define LATENCY_HIST_SUBS     (1 << LATENCY_HIST_SUB_BITS)
+// anything slower than this lands in the last bucket
+#define LATENCY_HIST_MAX_BITS 24
+#define LATENCY_HIST_MAX_US   ((1UL << LATENCY_HIST_MAX_BITS) - 1)
+#define LATENCY_HIST_NUM_BUCKETS \
+  ((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUBS)
+
+/**
+ * Fixed-size log-linear histogram of latencies in microseconds, 1us up to
+ * about 16s. Recording is O(1) and never allocates.
+ */
+typedef struct latency_hist {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t buckets[LATENCY_HIST_NUM_BUCKETS];
+} latency_hist;
+
+void latency_hist_reset(latency_hist *hist);
+void latency_hist_record(latency_hist *hist, int64_t latency_us);
+uint32_t latency_hist_percentile(const latency_hist *hist, uint32_t percent);
+
+uint32_t latency_hist_bucket(uint32_t latency_us);
+uint32_t latency_hist_bucket_min(uint32_t bucket);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+
+#include "latency_hist.h"
+#include "sdkconfig.h"
+
+// stages a remote press goes through on its way to the LEDs
+enum latency_stage {
+  LATENCY_RADIO_TO_DEQUEUE,   // recv callback -> espnow_recv_task dequeues it
+  LATENCY_DEQUEUE_TO_PARSE,   // dequeued -> parsed and queued for the game
+  LATENCY_PARSE_TO_TICK,      // queued -> tg_tick applies the move
+  LATENCY_TICK_TO_PHOTON,     // move applied -> display_board pushed it
+  LATENCY_PRESS_TO_PHOTON,    // recv callback -> pixels pushed, end to end
+  LATENCY_RESTART_TO_PHOTON,  // play again pressed -> new game on the LEDs
+  LATENCY_NUM_STAGES
+};
+
+#if CONFIG_LATENCY_TRACE
+
+/**
+ * Record how long a press spent in `stage`. Each stage must only ever be
+ * recorded from one task.
+ * @param start_us, end_us - esp_timer_get_time() at either end of the stage
+ */
+void latency_trace_record(enum latency_stage stage, int64_t start_us,
+                          int64_t end_us);
+const latency_hist *latency_trace_get(enum latency_stage stage);
+void latency_trace_reset(void);
+void latency_trace_dump(void);
+
+#else
+
+static inline void latency_trace_record(enum latency_stage stage,
+                                        int64_t start_us, int64_t end_us) {
+  (void)stage;
+  (void)start_us;
+  (void)end_us;
+}
+static inline void latency_trace_reset(void) {}
+static inline void latency_trace_dump(void) {}
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Log-linear latency histogram: exact below LATENCY_HIST_SUBS us, then each
+ * power of two is split into LATENCY_HIST_SUBS equal buckets
+ */
+
+#include "latency_hist.h"
+
+#include <string.h>
+
+void latency_hist_reset(latency_hist *hist) {
+  memset(hist, 0, sizeof(*hist));
+}
+
+/**
+ * @returns index of the bucket holding `latency_us`
+ */
+uint32_t latency_hist_bucket(uint32_t latency_us) {
+  if (latency_us > LATENCY_HIST_MAX_US) {
+    latency_us = LATENCY_HIST_MAX_US;
+  }
+  if (latency_us < LATENCY_HIST_SUBS) {
+    return latency_us;
+  }
+  uint32_t msb = 31 - __builtin_clz(latency_us);
+  uint32_t sub = (latency_us >> (msb - LATENCY_HIST_SUB_BITS)) &
+                 (LATENCY_HIST_SUBS - 1);
+  return (msb - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUBS + sub;
+}
+
+/**
+ * @returns smallest latency that falls in `bucket`
+ */
+uint32_t latency_hist_bucket_min(uint32_t bucket) {
+  if (bucket < LATENCY_HIST_SUBS) {
+    return bucket;
+  }
+  uint32_t msb = bucket / LATENCY_HIST_SUBS + LATENCY_HIST_SUB_BITS - 1;
+  uint32_t sub = bucket % LATENCY_HIST_SUBS;
+  return (LATENCY_HIST_SUBS + sub) << (msb - LATENCY_HIST_SUB_BITS);
+}
+
+/**
+ * Add one sample. Negative latencies (clock skew between cores) count as 0.
+ */
+void latency_hist_record(latency_hist *hist, int64_t latency_us) {
+  uint32_t us = 0;
+  if (latency_us > (int64_t)LATENCY_HIST_MAX_US) {
+    us = LATENCY_HIST_MAX_US;
+  } else if (latency_us > 0) {
+    us = (uint32_t)latency_us;
+  }
+  if (hist->count == 0 || us < hist->min_us) {
+    hist->min_us = us;
+  }
+  hist->buckets[latency_hist_bucket(us)]++;
+  hist->count++;
+  hist->total_us += us;
+  if (us > hist->max_us) {
+    hist->max_us = us;
+  }
+}
+
+/**
+ * Estimate a percentile from the buckets. The answer is the top of the bucket
+ * the percentile falls in, so it's never an underestimate, and is capped at
+ * the largest latency actually recorded.
+ * @param percent - 0 to 100
+ * @returns latency in us, or 0 if nothing has been recorded
+ */
+uint32_t latency_hist_percentile(const latency_hist *hist, uint32_t percent) {
+  if (hist->count == 0) {
+    return 0;
+  }
+  // rank of the sample we're after, 1-based and rounded up
+  uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (uint32_t b = 0; b < LATENCY_HIST_NUM_BUCKETS; b++) {
+    seen += hist->buckets[b];
+    if (seen >= rank) {
+      uint32_t top = b + 1 < LATENCY_HIST_NUM_BUCKETS
+                         ? latency_hist_bucket_min(b + 1) - 1
+                         : LATENCY_HIST_MAX_US;
+      return top < hist->max_us ? top : hist->max_us;
+    }
+  }
+  return hist->max_us;
+}
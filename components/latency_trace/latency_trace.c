@@ -0,0 +1,60 @@
+/**
+ * Per-stage press-to-photon latency histograms
+ */
+
+#include "latency_trace.h"
+
+#if CONFIG_LATENCY_TRACE
+
+#include "esp_log.h"
+#include "npix_tetris_defs.h"
+
+static latency_hist stage_hists[LATENCY_NUM_STAGES];
+static const char *stage_names[LATENCY_NUM_STAGES] = {
+    [LATENCY_RADIO_TO_DEQUEUE]  = "radio->dequeue",
+    [LATENCY_DEQUEUE_TO_PARSE]  = "dequeue->parse",
+    [LATENCY_PARSE_TO_TICK]     = "parse->tick",
+    [LATENCY_TICK_TO_PHOTON]    = "tick->photon",
+    [LATENCY_PRESS_TO_PHOTON]   = "press->photon",
+    [LATENCY_RESTART_TO_PHOTON] = "restart->photon",
+};
+
+void latency_trace_record(enum latency_stage stage, int64_t start_us,
+                          int64_t end_us) {
+  latency_hist_record(&stage_hists[stage], end_us - start_us);
+}
+
+const latency_hist *latency_trace_get(enum latency_stage stage) {
+  return &stage_hists[stage];
+}
+
+/**
+ * Clear every histogram. Samples recorded by other tasks while this runs may
+ * be lost.
+ */
+void latency_trace_reset(void) {
+  for (int i = 0; i < LATENCY_NUM_STAGES; i++) {
+    latency_hist_reset(&stage_hists[i]);
+  }
+}
+
+/**
+ * Log count, mean, p50/p95/p99 and max for every stage. Other tasks keep
+ * recording while this runs, so the numbers can be slightly inconsistent.
+ */
+void latency_trace_dump(void) {
+  ESP_LOGI(TAG, "%-16s %8s %8s %8s %8s %8s %8s", "latency (us)", "count",
+           "mean", "p50", "p95", "p99", "max");
+  for (int i = 0; i < LATENCY_NUM_STAGES; i++) {
+    const latency_hist *hist = &stage_hists[i];
+    ESP_LOGI(TAG, "%-16s %8lu %8lu %8lu %8lu %8lu %8lu", stage_names[i],
+             (unsigned long)hist->count,
+             (unsigned long)(hist->count ? hist->total_us / hist->count : 0),
+             (unsigned long)latency_hist_percentile(hist, 50),
+             (unsigned long)latency_hist_percentile(hist, 95),
+             (unsigned long)latency_hist_percentile(hist, 99),
+             (unsigned long)hist->max_us);
+  }
+}
+
+#endif
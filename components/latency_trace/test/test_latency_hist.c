@@ -0,0 +1,57 @@
+#include "latency_hist.h"
+#include "unity.h"
+
+static latency_hist hist;
+
+TEST_CASE("latency buckets cover every value in order", "[latency]") {
+  uint32_t last_bucket = 0;
+  for (uint32_t us = 0; us <= 100000; us++) {
+    uint32_t bucket = latency_hist_bucket(us);
+    TEST_ASSERT_TRUE(bucket == last_bucket || bucket == last_bucket + 1);
+    TEST_ASSERT_LESS_OR_EQUAL(us, latency_hist_bucket_min(bucket));
+    TEST_ASSERT_GREATER_THAN(us, latency_hist_bucket_min(bucket + 1));
+    last_bucket = bucket;
+  }
+  TEST_ASSERT_EQUAL_UINT32(LATENCY_HIST_NUM_BUCKETS - 1,
+                           latency_hist_bucket(LATENCY_HIST_MAX_US));
+  TEST_ASSERT_EQUAL_UINT32(LATENCY_HIST_NUM_BUCKETS - 1,
+                           latency_hist_bucket(UINT32_MAX));
+}
+
+TEST_CASE("latency buckets are at most 25% wide", "[latency]") {
+  for (uint32_t b = LATENCY_HIST_SUBS; b < LATENCY_HIST_NUM_BUCKETS - 1; b++) {
+    uint32_t lo = latency_hist_bucket_min(b);
+    uint32_t hi = latency_hist_bucket_min(b + 1);
+    TEST_ASSERT_LESS_OR_EQUAL(lo / 4, hi - lo);
+  }
+}
+
+TEST_CASE("latency percentiles of a uniform distribution", "[latency]") {
+  latency_hist_reset(&hist);
+  TEST_ASSERT_EQUAL_UINT32(0, latency_hist_percentile(&hist, 50));
+
+  for (int64_t us = 1; us <= 1000; us++) {
+    latency_hist_record(&hist, us);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, hist.count);
+  TEST_ASSERT_EQUAL_UINT32(1, hist.min_us);
+  TEST_ASSERT_EQUAL_UINT32(1000, hist.max_us);
+
+  // never under the true value, and never more than a bucket over
+  uint32_t p50 = latency_hist_percentile(&hist, 50);
+  uint32_t p99 = latency_hist_percentile(&hist, 99);
+  TEST_ASSERT_TRUE(p50 >= 500 && p50 <= 500 * 5 / 4);
+  TEST_ASSERT_TRUE(p99 >= 990 && p99 <= 1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, latency_hist_percentile(&hist, 100));
+}
+
+TEST_CASE("latency samples out of range are clamped", "[latency]") {
+  latency_hist_reset(&hist);
+  latency_hist_record(&hist, -5);
+  latency_hist_record(&hist, 100LL * 1000 * 1000);
+  TEST_ASSERT_EQUAL_UINT32(0, hist.min_us);
+  TEST_ASSERT_EQUAL_UINT32(LATENCY_HIST_MAX_US, hist.max_us);
+  TEST_ASSERT_EQUAL_UINT32(0, latency_hist_percentile(&hist, 50));
+  TEST_ASSERT_EQUAL_UINT32(LATENCY_HIST_MAX_US,
+                           latency_hist_percentile(&hist, 99));
+}
@@ -0,0 +1,154 @@
+/**
+ * Keyframed display animations, stepped once per rendered frame.
+ *
+ * Each animation is a short const table of keyframes with times in ms. Those
+ * are converted to frame numbers once, at the rate the render task actually
+ * draws at, so stepping an animation is a compare and an increment. What each
+ * frame looks like is handed to the compositor as a display_effect, which
+ * only redraws the rows the effect changed.
+ */
+
+#include "display_anim.h"
+
+#include <assert.h>
+#include <string.h>
+
+// clang-format off
+static const display_keyframe line_clear_keyframes[] = {
+    {0,   DISPLAY_EFFECT_FLASH_ROWS, 0,   0, 0},
+    {60,  DISPLAY_EFFECT_NONE,       0,   0, 0},
+    {120, DISPLAY_EFFECT_FLASH_ROWS, 0,   0, 0},
+    {180, DISPLAY_EFFECT_WIPE_ROWS,  0,   0, DISPLAY_KEYFRAME_RAMP},
+    {300, DISPLAY_EFFECT_WIPE_ROWS,  255, 0, DISPLAY_KEYFRAME_END},
+};
+
+static const display_keyframe game_over_keyframes[] = {
+    {0,    DISPLAY_EFFECT_CURTAIN, 0,   0, DISPLAY_KEYFRAME_RAMP},
+    {450,  DISPLAY_EFFECT_CURTAIN, 255, 0, 0},
+    {600,  DISPLAY_EFFECT_CURTAIN, 255, 0, DISPLAY_KEYFRAME_RAMP},
+    {1000, DISPLAY_EFFECT_CURTAIN, 0,   0, DISPLAY_KEYFRAME_END},
+};
+
+static const display_keyframe level_up_keyframes[] = {
+    {0,   DISPLAY_EFFECT_NONE, 0, 3, 0},
+    {80,  DISPLAY_EFFECT_NONE, 0, 2, 0},
+    {160, DISPLAY_EFFECT_NONE, 0, 1, 0},
+    {240, DISPLAY_EFFECT_NONE, 0, 0, DISPLAY_KEYFRAME_END},
+};
+
+static const display_keyframe pause_keyframes[] = {
+    {0,   DISPLAY_EFFECT_NONE, 0, -1, 0},
+    {70,  DISPLAY_EFFECT_NONE, 0, -2, 0},
+    {140, DISPLAY_EFFECT_NONE, 0, -3, 0},
+    {210, DISPLAY_EFFECT_NONE, 0, -4, DISPLAY_KEYFRAME_HOLD},
+};
+// clang-format on
+
+#define ANIM(table) {table, sizeof(table) / sizeof(table[0])}
+
+static const struct {
+  const display_keyframe *keyframes;
+  uint8_t num_keyframes;
+} anims[DISPLAY_NUM_ANIMS] = {
+    [DISPLAY_ANIM_LINE_CLEAR] = ANIM(line_clear_keyframes),
+    [DISPLAY_ANIM_GAME_OVER]  = ANIM(game_over_keyframes),
+    [DISPLAY_ANIM_LEVEL_UP]   = ANIM(level_up_keyframes),
+    [DISPLAY_ANIM_PAUSE]      = ANIM(pause_keyframes),
+};
+
+// frame each keyframe starts on, at the rate passed to display_anim_init()
+static uint16_t keyframe_frames[DISPLAY_NUM_ANIMS][DISPLAY_ANIM_MAX_KEYFRAMES];
+
+/**
+ * Work out which frame every keyframe starts on. Call again if the render
+ * rate changes.
+ * @param frames_per_sec - rate display_anim_step() will be called at
+ */
+void display_anim_init(uint32_t frames_per_sec) {
+  for (int id = 0; id < DISPLAY_NUM_ANIMS; id++) {
+    assert(anims[id].num_keyframes <= DISPLAY_ANIM_MAX_KEYFRAMES);
+    for (int k = 0; k < anims[id].num_keyframes; k++) {
+      uint32_t at_ms = anims[id].keyframes[k].at_ms;
+      keyframe_frames[id][k] = (at_ms * frames_per_sec + 500) / 1000;
+    }
+  }
+}
+
+/**
+ * Start animation `id` from its first keyframe, replacing whatever `anim` was
+ * playing
+ * @param rows - up to DISPLAY_EFFECT_MAX_ROWS rows for row effects, -1 for
+ * unused entries; NULL if the animation doesn't use rows
+ */
+void display_anim_start(display_anim *anim, uint8_t id, const int8_t *rows) {
+  assert(id < DISPLAY_NUM_ANIMS);
+  anim->id       = id;
+  anim->keyframe = 0;
+  anim->frame    = 0;
+  if (rows != NULL) {
+    memcpy(anim->rows, rows, sizeof(anim->rows));
+  } else {
+    memset(anim->rows, -1, sizeof(anim->rows));
+  }
+}
+
+void display_anim_stop(display_anim *anim) { anim->id = DISPLAY_ANIM_NONE; }
+
+/**
+ * @returns what to draw this frame, and moves the animation on by one frame
+ */
+display_effect display_anim_step(display_anim *anim) {
+  display_effect effect = {.kind = DISPLAY_EFFECT_NONE};
+  if (anim->id == DISPLAY_ANIM_NONE) {
+    return effect;
+  }
+
+  const display_keyframe *keyframes = anims[anim->id].keyframes;
+  const uint16_t *frames            = keyframe_frames[anim->id];
+  uint8_t last                      = anims[anim->id].num_keyframes - 1;
+  while (anim->keyframe < last && anim->frame >= frames[anim->keyframe + 1]) {
+    anim->keyframe++;
+  }
+
+  const display_keyframe *kf = &keyframes[anim->keyframe];
+  if (kf->flags & DISPLAY_KEYFRAME_END) {
+    anim->id = DISPLAY_ANIM_NONE;
+    return effect;
+  }
+
+  effect.kind        = kf->kind;
+  effect.progress    = kf->progress;
+  effect.level_shift = kf->level_shift;
+  memcpy(effect.rows, anim->rows, sizeof(effect.rows));
+
+  if ((kf->flags & DISPLAY_KEYFRAME_RAMP) && anim->keyframe < last) {
+    int start = frames[anim->keyframe];
+    int span  = frames[anim->keyframe + 1] - start;
+    int delta = kf[1].progress - kf->progress;
+    if (span > 0) {
+      effect.progress = kf->progress + delta * (anim->frame - start) / span;
+    }
+  }
+
+  // a held keyframe stays put until display_anim_stop()
+  if (!(kf->flags & DISPLAY_KEYFRAME_HOLD)) {
+    anim->frame++;
+  }
+  return effect;
+}
+
+/**
+ * @returns true while the animation still changes from frame to frame
+ */
+bool display_anim_running(const display_anim *anim) {
+  return anim->id != DISPLAY_ANIM_NONE && !display_anim_holding(anim);
+}
+
+/**
+ * @returns true once the animation has reached a keyframe it holds on
+ */
+bool display_anim_holding(const display_anim *anim) {
+  return anim->id != DISPLAY_ANIM_NONE &&
+         (anims[anim->id].keyframes[anim->keyframe].flags &
+          DISPLAY_KEYFRAME_HOLD);
+}
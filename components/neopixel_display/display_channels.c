@@ -0,0 +1,59 @@
+/**
+ * Splitting the panel chain over parallel output channels.
+ *
+ * WS2812 data has to be clocked through every LED in front of the one being
+ * set, so a frame takes time in proportion to the length of the chain. With
+ * several data pins, each drives its own shorter run of whole panels and all
+ * of them are sent at once, so the refresh rate is set by the longest run
+ * instead of the whole display.
+ */
+
+#include "neopixel_display.h"
+
+/**
+ * Give each channel a run of whole panels, in chain order. Panels are spread
+ * as evenly as they go, with any left over going to the first channels.
+ * @param spans - num_channels entries to fill in
+ * @param num_tiles - panels in the chain, at least num_channels
+ * @param panel_pixels - LEDs per panel
+ */
+void display_split_channels(display_channel_span *spans, int num_channels,
+                            int num_tiles, int panel_pixels) {
+  int per_channel = num_tiles / num_channels;
+  int extra       = num_tiles % num_channels;
+  int first_tile  = 0;
+
+  for (int ch = 0; ch < num_channels; ch++) {
+    int tiles = per_channel + (ch < extra ? 1 : 0);
+    spans[ch] = (display_channel_span){.first_led = first_tile * panel_pixels,
+                                       .num_leds  = tiles * panel_pixels};
+    first_tile += tiles;
+  }
+}
+
+/**
+ * @param dirty_bits - one bit per LED, LED 0 in bit 0 of the first byte
+ * @returns true if any LED in `span` is marked dirty
+ */
+bool display_span_dirty(const uint8_t *dirty_bits, display_channel_span span) {
+  int led = span.first_led;
+  int end = span.first_led + span.num_leds;
+
+  // check the bits before the first whole byte one at a time
+  for (; led < end && (led & 7) != 0; led++) {
+    if (dirty_bits[led >> 3] & (1 << (led & 7))) {
+      return true;
+    }
+  }
+  for (; led + 8 <= end; led += 8) {
+    if (dirty_bits[led >> 3] != 0) {
+      return true;
+    }
+  }
+  for (; led < end; led++) {
+    if (dirty_bits[led >> 3] & (1 << (led & 7))) {
+      return true;
+    }
+  }
+  return false;
+}
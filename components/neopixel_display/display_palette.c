@@ -0,0 +1,151 @@
+/**
+ * Color palettes for the neopixel display.
+ *
+ * Cell colors are looked up in a palette that already has gamma correction
+ * and brightness applied, so drawing a cell is a single table load. One
+ * palette is built per brightness level at init; changing brightness just
+ * points `active_palette` at a different one.
+ */
+
+#include <assert.h>
+
+#include "neopixel_display.h"
+
+// palette index of a cell color. BG_COLOR is -1, so everything is shifted up
+//  by one to start the table at zero
+#define PALETTE_INDEX(color) ((color) + 1)
+
+_Static_assert(BG_COLOR == -1, "palette layout assumes BG_COLOR is -1");
+_Static_assert(OVERLAY_CELL_COLOR + 1 == DISPLAY_PALETTE_SIZE - 1,
+               "overlay color must be the last palette entry");
+
+/**
+ * Gamma correction table (gamma = 2.8), maps perceived intensity to the PWM
+ * value WS2812s need to show it
+ */
+const uint8_t display_gamma8[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      2,   3,   3,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   5,   5,   5,
+      5,   6,   6,   6,   6,   7,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,
+     10,  10,  11,  11,  11,  12,  12,  13,  13,  13,  14,  14,  15,  15,  16,  16,
+     17,  17,  18,  18,  19,  19,  20,  20,  21,  21,  22,  22,  23,  24,  24,  25,
+     25,  26,  27,  27,  28,  29,  29,  30,  31,  32,  32,  33,  34,  35,  35,  36,
+     37,  38,  39,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  50,
+     51,  52,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  66,  67,  68,
+     69,  70,  72,  73,  74,  75,  77,  78,  79,  81,  82,  83,  85,  86,  87,  89,
+     90,  92,  93,  95,  96,  98,  99, 101, 102, 104, 105, 107, 109, 110, 112, 114,
+    115, 117, 119, 120, 122, 124, 126, 127, 129, 131, 133, 135, 137, 138, 140, 142,
+    144, 146, 148, 150, 152, 154, 156, 158, 160, 162, 164, 167, 169, 171, 173, 175,
+    177, 180, 182, 184, 186, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+    215, 218, 220, 223, 225, 228, 231, 233, 236, 239, 241, 244, 247, 249, 252, 255,
+};
+
+// base colors at full intensity, before gamma and brightness
+static const uint8_t base_colors[DISPLAY_PALETTE_SIZE][3] = {
+    [PALETTE_INDEX(BG_COLOR)]           = {0, 0, 0},        // off
+    [PALETTE_INDEX(S_CELL_COLOR)]       = {0, 255, 0},      // Green
+    [PALETTE_INDEX(Z_CELL_COLOR)]       = {255, 0, 0},      // Red
+    [PALETTE_INDEX(T_CELL_COLOR)]       = {255, 0, 255},    // Magenta
+    [PALETTE_INDEX(L_CELL_COLOR)]       = {255, 165, 0},    // Orange
+    [PALETTE_INDEX(J_CELL_COLOR)]       = {0, 0, 255},      // Blue
+    [PALETTE_INDEX(SQ_CELL_COLOR)]      = {255, 255, 0},    // Yellow
+    [PALETTE_INDEX(I_CELL_COLOR)]       = {0, 255, 255},    // light blue
+    [PALETTE_INDEX(OVERLAY_CELL_COLOR)] = {255, 255, 255},  // icons - white
+};
+
+// perceived intensity of each brightness level, applied before gamma.
+//  DISPLAY_DEFAULT_BRIGHTNESS gives ~50/255 per channel after gamma, which is
+//  what the display used before palettes existed
+static const uint8_t brightness_scale[DISPLAY_NUM_BRIGHTNESS_LEVELS] = {
+    40, 64, 90, 116, 142, 170, 204, 255};
+
+static uint32_t palettes[DISPLAY_NUM_BRIGHTNESS_LEVELS][DISPLAY_PALETTE_SIZE];
+static uint32_t ghost_palettes[DISPLAY_NUM_BRIGHTNESS_LEVELS]
+                              [DISPLAY_PALETTE_SIZE];
+static uint8_t brightness = DISPLAY_DEFAULT_BRIGHTNESS;
+
+// points at the entry for cell color 0 of the current palette, so it can be
+//  indexed directly with any cell color, including BG_COLOR (-1)
+const uint32_t *active_palette =
+    &palettes[DISPLAY_DEFAULT_BRIGHTNESS][PALETTE_INDEX(0)];
+const uint32_t *active_piece_palette =
+    &palettes[DISPLAY_DEFAULT_BRIGHTNESS][PALETTE_INDEX(0)];
+const uint32_t *active_ghost_palette =
+    &ghost_palettes[DISPLAY_DEFAULT_BRIGHTNESS][PALETTE_INDEX(0)];
+
+static void select_palettes(void);
+static int clamp_level(int level);
+
+/**
+ * Build palettes for every brightness level. Only needs to run once, but is
+ * safe to call again.
+ */
+void init_display_palettes(void) {
+  for (int level = 0; level < DISPLAY_NUM_BRIGHTNESS_LEVELS; level++) {
+    for (int i = 0; i < DISPLAY_PALETTE_SIZE; i++) {
+      uint8_t rgb[3], ghost[3];
+      for (int ch = 0; ch < 3; ch++) {
+        uint8_t level_scaled =
+            base_colors[i][ch] * brightness_scale[level] / 255;
+        rgb[ch]   = display_gamma8[level_scaled];
+        ghost[ch] = display_gamma8[level_scaled / DISPLAY_GHOST_DIVISOR];
+        // keep the ghost visible at low brightness
+        if (level_scaled != 0 && ghost[ch] == 0) {
+          ghost[ch] = 1;
+        }
+      }
+      palettes[level][i]       = NP_RGB(rgb[0], rgb[1], rgb[2]);
+      ghost_palettes[level][i] = NP_RGB(ghost[0], ghost[1], ghost[2]);
+    }
+  }
+  select_palettes();
+}
+
+/**
+ * Switch to the palette for brightness `level`. Takes effect for everything
+ * drawn from here on; the caller is responsible for redrawing.
+ * @returns true if brightness changed
+ */
+bool set_display_brightness(uint8_t level) {
+  if (level >= DISPLAY_NUM_BRIGHTNESS_LEVELS || level == brightness) {
+    return false;
+  }
+  brightness = level;
+  select_palettes();
+  return true;
+}
+
+uint8_t get_display_brightness(void) { return brightness; }
+
+/**
+ * Palettes for `level_shift` brightness levels away from the current one,
+ * clamped to the levels that exist. Used for fades and pulses.
+ */
+display_palettes get_display_palettes(int level_shift) {
+  int level       = clamp_level(brightness + level_shift);
+  int piece_level = clamp_level(level + DISPLAY_PIECE_HIGHLIGHT_LEVELS);
+  return (display_palettes){
+      .cells = &palettes[level][PALETTE_INDEX(0)],
+      .piece = &palettes[piece_level][PALETTE_INDEX(0)],
+      .ghost = &ghost_palettes[level][PALETTE_INDEX(0)],
+  };
+}
+
+static int clamp_level(int level) {
+  if (level < 0) {
+    return 0;
+  }
+  if (level >= DISPLAY_NUM_BRIGHTNESS_LEVELS) {
+    return DISPLAY_NUM_BRIGHTNESS_LEVELS - 1;
+  }
+  return level;
+}
+
+static void select_palettes(void) {
+  display_palettes current = get_display_palettes(0);
+  active_palette           = current.cells;
+  active_piece_palette     = current.piece;
+  active_ghost_palette     = current.ghost;
+}
@@ -0,0 +1,109 @@
+/**
+ * 3x5 pixel font for the HUD layer
+ */
+
+#include <stdint.h>
+
+#include "neopixel_display.h"
+
+// pack five 3 bit rows, top row in the high bits, leftmost column first
+#define GLYPH(r0, r1, r2, r3, r4) \
+  (uint16_t)((r0) << 12 | (r1) << 9 | (r2) << 6 | (r3) << 3 | (r4))
+
+#define FONT_FIRST_CHAR ' '
+#define FONT_LAST_CHAR  'Z'
+
+// characters without an entry draw as blanks
+static const uint16_t font_3x5[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1] = {
+    ['!' - ' '] = GLYPH(0b010, 0b010, 0b010, 0b000, 0b010),
+    ['+' - ' '] = GLYPH(0b000, 0b010, 0b111, 0b010, 0b000),
+    ['-' - ' '] = GLYPH(0b000, 0b000, 0b111, 0b000, 0b000),
+    ['.' - ' '] = GLYPH(0b000, 0b000, 0b000, 0b000, 0b010),
+    ['/' - ' '] = GLYPH(0b001, 0b001, 0b010, 0b100, 0b100),
+    ['0' - ' '] = GLYPH(0b111, 0b101, 0b101, 0b101, 0b111),
+    ['1' - ' '] = GLYPH(0b010, 0b110, 0b010, 0b010, 0b111),
+    ['2' - ' '] = GLYPH(0b111, 0b001, 0b111, 0b100, 0b111),
+    ['3' - ' '] = GLYPH(0b111, 0b001, 0b111, 0b001, 0b111),
+    ['4' - ' '] = GLYPH(0b101, 0b101, 0b111, 0b001, 0b001),
+    ['5' - ' '] = GLYPH(0b111, 0b100, 0b111, 0b001, 0b111),
+    ['6' - ' '] = GLYPH(0b111, 0b100, 0b111, 0b101, 0b111),
+    ['7' - ' '] = GLYPH(0b111, 0b001, 0b001, 0b010, 0b010),
+    ['8' - ' '] = GLYPH(0b111, 0b101, 0b111, 0b101, 0b111),
+    ['9' - ' '] = GLYPH(0b111, 0b101, 0b111, 0b001, 0b111),
+    [':' - ' '] = GLYPH(0b000, 0b010, 0b000, 0b010, 0b000),
+    ['=' - ' '] = GLYPH(0b000, 0b111, 0b000, 0b111, 0b000),
+    ['?' - ' '] = GLYPH(0b111, 0b001, 0b010, 0b000, 0b010),
+    ['A' - ' '] = GLYPH(0b010, 0b101, 0b111, 0b101, 0b101),
+    ['B' - ' '] = GLYPH(0b110, 0b101, 0b110, 0b101, 0b110),
+    ['C' - ' '] = GLYPH(0b011, 0b100, 0b100, 0b100, 0b011),
+    ['D' - ' '] = GLYPH(0b110, 0b101, 0b101, 0b101, 0b110),
+    ['E' - ' '] = GLYPH(0b111, 0b100, 0b110, 0b100, 0b111),
+    ['F' - ' '] = GLYPH(0b111, 0b100, 0b110, 0b100, 0b100),
+    ['G' - ' '] = GLYPH(0b011, 0b100, 0b101, 0b101, 0b011),
+    ['H' - ' '] = GLYPH(0b101, 0b101, 0b111, 0b101, 0b101),
+    ['I' - ' '] = GLYPH(0b111, 0b010, 0b010, 0b010, 0b111),
+    ['J' - ' '] = GLYPH(0b001, 0b001, 0b001, 0b101, 0b010),
+    ['K' - ' '] = GLYPH(0b101, 0b101, 0b110, 0b101, 0b101),
+    ['L' - ' '] = GLYPH(0b100, 0b100, 0b100, 0b100, 0b111),
+    ['M' - ' '] = GLYPH(0b101, 0b111, 0b111, 0b101, 0b101),
+    ['N' - ' '] = GLYPH(0b110, 0b101, 0b101, 0b101, 0b101),
+    ['O' - ' '] = GLYPH(0b010, 0b101, 0b101, 0b101, 0b010),
+    ['P' - ' '] = GLYPH(0b110, 0b101, 0b110, 0b100, 0b100),
+    ['Q' - ' '] = GLYPH(0b010, 0b101, 0b101, 0b110, 0b011),
+    ['R' - ' '] = GLYPH(0b110, 0b101, 0b110, 0b101, 0b101),
+    ['S' - ' '] = GLYPH(0b011, 0b100, 0b010, 0b001, 0b110),
+    ['T' - ' '] = GLYPH(0b111, 0b010, 0b010, 0b010, 0b010),
+    ['U' - ' '] = GLYPH(0b101, 0b101, 0b101, 0b101, 0b111),
+    ['V' - ' '] = GLYPH(0b101, 0b101, 0b101, 0b101, 0b010),
+    ['W' - ' '] = GLYPH(0b101, 0b101, 0b111, 0b111, 0b101),
+    ['X' - ' '] = GLYPH(0b101, 0b101, 0b010, 0b101, 0b101),
+    ['Y' - ' '] = GLYPH(0b101, 0b101, 0b010, 0b010, 0b010),
+    ['Z' - ' '] = GLYPH(0b111, 0b001, 0b010, 0b100, 0b111),
+};
+
+static uint16_t glyph_for(char c) {
+  if (c >= 'a' && c <= 'z') {
+    c = c - 'a' + 'A';
+  }
+  if (c < FONT_FIRST_CHAR || c > FONT_LAST_CHAR) {
+    return 0;
+  }
+  return font_3x5[c - FONT_FIRST_CHAR];
+}
+
+/**
+ * Width of `text` in pixels, including the gaps between characters
+ */
+int display_text_width(const char *text) {
+  int len = 0;
+  while (text[len] != '\0') len++;
+  return len == 0 ? 0 : len * DISPLAY_FONT_ADVANCE - 1;
+}
+
+/**
+ * Draw one row of `text` into a line of pixels, in the built-in 3x5 font.
+ * Characters entirely off the display are skipped without being unpacked, so
+ * scrolling long strings across the panel only costs the visible glyphs.
+ * @param glyph_row - row of the font to draw, 0 to DISPLAY_FONT_HEIGHT - 1
+ * @param left_col - column of the first character; may be off the display
+ * @param rgb - NP_RGB() color to draw the text in
+ * @param line - DISPLAY_SCENE_COLS pixels to draw into
+ */
+void display_text_row(const char *text, int glyph_row, int left_col,
+                      uint32_t rgb, uint32_t *line) {
+  const int shift = (DISPLAY_FONT_HEIGHT - 1 - glyph_row) * DISPLAY_FONT_WIDTH;
+  uint32_t bits;
+  const display_sprite glyph = {
+      .rows = &bits, .width = DISPLAY_FONT_WIDTH, .height = 1};
+
+  for (int col = left_col; *text != '\0' && col < DISPLAY_SCENE_COLS;
+       text++, col += DISPLAY_FONT_ADVANCE) {
+    if (col + DISPLAY_FONT_WIDTH <= 0) {
+      continue;
+    }
+    bits = (glyph_for(*text) >> shift) & ((1u << DISPLAY_FONT_WIDTH) - 1);
+    if (bits != 0) {
+      display_sprite_row(&glyph, 0, col, rgb, line);
+    }
+  }
+}
@@ -0,0 +1,36 @@
+/**
+ * Fitting the board-sized scene onto panels bigger than the board, so the
+ * same firmware runs on an 8x32 panel or a wall of them.
+ */
+
+#include "neopixel_display.h"
+
+/**
+ * Work out the span tables for drawing the scene `scale` times its size,
+ * centered on the display.
+ * @param display_rows, display_cols - size of the display in LEDs, at least
+ * the size of the scene
+ * @param scale - LEDs per cell along each side. 0, or anything too big to
+ * fit, picks the largest scale that fits
+ */
+display_viewport display_fit_viewport(int display_rows, int display_cols,
+                                      int scale) {
+  int max_scale = display_rows / DISPLAY_SCENE_ROWS;
+  if (display_cols / DISPLAY_SCENE_COLS < max_scale) {
+    max_scale = display_cols / DISPLAY_SCENE_COLS;
+  }
+  if (scale <= 0 || scale > max_scale) {
+    scale = max_scale;
+  }
+
+  display_viewport viewport = {.scale = scale};
+  int row                   = (display_rows - DISPLAY_SCENE_ROWS * scale) / 2;
+  for (int r = 0; r <= DISPLAY_SCENE_ROWS; r++, row += scale) {
+    viewport.row_start[r] = row;
+  }
+  int col = (display_cols - DISPLAY_SCENE_COLS * scale) / 2;
+  for (int c = 0; c <= DISPLAY_SCENE_COLS; c++, col += scale) {
+    viewport.col_start[c] = col;
+  }
+  return viewport;
+}
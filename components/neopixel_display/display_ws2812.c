@@ -0,0 +1,88 @@
+/**
+ * WS2812 bitstream encoder. Every nibble of GRB data maps to four symbols in a
+ * const table, so a byte is encoded with two 16 byte copies and no per-bit
+ * branching.
+ */
+
+#include "display_ws2812.h"
+
+#include <string.h>
+
+#define BIT_SYMBOL(nibble, bit) \
+  (((nibble) >> (bit)) & 1 ? WS2812_SYMBOL_ONE : WS2812_SYMBOL_ZERO)
+// WS2812 takes the most significant bit first
+#define NIBBLE_SYMBOLS(n)                                           \
+  {BIT_SYMBOL(n, 3), BIT_SYMBOL(n, 2), BIT_SYMBOL(n, 1), BIT_SYMBOL(n, 0)}
+
+static const uint32_t nibble_symbols[16][4] = {
+    NIBBLE_SYMBOLS(0x0), NIBBLE_SYMBOLS(0x1), NIBBLE_SYMBOLS(0x2),
+    NIBBLE_SYMBOLS(0x3), NIBBLE_SYMBOLS(0x4), NIBBLE_SYMBOLS(0x5),
+    NIBBLE_SYMBOLS(0x6), NIBBLE_SYMBOLS(0x7), NIBBLE_SYMBOLS(0x8),
+    NIBBLE_SYMBOLS(0x9), NIBBLE_SYMBOLS(0xA), NIBBLE_SYMBOLS(0xB),
+    NIBBLE_SYMBOLS(0xC), NIBBLE_SYMBOLS(0xD), NIBBLE_SYMBOLS(0xE),
+    NIBBLE_SYMBOLS(0xF),
+};
+
+static uint32_t *encode_bytes(const uint8_t *grb, size_t num_bytes,
+                              uint32_t *out) {
+  for (size_t i = 0; i < num_bytes; i++) {
+    memcpy(out, nibble_symbols[grb[i] >> 4], sizeof(nibble_symbols[0]));
+    memcpy(out + 4, nibble_symbols[grb[i] & 0xF], sizeof(nibble_symbols[0]));
+    out += 8;
+  }
+  return out;
+}
+
+/**
+ * Encode GRB bytes, in the order they go down the strip, into RMT symbols
+ * followed by the reset that latches them.
+ * @param symbols - room for WS2812_SYMBOLS(num_bytes) symbols
+ * @returns number of symbols written
+ */
+size_t ws2812_encode(const uint8_t *grb, size_t num_bytes, uint32_t *symbols) {
+  uint32_t *out = encode_bytes(grb, num_bytes, symbols);
+  *out++        = WS2812_SYMBOL_RESET;
+  return out - symbols;
+}
+
+/**
+ * Start encoding `num_bytes` of GRB data a chunk at a time. `grb` has to stay
+ * unchanged until the last chunk has been encoded
+ */
+void ws2812_chunker_init(ws2812_chunker *chunker, const uint8_t *grb,
+                         size_t num_bytes) {
+  *chunker = (ws2812_chunker){.grb = grb, .num_bytes = num_bytes};
+}
+
+/**
+ * Encode the next chunk of the frame, up to WS2812_CHUNK_BYTES of data. The
+ * last chunk ends with the reset, so the chunks together are exactly what
+ * ws2812_encode() gives for the whole frame.
+ * @param symbols - room for WS2812_CHUNK_SYMBOLS symbols
+ * @returns number of symbols written, 0 once the frame is all encoded
+ */
+size_t ws2812_encode_chunk(ws2812_chunker *chunker, uint32_t *symbols) {
+  if (chunker->done) return 0;
+  size_t count = chunker->num_bytes - chunker->next_byte;
+  if (count > WS2812_CHUNK_BYTES) count = WS2812_CHUNK_BYTES;
+
+  uint32_t *out = encode_bytes(&chunker->grb[chunker->next_byte], count,
+                               symbols);
+
+  chunker->next_byte += count;
+  if (chunker->next_byte == chunker->num_bytes) {
+    *out++        = WS2812_SYMBOL_RESET;
+    chunker->done = true;
+  }
+  return out - symbols;
+}
+
+/**
+ * @returns whole frames per second a strip of `num_pixels` can be sent at
+ */
+uint32_t ws2812_refresh_rate(uint32_t num_pixels) {
+  uint32_t bit_ticks   = WS2812_T0H_TICKS + WS2812_T0L_TICKS;
+  uint64_t frame_ticks = (uint64_t)num_pixels * 24 * bit_ticks +
+                         WS2812_RESET_TICKS;
+  return WS2812_RESOLUTION_HZ / frame_ticks;
+}
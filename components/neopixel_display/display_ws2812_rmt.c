@@ -0,0 +1,214 @@
+/**
+ * RMT output backend, one RMT channel per output channel. Each frame is copied
+ * into one of two small GRB buffers while the other is still being clocked
+ * out, and a custom RMT encoder turns it into symbols a chunk at a time from
+ * the nibble table as the peripheral asks for more, the same way the IDF
+ * led_strip encoder works. Only a chunk of symbols per channel is ever held in
+ * RAM rather than whole encoded frames. The CPU never touches the line while a
+ * frame is going out, and the channels all transmit at the same time.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "display_ws2812.h"
+#include "driver/rmt_tx.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "neopixel_display.h"
+#include "soc/soc_caps.h"
+
+#define NUM_BUFFERS 2
+// the first channel is the longest, see display_split_channels()
+#define CHANNEL_MAX_TILES \
+  ((DISPLAY_NUM_TILES + DISPLAY_CHANNELS - 1) / DISPLAY_CHANNELS)
+#define CHANNEL_MAX_BYTES \
+  (CHANNEL_MAX_TILES * DISPLAY_PANEL_PIXELS * DISPLAY_BYTES_PER_PIXEL)
+
+_Static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t),
+               "encoder symbols must match rmt_symbol_word_t");
+
+/**
+ * Encoder that feeds the RMT driver a frame of GRB bytes. Each chunk is encoded
+ * into `chunk` and handed on to a copy encoder, which may take several calls
+ * to get it all into the RMT memory before the next chunk is encoded.
+ */
+typedef struct ws2812_rmt_encoder {
+  rmt_encoder_t base;
+  rmt_encoder_handle_t copy;
+  ws2812_chunker chunker;
+  bool started;  // chunker is set up for the frame being sent
+  // symbols in `chunk` the copy encoder hasn't finished with, 0 for none
+  size_t chunk_symbols;
+  uint32_t chunk[WS2812_CHUNK_SYMBOLS];
+} ws2812_rmt_encoder;
+
+typedef struct ws2812_rmt_output {
+  rmt_channel_handle_t channel;
+  ws2812_rmt_encoder encoder;
+  // buffers not queued for transmission; given back from the ISR as each
+  //  frame finishes going out, in the order they were queued
+  SemaphoreHandle_t free_buffers;
+  StaticSemaphore_t free_buffers_struct;
+  uint8_t next;
+  // the encoder reads these from the ISR, so the framebuffer is free to
+  //  change as soon as a frame is queued
+  uint8_t grb[NUM_BUFFERS][CHANNEL_MAX_BYTES];
+} ws2812_rmt_output;
+
+static ws2812_rmt_output outputs[DISPLAY_CHANNELS];
+
+// called by the RMT driver, from the ISR, whenever it has room for more
+static size_t IRAM_ATTR encode_frame(rmt_encoder_t *encoder,
+                                     rmt_channel_handle_t channel,
+                                     const void *grb, size_t num_bytes,
+                                     rmt_encode_state_t *ret_state) {
+  ws2812_rmt_encoder *enc = __containerof(encoder, ws2812_rmt_encoder, base);
+
+  rmt_encode_state_t state = RMT_ENCODING_RESET;
+  size_t encoded           = 0;
+  if (!enc->started) {
+    ws2812_chunker_init(&enc->chunker, grb, num_bytes);
+    enc->started = true;
+  }
+
+  while (true) {
+    if (enc->chunk_symbols == 0) {
+      enc->chunk_symbols = ws2812_encode_chunk(&enc->chunker, enc->chunk);
+      if (enc->chunk_symbols == 0) {
+        // ready for the next frame
+        enc->started = false;
+        state |= RMT_ENCODING_COMPLETE;
+        break;
+      }
+    }
+    rmt_encode_state_t copy_state = RMT_ENCODING_RESET;
+    encoded += enc->copy->encode(enc->copy, channel, enc->chunk,
+                                 enc->chunk_symbols * sizeof(enc->chunk[0]),
+                                 &copy_state);
+    if (copy_state & RMT_ENCODING_COMPLETE) enc->chunk_symbols = 0;
+    if (copy_state & RMT_ENCODING_MEM_FULL) {
+      // the driver calls again, from where the copy encoder left off, once
+      //  there's room
+      state |= RMT_ENCODING_MEM_FULL;
+      break;
+    }
+  }
+  *ret_state = state;
+  return encoded;
+}
+
+static esp_err_t reset_encoder(rmt_encoder_t *encoder) {
+  ws2812_rmt_encoder *enc = __containerof(encoder, ws2812_rmt_encoder, base);
+  enc->started            = false;
+  enc->chunk_symbols      = 0;
+  return rmt_encoder_reset(enc->copy);
+}
+
+static esp_err_t del_encoder(rmt_encoder_t *encoder) {
+  // the encoder itself lives in `outputs`, only the copy encoder is allocated
+  ws2812_rmt_encoder *enc = __containerof(encoder, ws2812_rmt_encoder, base);
+  return rmt_del_encoder(enc->copy);
+}
+
+static bool IRAM_ATTR on_frame_sent(rmt_channel_handle_t channel,
+                                    const rmt_tx_done_event_data_t *edata,
+                                    void *user_ctx) {
+  ws2812_rmt_output *output = user_ctx;
+  BaseType_t woken          = pdFALSE;
+  xSemaphoreGiveFromISR(output->free_buffers, &woken);
+  return woken == pdTRUE;
+}
+
+/**
+ * Set up an RMT channel to drive output channel `ch` on `gpio`
+ * @returns context to pass to ws2812_rmt_write(), NULL on failure
+ */
+tNeopixelContext ws2812_rmt_init(int ch, int gpio) {
+  assert(ch < DISPLAY_CHANNELS);
+  ws2812_rmt_output *output              = &outputs[ch];
+  rmt_tx_channel_config_t channel_config = {
+      .gpio_num          = gpio,
+      .clk_src           = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz     = WS2812_RESOLUTION_HZ,
+      .trans_queue_depth = NUM_BUFFERS,
+#if SOC_RMT_SUPPORT_DMA
+      // only some RMT channels have DMA; the rest take turns refilling
+      //  their memory block from the ISR
+      .mem_block_symbols = ch == 0 ? 1024 : SOC_RMT_MEM_WORDS_PER_CHANNEL,
+      .flags.with_dma    = ch == 0,
+#else
+      .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+#endif
+  };
+  if (rmt_new_tx_channel(&channel_config, &output->channel) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to allocate RMT channel");
+    return NULL;
+  }
+
+  rmt_copy_encoder_config_t copy_config = {};
+  if (rmt_new_copy_encoder(&copy_config, &output->encoder.copy) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create RMT encoder");
+    rmt_del_channel(output->channel);
+    return NULL;
+  }
+  output->encoder.base = (rmt_encoder_t){
+      .encode = encode_frame,
+      .reset  = reset_encoder,
+      .del    = del_encoder,
+  };
+  output->encoder.started       = false;
+  output->encoder.chunk_symbols = 0;
+
+  output->free_buffers =
+      xSemaphoreCreateCountingStatic(NUM_BUFFERS, NUM_BUFFERS,
+                                     &output->free_buffers_struct);
+
+  // the channel is only enabled last, so on failure there is nothing queued
+  //  or enabled and it can be deleted straight away
+  rmt_tx_event_callbacks_t callbacks = {.on_trans_done = on_frame_sent};
+  if (rmt_tx_register_event_callbacks(output->channel, &callbacks, output) !=
+          ESP_OK ||
+      rmt_enable(output->channel) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to start RMT output");
+    rmt_del_encoder(&output->encoder.base);
+    vSemaphoreDelete(output->free_buffers);
+    rmt_del_channel(output->channel);
+    return NULL;
+  }
+  output->next = 0;
+  return output;
+}
+
+void ws2812_rmt_deinit(tNeopixelContext ctx) {
+  ws2812_rmt_output *output = ctx;
+  rmt_tx_wait_all_done(output->channel, -1);
+  rmt_disable(output->channel);
+  rmt_del_encoder(&output->encoder.base);
+  rmt_del_channel(output->channel);
+  vSemaphoreDelete(output->free_buffers);
+}
+
+/**
+ * Copy a frame and queue it behind the one going out, if any. It is encoded
+ * as it goes out. Only blocks when both buffers are still queued, ie frames
+ * are coming faster than the strip can take them.
+ */
+void ws2812_rmt_write(tNeopixelContext ctx, const uint8_t *grb,
+                      size_t num_bytes) {
+  ws2812_rmt_output *output = ctx;
+  assert(num_bytes <= CHANNEL_MAX_BYTES);
+  xSemaphoreTake(output->free_buffers, portMAX_DELAY);
+
+  uint8_t *buffer = output->grb[output->next];
+  memcpy(buffer, grb, num_bytes);
+  rmt_transmit_config_t tx = {.loop_count = 0};
+  if (rmt_transmit(output->channel, &output->encoder.base, buffer, num_bytes,
+                   &tx) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to queue frame");
+    xSemaphoreGive(output->free_buffers);
+    return;
+  }
+  output->next = (output->next + 1) % NUM_BUFFERS;
+}
@@ -0,0 +1,130 @@
+/**
+ * Lock-free triple buffer for handing frames from the game to the display
+ */
+
+#include "frame_mailbox.h"
+
+#include <string.h>
+
+// set in `middle` when it holds a frame the consumer hasn't taken yet
+#define FRAME_MAILBOX_FRESH      0x80
+#define FRAME_MAILBOX_INDEX_MASK 0x7f
+
+void frame_mailbox_init(frame_mailbox *mb) {
+  memset(mb, 0, sizeof(*mb));
+  mb->front = 0;
+  atomic_init(&mb->middle, 1);
+  mb->back = 2;
+}
+
+/**
+ * @returns slot the producer should fill in before calling
+ * frame_mailbox_publish(). Its contents are whatever was last drawn there.
+ */
+display_frame *frame_mailbox_back(frame_mailbox *mb) {
+  return &mb->slots[mb->back];
+}
+
+/**
+ * Hand the back slot to the consumer. Never blocks; if the consumer hasn't
+ * taken the previous frame yet, that frame is dropped in favour of this one,
+ * and the presses it was first to show are carried over so their latency is
+ * still measured.
+ */
+void frame_mailbox_publish(frame_mailbox *mb) {
+  display_frame *frame  = &mb->slots[mb->back];
+  frame_input_times own = frame->input;
+
+  uint8_t prev = atomic_load_explicit(&mb->middle, memory_order_acquire);
+
+  // if the consumer takes the previous frame while this is going on, the
+  // exchange fails and this frame goes out with only its own presses
+  do {
+    frame->input = own;
+    if (prev & FRAME_MAILBOX_FRESH) {
+      uint8_t replaced = prev & FRAME_MAILBOX_INDEX_MASK;
+      frame_input_times_carry(&frame->input, &mb->slots[replaced].input);
+    }
+  } while (!atomic_compare_exchange_weak_explicit(
+      &mb->middle, &prev, mb->back | FRAME_MAILBOX_FRESH, memory_order_acq_rel,
+      memory_order_acquire));
+
+  if (prev & FRAME_MAILBOX_FRESH) {
+    mb->superseded++;
+  }
+  mb->back = prev & FRAME_MAILBOX_INDEX_MASK;
+  mb->published++;
+}
+
+/**
+ * Take the newest published frame. Never blocks.
+ * @returns frame to render, valid until the next call, or NULL if nothing
+ * new has been published since the last call
+ */
+const display_frame *frame_mailbox_take(frame_mailbox *mb) {
+  if (!(atomic_load_explicit(&mb->middle, memory_order_acquire) &
+        FRAME_MAILBOX_FRESH)) {
+    return NULL;
+  }
+  uint8_t prev =
+      atomic_exchange_explicit(&mb->middle, mb->front, memory_order_acq_rel);
+  mb->front = prev & FRAME_MAILBOX_INDEX_MASK;
+  mb->rendered++;
+  return &mb->slots[mb->front];
+}
+
+frame_mailbox_stats frame_mailbox_get_stats(const frame_mailbox *mb) {
+  return (frame_mailbox_stats){mb->published, mb->superseded, mb->rendered};
+}
+
+/**
+ * Keep the earliest of each press time in `into`, for a frame that's taking
+ * over from one that will never be drawn
+ */
+void frame_input_times_carry(frame_input_times *into,
+                             const frame_input_times *from) {
+  if (from->rx_us != 0 && (into->rx_us == 0 || from->rx_us < into->rx_us)) {
+    into->rx_us   = from->rx_us;
+    into->tick_us = from->tick_us;
+  }
+  if (from->restart_rx_us != 0 &&
+      (into->restart_rx_us == 0 || from->restart_rx_us < into->restart_rx_us)) {
+    into->restart_rx_us = from->restart_rx_us;
+  }
+}
+
+/**
+ * Cheap hash of everything that affects what a frame looks like: the board
+ * cells, falling piece, overlay, brightness, animation and text. Input
+ * timestamps aren't included. Used to
+ * skip drawing frames that would look identical to the last one.
+ */
+uint64_t display_frame_hash(const display_frame *frame) {
+  // FNV-1a, a 32-bit word at a time rather than a byte at a time
+  const uint64_t fnv_prime = 0x100000001b3ULL;
+  uint64_t hash            = 0xcbf29ce484222325ULL;
+
+  _Static_assert(sizeof(frame->board.board) % sizeof(uint32_t) == 0,
+                 "board must be a whole number of words");
+  const uint8_t *cells = (const uint8_t *)frame->board.board;
+  for (size_t i = 0; i < sizeof(frame->board.board); i += sizeof(uint32_t)) {
+    uint32_t word;
+    memcpy(&word, &cells[i], sizeof(word));
+    hash = (hash ^ word) * fnv_prime;
+  }
+  hash = (hash ^ (uint8_t)frame->piece.color) * fnv_prime;
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    hash = (hash ^ (uint8_t)frame->piece.rows[i]) * fnv_prime;
+    hash = (hash ^ (uint8_t)frame->piece.cols[i]) * fnv_prime;
+  }
+  hash = (hash ^ frame->overlay) * fnv_prime;
+  hash = (hash ^ frame->brightness) * fnv_prime;
+  hash = (hash ^ frame->anim) * fnv_prime;
+  hash = (hash ^ frame->anim_seq) * fnv_prime;
+  for (size_t i = 0; i < sizeof(frame->text) && frame->text[i] != '\0'; i++) {
+    hash = (hash ^ (uint8_t)frame->text[i]) * fnv_prime;
+  }
+  hash = (hash ^ (uint16_t)frame->text_row) * fnv_prime;
+  hash = (hash ^ (uint16_t)frame->text_col) * fnv_prime;
+  return hash;
+}
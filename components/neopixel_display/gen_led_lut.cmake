@@ -0,0 +1,60 @@
+# Generate the row/col -> LED number lookup table from the panel geometry in
+# sdkconfig. Must produce the same mapping as display_led_index_calc() in
+# neopixel_display.h.
+
+function(gen_led_lut out_file)
+  math(EXPR rows "${CONFIG_NPIX_PANEL_ROWS} * ${CONFIG_NPIX_TILES_Y}")
+  math(EXPR cols "${CONFIG_NPIX_PANEL_COLS} * ${CONFIG_NPIX_TILES_X}")
+  math(EXPR panel_pixels "${CONFIG_NPIX_PANEL_ROWS} * ${CONFIG_NPIX_PANEL_COLS}")
+  math(EXPR last_row "${rows} - 1")
+  math(EXPR last_col "${cols} - 1")
+
+  set(lut "/* Generated by gen_led_lut.cmake from sdkconfig - do not edit */\n")
+  string(APPEND lut "#include \"neopixel_display.h\"\n\n")
+  string(APPEND lut "const uint16_t display_led_lut[DISPLAY_ROWS][DISPLAY_COLS] = {\n")
+
+  foreach(row RANGE ${last_row})
+    string(APPEND lut "    {")
+    foreach(col RANGE ${last_col})
+      math(EXPR tile "(${row} / ${CONFIG_NPIX_PANEL_ROWS}) * ${CONFIG_NPIX_TILES_X} + ${col} / ${CONFIG_NPIX_PANEL_COLS}")
+      math(EXPR r "${row} % ${CONFIG_NPIX_PANEL_ROWS}")
+      math(EXPR c "${col} % ${CONFIG_NPIX_PANEL_COLS}")
+
+      if(CONFIG_NPIX_PANEL_ORIGIN_TOP_RIGHT OR CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_RIGHT)
+        math(EXPR c "${CONFIG_NPIX_PANEL_COLS} - 1 - ${c}")
+      endif()
+      if(CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_LEFT OR CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_RIGHT)
+        math(EXPR r "${CONFIG_NPIX_PANEL_ROWS} - 1 - ${r}")
+      endif()
+
+      if(CONFIG_NPIX_PANEL_ORIENTATION_COLUMNS)
+        set(major ${c})
+        set(minor ${r})
+        set(minor_len ${CONFIG_NPIX_PANEL_ROWS})
+      else()
+        set(major ${r})
+        set(minor ${c})
+        set(minor_len ${CONFIG_NPIX_PANEL_COLS})
+      endif()
+
+      math(EXPR odd "${major} % 2")
+      if(CONFIG_NPIX_PANEL_SERPENTINE AND odd)
+        math(EXPR minor "${minor_len} - 1 - ${minor}")
+      endif()
+
+      math(EXPR led "${tile} * ${panel_pixels} + ${major} * ${minor_len} + ${minor}")
+      if(col EQUAL last_col)
+        string(APPEND lut "${led}")
+      else()
+        string(APPEND lut "${led}, ")
+      endif()
+    endforeach()
+    string(APPEND lut "},  // row ${row}\n")
+  endforeach()
+  string(APPEND lut "};\n")
+
+  # only touch the file when the table changes, to avoid needless rebuilds.
+  # configure_file() rather than file(CONFIGURE), which needs CMake 3.18
+  file(WRITE ${out_file}.tmp "${lut}")
+  configure_file(${out_file}.tmp ${out_file} COPYONLY)
+endfunction()
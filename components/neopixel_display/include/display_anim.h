@@ -0,0 +1,56 @@
+#ifndef DISPLAY_ANIM_H
+#define DISPLAY_ANIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "neopixel_display.h"
+
+// animations the game can ask the render task to play
+enum display_anim_id {
+  DISPLAY_ANIM_NONE,
+  DISPLAY_ANIM_LINE_CLEAR,  // flash then wipe the cleared rows
+  DISPLAY_ANIM_GAME_OVER,   // curtain down and back up over the board
+  DISPLAY_ANIM_LEVEL_UP,    // brightness pulse
+  DISPLAY_ANIM_PAUSE,       // fade the board down, held until unpaused
+  DISPLAY_NUM_ANIMS
+};
+
+// longest keyframe table of any animation
+#define DISPLAY_ANIM_MAX_KEYFRAMES 8
+
+// keyframe flags
+#define DISPLAY_KEYFRAME_RAMP 0x01  // progress ramps linearly to the next one
+#define DISPLAY_KEYFRAME_END  0x02  // last keyframe; the effect is over
+#define DISPLAY_KEYFRAME_HOLD 0x04  // last keyframe; shown until stopped
+
+/**
+ * Effect shown from `at_ms` into the animation until the next keyframe
+ */
+typedef struct display_keyframe {
+  uint16_t at_ms;
+  uint8_t kind;  // enum display_effect_kind
+  uint8_t progress;
+  int8_t level_shift;
+  uint8_t flags;
+} display_keyframe;
+
+/**
+ * A running animation. Timing is counted in rendered frames, so it stays in
+ * step with what's actually on the panel rather than with the clock.
+ */
+typedef struct display_anim {
+  uint8_t id;        // enum display_anim_id, DISPLAY_ANIM_NONE when idle
+  uint8_t keyframe;  // index of the keyframe being shown
+  uint16_t frame;    // frames shown so far
+  int8_t rows[DISPLAY_EFFECT_MAX_ROWS];
+} display_anim;
+
+void display_anim_init(uint32_t frames_per_sec);
+void display_anim_start(display_anim *anim, uint8_t id, const int8_t *rows);
+void display_anim_stop(display_anim *anim);
+display_effect display_anim_step(display_anim *anim);
+bool display_anim_running(const display_anim *anim);
+bool display_anim_holding(const display_anim *anim);
+
+#endif
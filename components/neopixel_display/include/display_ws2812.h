@@ -0,0 +1,71 @@
+#ifndef DISPLAY_WS2812_H
+#define DISPLAY_WS2812_H
+
+/**
+ * WS2812 bitstream encoding, straight from the packed GRB framebuffer to RMT
+ * symbols.
+ *
+ * Each data bit is one 32 bit RMT symbol: a high pulse then a low pulse, laid
+ * out like rmt_symbol_word_t (duration0 in bits 0-14, level0 in bit 15,
+ * duration1 in bits 16-30, level1 in bit 31). The encoder itself doesn't
+ * touch any hardware, so it builds and is tested on the host.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neopixel.h"
+
+// RMT tick rate the symbol durations are counted in, 0.1us per tick
+#define WS2812_RESOLUTION_HZ 10000000
+
+// bit timings, in ticks
+#define WS2812_T0H_TICKS 3  // 0.3us
+#define WS2812_T0L_TICKS 9  // 0.9us
+#define WS2812_T1H_TICKS 9  // 0.9us
+#define WS2812_T1L_TICKS 3  // 0.3us
+// the strip latches once the line has been low this long; newer WS2812B
+//  need more than 280us. Split over both halves of the last symbol
+#define WS2812_RESET_TICKS 3000  // 300us
+
+#define WS2812_SYMBOL(high_ticks, low_ticks) \
+  ((uint32_t)(high_ticks) | 1u << 15 | (uint32_t)(low_ticks) << 16)
+#define WS2812_SYMBOL_ZERO  WS2812_SYMBOL(WS2812_T0H_TICKS, WS2812_T0L_TICKS)
+#define WS2812_SYMBOL_ONE   WS2812_SYMBOL(WS2812_T1H_TICKS, WS2812_T1L_TICKS)
+#define WS2812_SYMBOL_RESET               \
+  ((uint32_t)(WS2812_RESET_TICKS / 2) | \
+   (uint32_t)(WS2812_RESET_TICKS / 2) << 16)
+
+// symbols needed to send `num_bytes` of GRB data, including the reset
+#define WS2812_SYMBOLS(num_bytes) ((num_bytes) * 8 + 1)
+
+// GRB bytes encoded per chunk when a frame is encoded a piece at a time
+#define WS2812_CHUNK_BYTES   64
+#define WS2812_CHUNK_SYMBOLS WS2812_SYMBOLS(WS2812_CHUNK_BYTES)
+
+/**
+ * Position in a frame being encoded a chunk at a time, so only a chunk of
+ * symbols ever has to be held in RAM. See ws2812_encode_chunk()
+ */
+typedef struct ws2812_chunker {
+  const uint8_t *grb;
+  size_t num_bytes;
+  size_t next_byte;  // first byte not encoded yet
+  bool done;         // the reset has been encoded too
+} ws2812_chunker;
+
+size_t ws2812_encode(const uint8_t *grb, size_t num_bytes, uint32_t *symbols);
+void ws2812_chunker_init(ws2812_chunker *chunker, const uint8_t *grb,
+                         size_t num_bytes);
+size_t ws2812_encode_chunk(ws2812_chunker *chunker, uint32_t *symbols);
+uint32_t ws2812_refresh_rate(uint32_t num_pixels);
+
+// RMT output backend (display_ws2812_rmt.c), only built with
+//  CONFIG_NPIX_OUTPUT_RMT
+tNeopixelContext ws2812_rmt_init(int ch, int gpio);
+void ws2812_rmt_deinit(tNeopixelContext ctx);
+void ws2812_rmt_write(tNeopixelContext ctx, const uint8_t *grb,
+                      size_t num_bytes);
+
+#endif
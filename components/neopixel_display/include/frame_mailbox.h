@@ -0,0 +1,90 @@
+#ifndef FRAME_MAILBOX_H
+#define FRAME_MAILBOX_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "neopixel_display.h"
+#include "tetris.h"
+
+// what to draw over the board when rendering a frame
+enum display_overlay {
+  DISPLAY_OVERLAY_NONE,
+  DISPLAY_OVERLAY_PAUSE,
+  DISPLAY_OVERLAY_PLAY_AGAIN
+};
+
+// remote presses a frame is the first to show, for press-to-photon latency
+typedef struct frame_input_times {
+  // when the first remote press shown in the frame was received, and when
+  // the game applied it; both 0 if the frame isn't showing a new press
+  int64_t rx_us;
+  int64_t tick_us;
+  // when play again was pressed, if this is the first frame of the new game
+  int64_t restart_rx_us;
+} frame_input_times;
+
+// everything the render task needs to draw one frame
+typedef struct display_frame {
+  TetrisBoard board;
+  // the falling piece, which is already drawn on `board`, so it can be
+  // highlighted and its ghost shown. DISPLAY_NO_PIECE for none
+  display_piece piece;
+  uint8_t overlay;     // enum display_overlay
+  uint8_t brightness;  // palette to draw with, see set_display_brightness()
+  // animation to start, when `anim_seq` differs from the last frame drawn.
+  // Frames that leave `anim_seq` alone keep the animation running, except
+  // that one held at its last keyframe stops once `anim` changes
+  uint8_t anim;  // enum display_anim_id
+  uint8_t anim_seq;
+  int8_t anim_rows[DISPLAY_EFFECT_MAX_ROWS];
+  // line of text drawn over everything else, empty for none. Scroll it by
+  // publishing frames with a changing `text_col`
+  char text[DISPLAY_TEXT_MAX_LEN];
+  int16_t text_row;
+  int16_t text_col;
+  frame_input_times input;
+} display_frame;
+
+#define FRAME_MAILBOX_SLOTS 3
+
+/**
+ * Single-producer/single-consumer triple buffer of display frames.
+ *
+ * The producer always has a slot of its own to draw into (`back`), and the
+ * consumer always has one to render from (`front`). Publishing and taking
+ * atomically swap those with the shared `middle` slot, so neither side ever
+ * waits on the other, and the consumer always gets the newest frame.
+ */
+typedef struct frame_mailbox {
+  display_frame slots[FRAME_MAILBOX_SLOTS];
+  _Atomic uint8_t middle;  // slot index, plus FRAME_MAILBOX_FRESH if unread
+  uint8_t back;            // only touched by the producer
+  uint8_t front;           // only touched by the consumer
+
+  // each counter has a single writer; readers may see slightly stale values
+  uint32_t published;   // frames published by the producer
+  uint32_t superseded;  // frames replaced before the consumer took them
+  uint32_t rendered;    // frames taken by the consumer
+} frame_mailbox;
+
+typedef struct frame_mailbox_stats {
+  uint32_t published;
+  uint32_t superseded;
+  uint32_t rendered;
+} frame_mailbox_stats;
+
+void frame_mailbox_init(frame_mailbox *mb);
+
+display_frame *frame_mailbox_back(frame_mailbox *mb);
+void frame_mailbox_publish(frame_mailbox *mb);
+
+const display_frame *frame_mailbox_take(frame_mailbox *mb);
+
+frame_mailbox_stats frame_mailbox_get_stats(const frame_mailbox *mb);
+
+uint64_t display_frame_hash(const display_frame *frame);
+void frame_input_times_carry(frame_input_times *into,
+                             const frame_input_times *from);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef NEOPIXEL_DISPLAY_H
 #define NEOPIXEL_DISPLAY_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "neopixel.h"
@@ -9,32 +10,250 @@
 
 #define NUM_TETRIS_COLORS NUM_TETROMINOS + 1
 
-// all display masks use uint8_t, so without a refactor the widest mask that can
-//  be used is 8 cells wide
-#define DISPLAY_MASK_WIDTH 8
-// this defines the leftmost cell for masks. On implementations with larger
-// widths,
-//  this would need to be changed; for DISPLAY_COLS < 10 0 is ideal.
-#define DISPLAY_MASK_LEFTMOST_COL 0
+// scenes are composed at the board's resolution, one pixel per cell, and then
+//  scaled up onto the panels through the viewport
+#define DISPLAY_SCENE_ROWS TETRIS_ROWS
+#define DISPLAY_SCENE_COLS TETRIS_COLS
 
-// Lookup table for converting [row][col] of TetrisBoard to LEDs in the matrix.
-//  Tables of arbitrary size forcan be generated using `gen_Matrix_LUT.py`
-extern const uint8_t rowcol_to_LEDNum_LUT[32][8];
+// extra palette entry used for icons drawn over the board
+#define OVERLAY_CELL_COLOR   NUM_TETROMINOS
+#define DISPLAY_PALETTE_SIZE (NUM_TETRIS_COLORS + 1)
+
+#define DISPLAY_NUM_BRIGHTNESS_LEVELS 8
+#define DISPLAY_DEFAULT_BRIGHTNESS    4
+
+// widest sprite that can be drawn; each sprite row is one uint32_t
+#define DISPLAY_SPRITE_MAX_WIDTH 32
+
+// built-in 3x5 font, one blank column between characters
+#define DISPLAY_FONT_WIDTH   3
+#define DISPLAY_FONT_HEIGHT  5
+#define DISPLAY_FONT_ADVANCE (DISPLAY_FONT_WIDTH + 1)
+// longest HUD text, including the terminator
+#define DISPLAY_TEXT_MAX_LEN 24
+
+// cells in a tetromino
+#define DISPLAY_PIECE_CELLS 4
+// the falling piece is drawn this many brightness levels brighter than the
+//  rest of the board
+#define DISPLAY_PIECE_HIGHLIGHT_LEVELS 2
+// the ghost piece is drawn at this fraction of the board's brightness
+#define DISPLAY_GHOST_DIVISOR 4
+
+// if more cells than this changed since the last frame, the whole frame is
+//  sent instead of only the changed cells
+#define DISPLAY_FULL_REFRESH_THRESHOLD (PIXEL_COUNT / 2)
+
+// framebuffer is stored as packed GRB, the order WS2812s expect on the wire
+#define DISPLAY_BYTES_PER_PIXEL 3
+
+/**
+ * Bit-packed 1 bit per pixel image. Rows are written the way they look: the
+ * most significant of the `width` bits is the leftmost column.
+ */
+typedef struct display_sprite {
+  const uint32_t *rows;
+  uint8_t width;  // up to DISPLAY_SPRITE_MAX_WIDTH
+  uint8_t height;
+} display_sprite;
+
+/**
+ * One tetromino's cells on the display, eg the falling piece or its ghost
+ */
+typedef struct display_piece {
+  int8_t color;  // piece_colors value, BG_COLOR if there's no piece
+  int8_t rows[DISPLAY_PIECE_CELLS];
+  int8_t cols[DISPLAY_PIECE_CELLS];
+} display_piece;
+
+#define DISPLAY_NO_PIECE ((display_piece){.color = BG_COLOR})
+
+// most rows an effect can apply to; enough for a four line clear
+#define DISPLAY_EFFECT_MAX_ROWS 4
+
+enum display_effect_kind {
+  DISPLAY_EFFECT_NONE,
+  DISPLAY_EFFECT_FLASH_ROWS,  // `rows` filled with the overlay color
+  DISPLAY_EFFECT_WIPE_ROWS,   // `rows` filled, opening up from the middle
+  DISPLAY_EFFECT_CURTAIN,     // dim overlay color down from the top row
+};
+
+/**
+ * One frame of an animation (see display_anim.h), as drawn by the compositor.
+ * Zero initialized means no effect.
+ */
+typedef struct display_effect {
+  uint8_t kind;         // enum display_effect_kind
+  uint8_t progress;     // 0-255, how far a wipe or curtain has got
+  int8_t level_shift;   // brightness levels added to board, ghost and piece
+  int8_t rows[DISPLAY_EFFECT_MAX_ROWS];  // rows to flash or wipe, -1 unused
+} display_effect;
+
+/**
+ * Everything on the display, as layers drawn bottom to top: the board, the
+ * ghost of the falling piece, the falling piece highlighted, an animated
+ * effect, an overlay icon, and a line of HUD text on a blanked band.
+ * display_compose() turns a scene into LED colors.
+ */
+typedef struct display_scene {
+  const TetrisBoard *board;
+  display_piece ghost;
+  display_piece piece;
+  display_effect effect;
+  const display_sprite *overlay;  // NULL for none
+  int16_t overlay_row;
+  int16_t overlay_col;
+  const char *text;  // NULL or "" for none
+  int16_t text_row;
+  int16_t text_col;
+} display_scene;
+
+/**
+ * Where the scene sits on the display: each cell is drawn as a block of
+ * `scale` by `scale` LEDs, offset to center it, with the unused edges left
+ * dark. Scene row r covers display rows row_start[r] up to row_start[r + 1],
+ * and columns likewise, so drawing through it needs no multiplies.
+ */
+typedef struct display_viewport {
+  uint8_t scale;
+  uint16_t row_start[DISPLAY_SCENE_ROWS + 1];
+  uint16_t col_start[DISPLAY_SCENE_COLS + 1];
+} display_viewport;
+
+/**
+ * The run of LEDs, in chain order, that one output channel drives
+ */
+typedef struct display_channel_span {
+  uint16_t first_led;
+  uint16_t num_leds;
+} display_channel_span;
+
+// counters for how much the display is sending to the neopixel driver
+typedef struct display_stats {
+  uint32_t frames;                    // framebuffer commits
+  uint32_t full_refreshes;            // commits where every pixel was sent
+  uint32_t pixels_pushed_last_frame;  // pixels sent by the most recent commit
+  uint64_t pixels_pushed_total;       // pixels sent since init
+} display_stats;
+
+#if CONFIG_NPIX_MAPPING_LUT
+// Lookup table for converting [row][col] of the display to LEDs in the matrix.
+//  Generated at build time by `gen_led_lut.cmake` from the panel geometry.
+extern const uint16_t display_led_lut[DISPLAY_ROWS][DISPLAY_COLS];
+#endif
+
+/**
+ * Compute LED number for [row][col] of the display from the panel geometry.
+ * Everything but row and col is a compile-time constant, so for power of two
+ * panel sizes this reduces to a few shifts and masks.
+ */
+static inline uint16_t display_led_index_calc(uint16_t row, uint16_t col) {
+  uint16_t tile = (row / DISPLAY_PANEL_ROWS) * DISPLAY_TILES_X +
+                  col / DISPLAY_PANEL_COLS;
+  uint16_t r    = row % DISPLAY_PANEL_ROWS;
+  uint16_t c    = col % DISPLAY_PANEL_COLS;
+
+#if CONFIG_NPIX_PANEL_ORIGIN_TOP_RIGHT || CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_RIGHT
+  c = DISPLAY_PANEL_COLS - 1 - c;
+#endif
+#if CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_LEFT || \
+    CONFIG_NPIX_PANEL_ORIGIN_BOTTOM_RIGHT
+  r = DISPLAY_PANEL_ROWS - 1 - r;
+#endif
+
+#if CONFIG_NPIX_PANEL_ORIENTATION_COLUMNS
+  const uint16_t major     = c;
+  uint16_t minor           = r;
+  const uint16_t minor_len = DISPLAY_PANEL_ROWS;
+#else
+  const uint16_t major     = r;
+  uint16_t minor           = c;
+  const uint16_t minor_len = DISPLAY_PANEL_COLS;
+#endif
+
+#if CONFIG_NPIX_PANEL_SERPENTINE
+  if (major & 1) {
+    minor = minor_len - 1 - minor;
+  }
+#endif
+
+  return tile * DISPLAY_PANEL_PIXELS + major * minor_len + minor;
+}
+
+/**
+ * Convert [row][col] of the display to LED number in the matrix
+ */
+static inline uint16_t display_led_index(uint16_t row, uint16_t col) {
+#if CONFIG_NPIX_MAPPING_LUT
+  return display_led_lut[row][col];
+#else
+  return display_led_index_calc(row, col);
+#endif
+}
 
 tNeopixelContext init_neopixel_display(void);
 void deinit_neopixel_display(tNeopixelContext *neopixels);
+uint32_t get_display_refresh_rate(tNeopixelContext *neopixels);
 
 void display_board(tNeopixelContext *neopixels, const TetrisBoard *tb);
 void clear_display(tNeopixelContext *neopixels);
+void invalidate_display(void);
+display_stats get_display_stats(void);
 
 uint32_t getRGBFromCellColor(int8_t color);
 
+// palettes (display_palette.c)
+extern const uint8_t display_gamma8[256];
+// current palette, indexed by cell color (BG_COLOR through OVERLAY_CELL_COLOR)
+extern const uint32_t *active_palette;
+// palettes for the falling piece and its ghost at the current brightness,
+//  indexed the same way
+extern const uint32_t *active_piece_palette;
+extern const uint32_t *active_ghost_palette;
+
+// board, piece and ghost palettes for one brightness level
+typedef struct display_palettes {
+  const uint32_t *cells;
+  const uint32_t *piece;
+  const uint32_t *ghost;
+} display_palettes;
+
+void init_display_palettes(void);
+bool set_display_brightness(uint8_t level);
+uint8_t get_display_brightness(void);
+display_palettes get_display_palettes(int level_shift);
+
+void display_compose(tNeopixelContext *neopixels, const display_scene *scene);
+display_piece display_piece_ghost(const TetrisBoard *tb,
+                                  const display_piece *piece);
+
+void display_sprite_row(const display_sprite *sprite, int sprite_row,
+                        int left_col, uint32_t rgb, uint32_t *line);
+void display_sprite_over_board(tNeopixelContext *neopixels,
+                               const display_sprite *sprite, int top_row,
+                               int left_col);
+
+void display_scene_play_again_icon(display_scene *scene);
+void display_scene_pause_icon(display_scene *scene);
 void display_play_again_icon(tNeopixelContext *neopixels);
 void display_pause_icon(tNeopixelContext *neopixels);
 
-void printTetrisBoardToLog(TetrisBoard *tb);
+// text (display_text.c)
+int display_text_width(const char *text);
+void display_text_row(const char *text, int glyph_row, int left_col,
+                      uint32_t rgb, uint32_t *line);
+void display_text_over_board(tNeopixelContext *neopixels, const char *text,
+                             int top_row, int left_col);
+
+// viewport (display_viewport.c)
+display_viewport display_fit_viewport(int display_rows, int display_cols,
+                                      int scale);
 
-void getArrayOfBitsFromMask(const uint8_t in_mask, uint8_t *bits,
-                            const uint8_t mask_width);
+// output channels (display_channels.c)
+void display_split_channels(display_channel_span *spans, int num_channels,
+                            int num_tiles, int panel_pixels);
+bool display_span_dirty(const uint8_t *dirty_bits, display_channel_span span);
+
+void printTetrisBoardToLog(TetrisBoard *tb);
 
 #endif
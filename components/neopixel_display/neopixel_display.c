@@ -4,40 +4,147 @@
 
 #include "neopixel_display.h"
 
+#include <string.h>
+
 #include "esp_log.h"  // used for debugging info statements
 
+#if CONFIG_NPIX_OUTPUT_RMT
+#include "display_ws2812.h"
+#endif
+
 // local functions
-static void display_mask_over_board(tNeopixelContext *neopixels,
-                                    const uint8_t top_row,
-                                    const uint8_t *mask_2D,
-                                    const uint8_t mask_height,
-                                    const uint8_t leftmost_col);
-inline static tNeopixel tPixelFromCellColor(unsigned int ledNum,
-                                            int8_t tetris_cell_color);
+static inline bool board_row_changed(const int8_t *prev, const int8_t *curr);
+static inline void framebuffer_set_pixel(uint16_t ledNum, uint32_t rgb);
+static void display_commit(tNeopixelContext *neopixels);
+static void compose_row(const display_scene *scene,
+                        const display_palettes *palettes, const char *text,
+                        int row);
+static display_scene shown_scene(void);
+static bool pieces_equal(const display_piece *a, const display_piece *b);
+static void mark_rows_dirty(uint8_t *rows_dirty, int top_row, int height);
+static bool piece_fits(const TetrisBoard *tb, const display_piece *piece,
+                       int drop);
+static void mark_piece_rows_dirty(uint8_t *rows_dirty,
+                                  const display_piece *piece);
+static void mark_effect_rows_dirty(uint8_t *rows_dirty,
+                                   const display_effect *prev,
+                                   const display_effect *curr);
+static int effect_curtain_rows(const display_effect *effect);
+static void write_scene_row(int row, const uint32_t *line);
+
+// packed 24 bit GRB framebuffer in LED order - this is what the panel is
+//  showing once display_commit() has run
+static uint8_t framebuffer[PIXEL_COUNT * DISPLAY_BYTES_PER_PIXEL];
+// one bit per LED, set when the framebuffer differs from what was last sent
+static uint8_t framebuffer_dirty[(PIXEL_COUNT + 7) / 8];
+static uint16_t num_dirty      = 0;
+static bool force_full_refresh = true;
+#if !CONFIG_NPIX_OUTPUT_RMT
+// staging area for display_commit(), big enough to send a whole channel in a
+//  single neopixel_SetPixel() call; kept off the stack on purpose
+static tNeopixel commit_pixels[PIXEL_COUNT];
+#endif
+
+_Static_assert(DISPLAY_CHANNELS <= DISPLAY_NUM_TILES,
+               "every output channel needs at least one panel");
+static const int channel_pins[] = NEOPIXEL_CHANNEL_PINS;
+_Static_assert(DISPLAY_CHANNELS <= sizeof(channel_pins) / sizeof(int),
+               "not enough pins in NEOPIXEL_CHANNEL_PINS");
+// driver context and LEDs for each output channel. Channel 0's context is
+//  the one callers pass around as the display's, and until
+//  init_neopixel_display() splits the chain it drives all of it
+static tNeopixelContext channel_contexts[DISPLAY_CHANNELS];
+static display_channel_span channel_spans[DISPLAY_CHANNELS] = {
+    {.first_led = 0, .num_leds = PIXEL_COUNT}};
+
+_Static_assert(PIXEL_COUNT <= UINT16_MAX,
+               "LED numbers and dirty counts are 16 bit");
+_Static_assert(DISPLAY_ROWS >= DISPLAY_SCENE_ROWS &&
+                   DISPLAY_COLS >= DISPLAY_SCENE_COLS,
+               "the display is too small for the board");
+// where the scene lands on the display; set up by clear_display()
+static display_viewport viewport;
+
+// every layer as it was last composed into the framebuffer. Comparing a new
+//  scene against this finds which rows need composing again
+static struct {
+  TetrisBoard board;
+  display_piece ghost;
+  display_piece piece;
+  display_effect effect;
+  const display_sprite *overlay;
+  int16_t overlay_row;
+  int16_t overlay_col;
+  char text[DISPLAY_TEXT_MAX_LEN];
+  int16_t text_row;
+  int16_t text_col;
+  // only trusted once a full frame has been composed through it, and only for
+  //  the palette it was drawn with
+  bool valid;
+  const uint32_t *palette;
+} shown;
+static display_stats stats;
 
 // play_again icon shown at end of game
-static const uint8_t play_again_mask_height  = 5;
-static const uint8_t play_again_icon_mask[5] = {
+static const uint32_t play_again_icon_rows[] = {
     0b01000010, 0b01100101, 0b01110001, 0b01100010, 0b01000010};
+static const display_sprite play_again_icon = {
+    .rows = play_again_icon_rows, .width = 8, .height = 5};
+
+// pause icon: two bars with a gap between them
+static const uint32_t pause_icon_rows[] = {0b101, 0b101, 0b101, 0b101};
+static const display_sprite pause_icon = {
+    .rows = pause_icon_rows, .width = 3, .height = 4};
 
 /**
- * Initialize and clear neopixel display
+ * Initialize and clear neopixel display, with one driver per output channel
  * @returns tNeopixelContext of display
  */
 tNeopixelContext init_neopixel_display(void) {
-  tNeopixelContext neopixels = neopixel_Init(PIXEL_COUNT, NEOPIXEL_PIN);
-  if (neopixels == NULL) {
-    ESP_LOGE(TAG, "Failed to allocate tNeopixelContext!!\n");
-    assert(0 && "failed to allocate tNeoPixelContext!");
+  init_display_palettes();
+  display_split_channels(channel_spans, DISPLAY_CHANNELS, DISPLAY_NUM_TILES,
+                         DISPLAY_PANEL_PIXELS);
+  for (int ch = 0; ch < DISPLAY_CHANNELS; ch++) {
+#if CONFIG_NPIX_OUTPUT_RMT
+    channel_contexts[ch] = ws2812_rmt_init(ch, channel_pins[ch]);
+#else
+    channel_contexts[ch] =
+        neopixel_Init(channel_spans[ch].num_leds, channel_pins[ch]);
+#endif
+    if (channel_contexts[ch] == NULL) {
+      ESP_LOGE(TAG, "Failed to allocate tNeopixelContext!!\n");
+      assert(0 && "failed to allocate tNeoPixelContext!");
+    }
   }
+  tNeopixelContext neopixels = channel_contexts[0];
   clear_display(neopixels);
+  memset(&stats, 0, sizeof(stats));
   ESP_LOGI(TAG, "initialized and cleared neopixel display");
   return neopixels;
 }
 
 void deinit_neopixel_display(tNeopixelContext *neopixels) {
   clear_display(neopixels);
-  neopixel_Deinit(neopixels);
+  for (int ch = 0; ch < DISPLAY_CHANNELS; ch++) {
+    tNeopixelContext ctx = ch == 0 ? neopixels : channel_contexts[ch];
+#if CONFIG_NPIX_OUTPUT_RMT
+    ws2812_rmt_deinit(ctx);
+#else
+    neopixel_Deinit(ctx);
+#endif
+  }
+}
+
+/**
+ * @returns frames per second the panel can be refreshed at. Channels are sent
+ * in parallel, so this is set by the longest one, which is always the first.
+ */
+uint32_t get_display_refresh_rate(tNeopixelContext *neopixels) {
+#if CONFIG_NPIX_OUTPUT_RMT
+  return ws2812_refresh_rate(channel_spans[0].num_leds);
+#else
+  return neopixel_GetRefreshRate(neopixels);
+#endif
 }
 
 /**
@@ -45,210 +152,582 @@ void deinit_neopixel_display(tNeopixelContext *neopixels) {
  * @param neopixels - tNeopixelContext of display
  */
 void clear_display(tNeopixelContext *neopixels) {
-  tNeopixel pixelArr[PIXEL_COUNT];
+  viewport = display_fit_viewport(DISPLAY_ROWS, DISPLAY_COLS,
+                                  CONFIG_NPIX_VIEWPORT_SCALE);
+  // letterboxing is never drawn to, so this is the only place it's cleared
+  memset(framebuffer, 0, sizeof(framebuffer));
+  // hardware state isn't known here (eg right after init), so send everything
+  invalidate_display();
+  display_commit(neopixels);
 
-  for (int i = 0; i < PIXEL_COUNT; i++) {
-    pixelArr[i] = (tNeopixel){i, 0};
-  }
-  neopixel_SetPixel(neopixels, pixelArr, PIXEL_COUNT);
-  // so, it seems like if I try to address the same pixel more than once in the
-  // pixelArr
-  //  a lock_acquire_generic will result in an panic_abort() being called by
-  //  freertos
+  // display now matches an empty scene
+  memset(&shown, 0, sizeof(shown));
+  memset(shown.board.board, BG_COLOR, sizeof(shown.board.board));
+  shown.ghost   = DISPLAY_NO_PIECE;
+  shown.piece   = DISPLAY_NO_PIECE;
+  shown.valid   = true;
+  shown.palette = active_palette;
+}
+
+/**
+ * Force the next commit to push every pixel, eg when the panel may no longer
+ * match the framebuffer
+ */
+void invalidate_display(void) {
+  shown.valid        = false;
+  force_full_refresh = true;
 }
 
+/**
+ * Draw just the board, with nothing over it, and push it to the display
+ * @param neopixels - tNeopixelContext of display
+ * @param tb - board to display
+ */
 void display_board(tNeopixelContext *neopixels, const TetrisBoard *tb) {
-  // sanity check to make sure display is right size for board
-  assert(TETRIS_COLS == DISPLAY_COLS && TETRIS_ROWS == DISPLAY_ROWS);
+  const display_scene scene = {
+      .board = tb, .ghost = DISPLAY_NO_PIECE, .piece = DISPLAY_NO_PIECE};
+  display_compose(neopixels, &scene);
+}
+
+/**
+ * Compose every layer of `scene` into the framebuffer and push the result to
+ * the display. Only rows where some layer changed since the last call are
+ * composed, each pixel in them is resolved once from the top layer covering
+ * it, and the whole frame goes to the driver in one call, so the panel never
+ * shows a board without its overlays. Unchanged pixels aren't sent, unless
+ * more than DISPLAY_FULL_REFRESH_THRESHOLD changed, in which case the whole
+ * frame is.
+ * @param neopixels - tNeopixelContext of display
+ * @param scene - what to show
+ */
+void display_compose(tNeopixelContext *neopixels, const display_scene *scene) {
   assert(neopixels != NULL);
-  ESP_LOGD(TAG, "Displaying board\n");
+  ESP_LOGD(TAG, "Composing frame\n");
+
+  // one bit per scene row
+  uint8_t rows_dirty[(DISPLAY_SCENE_ROWS + 7) / 8] = {0};
 
-  tNeopixel pixelArr[PIXEL_COUNT] = {0};
+  // truncated the same way it will be remembered, so it compares equal
+  char text[DISPLAY_TEXT_MAX_LEN] = "";
+  if (scene->text != NULL) {
+    strncpy(text, scene->text, sizeof(text) - 1);
+  }
+
+  // after a brightness change, or during a fade, every lit cell needs its new
+  // color
+  display_palettes palettes = get_display_palettes(scene->effect.level_shift);
+  if (!shown.valid || shown.palette != palettes.cells) {
+    memset(rows_dirty, 0xff, sizeof(rows_dirty));
+  } else {
+    for (int row = 0; row < DISPLAY_SCENE_ROWS; row++) {
+      if (board_row_changed(shown.board.board[row],
+                            scene->board->board[row])) {
+        mark_rows_dirty(rows_dirty, row, 1);
+      }
+    }
+    if (!pieces_equal(&shown.ghost, &scene->ghost)) {
+      mark_piece_rows_dirty(rows_dirty, &shown.ghost);
+      mark_piece_rows_dirty(rows_dirty, &scene->ghost);
+    }
+    if (!pieces_equal(&shown.piece, &scene->piece)) {
+      mark_piece_rows_dirty(rows_dirty, &shown.piece);
+      mark_piece_rows_dirty(rows_dirty, &scene->piece);
+    }
+    if (memcmp(&shown.effect, &scene->effect, sizeof(shown.effect)) != 0) {
+      mark_effect_rows_dirty(rows_dirty, &shown.effect, &scene->effect);
+    }
+    if (shown.overlay != scene->overlay ||
+        shown.overlay_row != scene->overlay_row ||
+        shown.overlay_col != scene->overlay_col) {
+      if (shown.overlay != NULL) {
+        mark_rows_dirty(rows_dirty, shown.overlay_row, shown.overlay->height);
+      }
+      if (scene->overlay != NULL) {
+        mark_rows_dirty(rows_dirty, scene->overlay_row,
+                        scene->overlay->height);
+      }
+    }
+    if (strcmp(shown.text, text) != 0 || shown.text_row != scene->text_row ||
+        shown.text_col != scene->text_col) {
+      // text is drawn on a band one row taller than the font at each side
+      if (shown.text[0] != '\0') {
+        mark_rows_dirty(rows_dirty, shown.text_row - 1,
+                        DISPLAY_FONT_HEIGHT + 2);
+      }
+      if (text[0] != '\0') {
+        mark_rows_dirty(rows_dirty, scene->text_row - 1,
+                        DISPLAY_FONT_HEIGHT + 2);
+      }
+    }
+  }
 
-  for (int row = 0; row < DISPLAY_ROWS; row++) {
-    for (int col = 0; col < DISPLAY_COLS; col++) {
-      int ledNum = rowcol_to_LEDNum_LUT[row][col];
-      assert(ledNum < PIXEL_COUNT && "LED number out of bounds");
-      // pixelArr[ledNum] = tPixelFromCellColor(ledNum, tb->board[row][col]);
-      pixelArr[ledNum] =
-          (tNeopixel){ledNum, getRGBFromCellColor(tb->board[row][col])};
+  for (int row = 0; row < DISPLAY_SCENE_ROWS; row++) {
+    if (rows_dirty[row >> 3] & (1 << (row & 7))) {
+      compose_row(scene, &palettes, text, row);
     }
   }
-  neopixel_SetPixel(neopixels, pixelArr, PIXEL_COUNT);
+
+  if (scene->board != &shown.board) {
+    shown.board = *scene->board;
+  }
+  shown.ghost       = scene->ghost;
+  shown.piece       = scene->piece;
+  shown.effect      = scene->effect;
+  shown.overlay     = scene->overlay;
+  shown.overlay_row = scene->overlay_row;
+  shown.overlay_col = scene->overlay_col;
+  memcpy(shown.text, text, sizeof(shown.text));
+  shown.text_row = scene->text_row;
+  shown.text_col = scene->text_col;
+  shown.valid    = true;
+  shown.palette  = palettes.cells;
+
+  display_commit(neopixels);
 }
 
-inline static tNeopixel tPixelFromCellColor(unsigned int ledNum,
-                                            int8_t tetris_cell_color) {
-  tNeopixel temp = {0};
-  temp.index     = ledNum;
-  temp.rgb       = getRGBFromCellColor(tetris_cell_color);
-  return temp;
+/**
+ * Resolve one row of the display from the top down to the board, and write it
+ * to the framebuffer
+ */
+static void compose_row(const display_scene *scene,
+                        const display_palettes *palettes, const char *text,
+                        int row) {
+  uint32_t line[DISPLAY_SCENE_COLS];
+
+  for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+    line[col] = palettes->cells[scene->board->board[row][col]];
+  }
+
+  // ghost under the piece, so the piece wins once it has landed
+  const display_piece *pieces[]   = {&scene->ghost, &scene->piece};
+  const uint32_t *piece_palette[] = {palettes->ghost, palettes->piece};
+  for (int p = 0; p < 2; p++) {
+    if (pieces[p]->color == BG_COLOR) {
+      continue;
+    }
+    for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+      int col = pieces[p]->cols[i];
+      if (pieces[p]->rows[i] == row && col >= 0 && col < DISPLAY_SCENE_COLS) {
+        line[col] = piece_palette[p][pieces[p]->color];
+      }
+    }
+  }
+
+  const display_effect *effect = &scene->effect;
+  bool effect_row              = false;
+  for (int i = 0; i < DISPLAY_EFFECT_MAX_ROWS; i++) {
+    effect_row |= effect->rows[i] == row;
+  }
+  if (effect->kind == DISPLAY_EFFECT_FLASH_ROWS && effect_row) {
+    for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+      line[col] = active_palette[OVERLAY_CELL_COLOR];
+    }
+  } else if (effect->kind == DISPLAY_EFFECT_WIPE_ROWS && effect_row) {
+    // the board shows through a gap that grows from the middle
+    int gap   = (DISPLAY_SCENE_COLS * effect->progress + 254) / 255;
+    int left  = (DISPLAY_SCENE_COLS - gap) / 2;
+    int right = left + gap;
+    for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+      if (col < left || col >= right) {
+        line[col] = active_palette[OVERLAY_CELL_COLOR];
+      }
+    }
+  } else if (effect->kind == DISPLAY_EFFECT_CURTAIN &&
+             row < effect_curtain_rows(effect)) {
+    for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+      line[col] = active_ghost_palette[OVERLAY_CELL_COLOR];
+    }
+  }
+
+  if (scene->overlay != NULL) {
+    int sprite_row = row - scene->overlay_row;
+    if (sprite_row >= 0 && sprite_row < scene->overlay->height) {
+      display_sprite_row(scene->overlay, sprite_row, scene->overlay_col,
+                         active_palette[OVERLAY_CELL_COLOR], line);
+    }
+  }
+
+  // blank a band behind the text so it's readable over a full board
+  int glyph_row = row - scene->text_row;
+  if (text[0] != '\0' && glyph_row >= -1 && glyph_row <= DISPLAY_FONT_HEIGHT) {
+    for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+      line[col] = active_palette[BG_COLOR];
+    }
+    if (glyph_row >= 0 && glyph_row < DISPLAY_FONT_HEIGHT) {
+      display_text_row(text, glyph_row, scene->text_col,
+                       active_palette[OVERLAY_CELL_COLOR], line);
+    }
+  }
+
+  write_scene_row(row, line);
 }
 
-void display_play_again_icon(tNeopixelContext *neopixels) {
-  display_mask_over_board(neopixels, 2, play_again_icon_mask,
-                          play_again_mask_height, DISPLAY_MASK_LEFTMOST_COL);
+/**
+ * Scale one composed row of the scene up through the viewport into the
+ * framebuffer. Each cell is a block of viewport.scale LEDs square, found from
+ * the span tables, so this is only ever a fill.
+ */
+static void write_scene_row(int row, const uint32_t *line) {
+  for (int y = viewport.row_start[row]; y < viewport.row_start[row + 1]; y++) {
+    for (int col = 0; col < DISPLAY_SCENE_COLS; col++) {
+      for (int x = viewport.col_start[col]; x < viewport.col_start[col + 1];
+           x++) {
+        uint16_t ledNum = display_led_index(y, x);
+        assert(ledNum < PIXEL_COUNT && "LED number out of bounds");
+        framebuffer_set_pixel(ledNum, line[col]);
+      }
+    }
+  }
 }
 
 /**
- * Draw pause icon on display when game is paused.
- * @note function is adaptable to larger screen widths
+ * Write a NP_RGB() color into the framebuffer, marking the LED dirty if its
+ * color changed
  */
-void display_pause_icon(tNeopixelContext *neopixels) {
-  const uint8_t pause_icon_starting_height = 3;
-  const uint8_t pause_icon_height          = 4;
-  const uint8_t mid_col                    = DISPLAY_COLS / 2;
-  tNeopixel Lpixel                         = {0};
-  tNeopixel Rpixel                         = {0};
-
-  for (int i = pause_icon_starting_height;
-       i < pause_icon_height + pause_icon_starting_height; i++) {
-    Lpixel =
-        (tNeopixel){rowcol_to_LEDNum_LUT[i][mid_col - 1], NP_RGB(50, 50, 50)};
-    Rpixel =
-        (tNeopixel){rowcol_to_LEDNum_LUT[i][mid_col + 1], NP_RGB(50, 50, 50)};
-    neopixel_SetPixel(neopixels, &Lpixel, 1);
-    neopixel_SetPixel(neopixels, &Rpixel, 1);
+static inline void framebuffer_set_pixel(uint16_t ledNum, uint32_t rgb) {
+  uint8_t *px = &framebuffer[ledNum * DISPLAY_BYTES_PER_PIXEL];
+  uint8_t g   = (rgb >> 8) & 0xff;
+  uint8_t r   = (rgb >> 16) & 0xff;
+  uint8_t b   = rgb & 0xff;
+
+  if (px[0] == g && px[1] == r && px[2] == b) {
+    return;
+  }
+  px[0] = g;
+  px[1] = r;
+  px[2] = b;
+
+  uint8_t bit = 1 << (ledNum & 7);
+  if (!(framebuffer_dirty[ledNum >> 3] & bit)) {
+    framebuffer_dirty[ledNum >> 3] |= bit;
+    num_dirty++;
   }
 }
 
 /**
- * Overlay symbols represented by bitmask over board contents (eg pause symbol)
+ * Single path from the framebuffer to the LEDs, so the panel only ever updates
+ * with a whole frame. Each output channel is sent on its own, and only if
+ * something on its panels changed.
  *
- * @param *neopixels tNeopixelContext   - neopixel context (display pixels)
- * @param top_row uint8_t               - row to start drawing at
- * @param mask_2D uint8_t                  - mask to overlay. A ptr to an array
- * of 8 bit uints, which are used bitwise as the mask
- * @param mask_height uint8_t           - number of rows in mask
- * @param leftmost_col uint8_t          - leftmost column of mask (for displays
- * wider than 8 bits, otherwise just 0)
+ * With the neopixel driver, a channel's dirty LEDs are converted back to
+ * tNeopixel and handed over in one neopixel_SetPixel() call. Every LED index
+ * appears at most once per call. With CONFIG_NPIX_OUTPUT_RMT the framebuffer
+ * is already in wire order, so a channel's slice of it is encoded to RMT
+ * symbols as it is, and the channel's whole chain goes out.
  */
-static void display_mask_over_board(tNeopixelContext *neopixels,
-                                    const uint8_t top_row,
-                                    const uint8_t *mask_2D,
-                                    const uint8_t mask_height,
-                                    const uint8_t leftmost_col) {
-  // make sure leftmost_col value isn't out of range for this display
-  assert((leftmost_col == 0 && DISPLAY_COLS < 10) || DISPLAY_COLS >= 10);
-
-  uint8_t curr_row = top_row;
-  uint8_t bits[DISPLAY_MASK_WIDTH];
-
-  // largest possible pixelArr needed
-  tNeopixel pixelArr[DISPLAY_COLS * mask_height];
-  uint16_t num_bits_set = 0;
-
-  assert(mask_height < DISPLAY_ROWS);
-  // for each row in mask
-  // for(int row = top_row; row < top_row + mask_height; row++) {
-  for (int i = 0; i < mask_height; i++) {
-    curr_row = top_row + i;
-
-    // get bitmask for this row
-    getArrayOfBitsFromMask(mask_2D[i], bits, DISPLAY_MASK_WIDTH);
-    // for each bit in mask
-    for (int col = leftmost_col; col < leftmost_col + DISPLAY_MASK_WIDTH;
-         col++) {
-      // if bit is present, add to pixelArr
-      if (bits[col]) {
-        // set current end of pixelArr accordingly
-        pixelArr[num_bits_set] = (tNeopixel){
-            rowcol_to_LEDNum_LUT[curr_row][col], NP_RGB(100, 100, 100)};
-        num_bits_set++;
+static void display_commit(tNeopixelContext *neopixels) {
+  bool full_refresh =
+      force_full_refresh || num_dirty > DISPLAY_FULL_REFRESH_THRESHOLD;
+  uint16_t num_pushed = 0;
+
+  for (int ch = 0; ch < DISPLAY_CHANNELS; ch++) {
+    const display_channel_span span = channel_spans[ch];
+    uint16_t num_sent               = 0;
+
+    tNeopixelContext ctx = ch == 0 ? neopixels : channel_contexts[ch];
+#if CONFIG_NPIX_OUTPUT_RMT
+    if (full_refresh || display_span_dirty(framebuffer_dirty, span)) {
+      ws2812_rmt_write(ctx,
+                       &framebuffer[span.first_led * DISPLAY_BYTES_PER_PIXEL],
+                       span.num_leds * DISPLAY_BYTES_PER_PIXEL);
+      num_sent = span.num_leds;
+    }
+#else
+    for (uint16_t ledNum = span.first_led;
+         ledNum < span.first_led + span.num_leds; ledNum++) {
+      if (!full_refresh &&
+          !(framebuffer_dirty[ledNum >> 3] & (1 << (ledNum & 7)))) {
+        continue;
       }
+      const uint8_t *px       = &framebuffer[ledNum * DISPLAY_BYTES_PER_PIXEL];
+      commit_pixels[num_sent] = (tNeopixel){ledNum - span.first_led,
+                                            NP_RGB(px[1], px[0], px[2])};
+      num_sent++;
     }
+    if (num_sent > 0) {
+      neopixel_SetPixel(ctx, commit_pixels, num_sent);
+    }
+#endif
+    num_pushed += num_sent;
   }
 
-  neopixel_SetPixel(neopixels, pixelArr, num_bits_set);
+  memset(framebuffer_dirty, 0, sizeof(framebuffer_dirty));
+  num_dirty          = 0;
+  force_full_refresh = false;
+
+  stats.frames++;
+  if (num_pushed == PIXEL_COUNT) {
+    stats.full_refreshes++;
+  }
+  stats.pixels_pushed_last_frame = num_pushed;
+  stats.pixels_pushed_total += num_pushed;
 }
 
 /**
- * Converts bitwise contents of 1D `mask` to an array *bits
- * @param in_mask const uint8_t - single uint8_t holding 8 columns
- * @param *bits - resulting bit array result
- * @param mask_width - width of mask - limited by datatype
- *
+ * Compare one row of the board against the last one composed. A row of 8 int8_t
+ * cells fits in a single 64 bit word, so it's compared in one go.
+ */
+static inline bool board_row_changed(const int8_t *prev, const int8_t *curr) {
+#if DISPLAY_SCENE_COLS == 8
+  uint64_t prev_word, curr_word;
+  memcpy(&prev_word, prev, sizeof(prev_word));
+  memcpy(&curr_word, curr, sizeof(curr_word));
+  return prev_word != curr_word;
+#else
+  return memcmp(prev, curr, DISPLAY_SCENE_COLS) != 0;
+#endif
+}
+
+/**
+ * @returns counters for pixels pushed to the display by display_board()
+ */
+display_stats get_display_stats(void) { return stats; }
+
+/**
+ * Put the play again icon in the overlay layer of `scene`
+ */
+void display_scene_play_again_icon(display_scene *scene) {
+  scene->overlay     = &play_again_icon;
+  scene->overlay_row = 2;
+  scene->overlay_col = (DISPLAY_SCENE_COLS - play_again_icon.width) / 2;
+}
+
+/**
+ * Put the pause icon in the overlay layer of `scene`
+ * @note function is adaptable to larger screen widths
  */
-inline void getArrayOfBitsFromMask(const uint8_t in_mask, uint8_t *bits,
-                                   const uint8_t mask_width) {
-  uint8_t mask = in_mask;
+void display_scene_pause_icon(display_scene *scene) {
+  scene->overlay     = &pause_icon;
+  scene->overlay_row = 3;
+  scene->overlay_col = DISPLAY_SCENE_COLS / 2 - 1;
+}
+
+/**
+ * Draw play again icon over what's on the display at end of game
+ */
+void display_play_again_icon(tNeopixelContext *neopixels) {
+  display_scene scene = shown_scene();
+  display_scene_play_again_icon(&scene);
+  display_compose(neopixels, &scene);
+}
+
+/**
+ * Draw pause icon over what's on the display when game is paused
+ */
+void display_pause_icon(tNeopixelContext *neopixels) {
+  display_scene scene = shown_scene();
+  display_scene_pause_icon(&scene);
+  display_compose(neopixels, &scene);
+}
 
-  for (int8_t bit = mask_width - 1; bit >= 0; bit--) {
-    bits[bit] = mask & 1;
-    mask >>= 1;
+/**
+ * Draw a sprite over what's on the display in the overlay color, replacing
+ * any icon already there
+ */
+void display_sprite_over_board(tNeopixelContext *neopixels,
+                               const display_sprite *sprite, int top_row,
+                               int left_col) {
+  display_scene scene = shown_scene();
+  scene.overlay       = sprite;
+  scene.overlay_row   = top_row;
+  scene.overlay_col   = left_col;
+  display_compose(neopixels, &scene);
+}
+
+/**
+ * Draw text over what's on the display in the overlay color, replacing any
+ * text already there. Scroll text by calling again with a different
+ * `left_col`.
+ */
+void display_text_over_board(tNeopixelContext *neopixels, const char *text,
+                             int top_row, int left_col) {
+  display_scene scene = shown_scene();
+  scene.text          = text;
+  scene.text_row      = top_row;
+  scene.text_col      = left_col;
+  display_compose(neopixels, &scene);
+}
+
+/**
+ * Draw one row of a sprite into a line of pixels, clipped to the display.
+ * Only the set bits of the row are visited, found with count trailing zeros,
+ * so sparse sprites cost next to nothing.
+ * @param sprite_row - row of the sprite to draw
+ * @param left_col - column of the sprite's left edge; may be off the display
+ * @param rgb - NP_RGB() color for set bits. Clear bits are transparent.
+ * @param line - DISPLAY_SCENE_COLS pixels to draw into
+ */
+void display_sprite_row(const display_sprite *sprite, int sprite_row,
+                        int left_col, uint32_t rgb, uint32_t *line) {
+  assert(sprite->width <= DISPLAY_SPRITE_MAX_WIDTH);
+  assert(sprite_row >= 0 && sprite_row < sprite->height);
+
+  // bit k of a row lands in column left_col + (width - 1 - k); keep only the
+  // bits that land on the display
+  int lowest_bit  = left_col + sprite->width - DISPLAY_SCENE_COLS;
+  int highest_bit = left_col + sprite->width - 1;
+  lowest_bit      = lowest_bit < 0 ? 0 : lowest_bit;
+  highest_bit     = highest_bit >= sprite->width ? sprite->width - 1
+                                                 : highest_bit;
+  if (lowest_bit > highest_bit) {
+    return;
+  }
+  uint32_t clip = (uint32_t)(((1ULL << (highest_bit + 1)) - 1) &
+                             ~((1ULL << lowest_bit) - 1));
+
+  for (uint32_t bits = sprite->rows[sprite_row] & clip; bits != 0;
+       bits &= bits - 1) {
+    line[left_col + sprite->width - 1 - __builtin_ctz(bits)] = rgb;
   }
 }
 
 /**
- * Match tetris's `piece_colors` enum to 32bit neopixel color values
- * @param color - value stored in TetrisBoard Cell
+ * Where `piece` would come to rest if dropped straight down `tb`, for drawing
+ * as a ghost. `tb` is expected to already have the piece drawn on it.
+ * @returns DISPLAY_NO_PIECE if there's no piece, or it can't drop at all
  */
-inline uint32_t getRGBFromCellColor(int8_t color) {
-  switch (color) {
-    case S_CELL_COLOR:
-      return NP_RGB(0, 50, 0);  // Green
-    case Z_CELL_COLOR:
-      return NP_RGB(50, 0, 0);  // Red
-    case T_CELL_COLOR:
-      return NP_RGB(50, 0, 50);  // Magenta
-    case L_CELL_COLOR:
-      return NP_RGB(50, 25, 0);  // Orange
-    case J_CELL_COLOR:
-      return NP_RGB(0, 0, 50);  // Blue
-    case SQ_CELL_COLOR:
-      return NP_RGB(50, 50, 0);  // Yellow
-    case I_CELL_COLOR:
-      return NP_RGB(0, 50, 50);  // light blue
-    case BG_COLOR:
-      return NP_RGB(0, 0, 0);  // background - off
-    default:
-      assert(0 && "default case of getRGB should never be reached!");
+display_piece display_piece_ghost(const TetrisBoard *tb,
+                                  const display_piece *piece) {
+  if (piece->color == BG_COLOR) {
+    return DISPLAY_NO_PIECE;
+  }
+
+  int drop = 0;
+  while (piece_fits(tb, piece, drop + 1)) {
+    drop++;
+  }
+  if (drop == 0) {
+    return DISPLAY_NO_PIECE;
   }
+
+  display_piece ghost = *piece;
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    ghost.rows[i] += drop;
+  }
+  return ghost;
 }
 
-// these LUTs and bitmasks are only valid for 8bit wide matrices.
-//      Matrices of other sizes would require different constants.
-#if DISPLAY_COLS == 8
+/**
+ * Whether `piece` moved down `drop` rows would only cover empty cells, or
+ * cells of the piece itself
+ */
+static bool piece_fits(const TetrisBoard *tb, const display_piece *piece,
+                       int drop) {
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    int row = piece->rows[i] + drop;
+    int col = piece->cols[i];
+    if (row >= DISPLAY_SCENE_ROWS || col < 0 || col >= DISPLAY_SCENE_COLS) {
+      return false;
+    }
+    if (row < 0 || tb->board[row][col] == BG_COLOR) {
+      continue;
+    }
+    bool own_cell = false;
+    for (int j = 0; j < DISPLAY_PIECE_CELLS; j++) {
+      own_cell |= piece->rows[j] == row && piece->cols[j] == col;
+    }
+    if (!own_cell) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static display_scene shown_scene(void) {
+  return (display_scene){
+      .board       = &shown.board,
+      .ghost       = shown.ghost,
+      .piece       = shown.piece,
+      .effect      = shown.effect,
+      .overlay     = shown.overlay,
+      .overlay_row = shown.overlay_row,
+      .overlay_col = shown.overlay_col,
+      .text        = shown.text,
+      .text_row    = shown.text_row,
+      .text_col    = shown.text_col,
+  };
+}
+
+static bool pieces_equal(const display_piece *a, const display_piece *b) {
+  if (a->color == BG_COLOR || b->color == BG_COLOR) {
+    return a->color == b->color;
+  }
+  return a->color == b->color &&
+         memcmp(a->rows, b->rows, sizeof(a->rows)) == 0 &&
+         memcmp(a->cols, b->cols, sizeof(a->cols)) == 0;
+}
+
+static void mark_rows_dirty(uint8_t *rows_dirty, int top_row, int height) {
+  for (int row = top_row; row < top_row + height; row++) {
+    if (row >= 0 && row < DISPLAY_SCENE_ROWS) {
+      rows_dirty[row >> 3] |= 1 << (row & 7);
+    }
+  }
+}
+
+static void mark_piece_rows_dirty(uint8_t *rows_dirty,
+                                  const display_piece *piece) {
+  if (piece->color == BG_COLOR) {
+    return;
+  }
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    mark_rows_dirty(rows_dirty, piece->rows[i], 1);
+  }
+}
 
 /**
- * Convert [row][col] to LED number in 32x8 matrix
+ * Mark the rows where going from effect `prev` to `curr` can change anything.
+ * A moving curtain only touches the rows between its old and new edge.
  */
-const uint8_t rowcol_to_LEDNum_LUT[32][8] = {
-    {7, 6, 5, 4, 3, 2, 1, 0},                  // row 0
-    {8, 9, 10, 11, 12, 13, 14, 15},            // row 1
-    {23, 22, 21, 20, 19, 18, 17, 16},          // row 2
-    {24, 25, 26, 27, 28, 29, 30, 31},          // row 3
-    {39, 38, 37, 36, 35, 34, 33, 32},          // row 4
-    {40, 41, 42, 43, 44, 45, 46, 47},          // row 5
-    {55, 54, 53, 52, 51, 50, 49, 48},          // row 6
-    {56, 57, 58, 59, 60, 61, 62, 63},          // row 7
-    {71, 70, 69, 68, 67, 66, 65, 64},          // row 8
-    {72, 73, 74, 75, 76, 77, 78, 79},          // row 9
-    {87, 86, 85, 84, 83, 82, 81, 80},          // row 10
-    {88, 89, 90, 91, 92, 93, 94, 95},          // row 11
-    {103, 102, 101, 100, 99, 98, 97, 96},      // row 12
-    {104, 105, 106, 107, 108, 109, 110, 111},  // row 13
-    {119, 118, 117, 116, 115, 114, 113, 112},  // row 14
-    {120, 121, 122, 123, 124, 125, 126, 127},  // row 15
-    {135, 134, 133, 132, 131, 130, 129, 128},  // row 16
-    {136, 137, 138, 139, 140, 141, 142, 143},  // row 17
-    {151, 150, 149, 148, 147, 146, 145, 144},  // row 18
-    {152, 153, 154, 155, 156, 157, 158, 159},  // row 19
-    {167, 166, 165, 164, 163, 162, 161, 160},  // row 20
-    {168, 169, 170, 171, 172, 173, 174, 175},  // row 21
-    {183, 182, 181, 180, 179, 178, 177, 176},  // row 22
-    {184, 185, 186, 187, 188, 189, 190, 191},  // row 23
-    {199, 198, 197, 196, 195, 194, 193, 192},  // row 24
-    {200, 201, 202, 203, 204, 205, 206, 207},  // row 25
-    {215, 214, 213, 212, 211, 210, 209, 208},  // row 26
-    {216, 217, 218, 219, 220, 221, 222, 223},  // row 27
-    {231, 230, 229, 228, 227, 226, 225, 224},  // row 28
-    {232, 233, 234, 235, 236, 237, 238, 239},  // row 29
-    {247, 246, 245, 244, 243, 242, 241, 240},  // row 30
-    {248, 249, 250, 251, 252, 253, 254, 255},  // row 31
-};
+static void mark_effect_rows_dirty(uint8_t *rows_dirty,
+                                   const display_effect *prev,
+                                   const display_effect *curr) {
+  if (prev->level_shift != curr->level_shift) {
+    mark_rows_dirty(rows_dirty, 0, DISPLAY_SCENE_ROWS);
+    return;
+  }
+  if (prev->kind == DISPLAY_EFFECT_CURTAIN &&
+      curr->kind == DISPLAY_EFFECT_CURTAIN) {
+    int prev_rows = effect_curtain_rows(prev);
+    int curr_rows = effect_curtain_rows(curr);
+    int top       = prev_rows < curr_rows ? prev_rows : curr_rows;
+    mark_rows_dirty(rows_dirty, top, prev_rows + curr_rows - 2 * top);
+    return;
+  }
 
-#endif
+  const display_effect *effects[] = {prev, curr};
+  for (int e = 0; e < 2; e++) {
+    switch (effects[e]->kind) {
+      case DISPLAY_EFFECT_FLASH_ROWS:
+      case DISPLAY_EFFECT_WIPE_ROWS:
+        for (int i = 0; i < DISPLAY_EFFECT_MAX_ROWS; i++) {
+          mark_rows_dirty(rows_dirty, effects[e]->rows[i], 1);
+        }
+        break;
+      case DISPLAY_EFFECT_CURTAIN:
+        mark_rows_dirty(rows_dirty, 0, effect_curtain_rows(effects[e]));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// rows covered by a curtain effect, counting down from the top
+static int effect_curtain_rows(const display_effect *effect) {
+  return (DISPLAY_SCENE_ROWS * effect->progress + 254) / 255;
+}
+
+/**
+ * Match tetris's `piece_colors` enum to 32bit neopixel color values, using the
+ * palette for the current brightness
+ * @param color - value stored in TetrisBoard Cell, or OVERLAY_CELL_COLOR
+ */
+uint32_t getRGBFromCellColor(int8_t color) {
+  assert(color >= BG_COLOR && color <= OVERLAY_CELL_COLOR &&
+         "invalid cell color passed to getRGB");
+  return active_palette[color];
+}
 
 /**
  * Print board state to stdout. Used in main at end of game
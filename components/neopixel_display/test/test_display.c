@@ -24,7 +24,6 @@
 static const int8_t example_board[32][8];
 static void setRingFromOutsideToColor(TetrisBoard *tb,
                                       uint8_t rings_from_outside, int8_t color);
-void printArrayContents(const uint8_t *array, const uint8_t length);
 
 // allow iterating through cell colors
 const int8_t all_cell_colors[NUM_TETRIS_COLORS] = {
@@ -43,35 +42,171 @@ void tearDown(void) { neopixel_Deinit(neopixels); }
 ////////////////////////////////////////
 // internal tests
 ////////////////////////////////////////
+#define RED(rgb)   (((rgb) >> 16) & 0xff)
+#define GREEN(rgb) (((rgb) >> 8) & 0xff)
+#define BLUE(rgb)  ((rgb) & 0xff)
+
 TEST_CASE("test getRGBFromCellColor", "[display]") {
-  // for each cell color
-  TEST_ASSERT_EQUAL(NP_RGB(0, 50, 0), getRGBFromCellColor(S_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(50, 0, 0), getRGBFromCellColor(Z_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(50, 0, 50), getRGBFromCellColor(T_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(50, 25, 0), getRGBFromCellColor(L_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(0, 0, 50), getRGBFromCellColor(J_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(50, 50, 0), getRGBFromCellColor(SQ_CELL_COLOR));
-  TEST_ASSERT_EQUAL(NP_RGB(0, 50, 50), getRGBFromCellColor(I_CELL_COLOR));
+  init_display_palettes();
+  set_display_brightness(DISPLAY_DEFAULT_BRIGHTNESS);
+
+  // for each cell color, check only the expected channels are lit
+  uint32_t green = getRGBFromCellColor(S_CELL_COLOR);
+  TEST_ASSERT_EQUAL(NP_RGB(0, GREEN(green), 0), green);
+  TEST_ASSERT_GREATER_THAN(0, GREEN(green));
+  uint32_t red = getRGBFromCellColor(Z_CELL_COLOR);
+  TEST_ASSERT_EQUAL(NP_RGB(RED(red), 0, 0), red);
+  TEST_ASSERT_GREATER_THAN(0, RED(red));
+  uint32_t magenta = getRGBFromCellColor(T_CELL_COLOR);
+  TEST_ASSERT_EQUAL(NP_RGB(RED(red), 0, RED(red)), magenta);
+  uint32_t orange = getRGBFromCellColor(L_CELL_COLOR);
+  TEST_ASSERT_EQUAL(RED(red), RED(orange));
+  TEST_ASSERT_LESS_THAN(RED(orange), GREEN(orange));
+  TEST_ASSERT_EQUAL(0, BLUE(orange));
+  uint32_t blue = getRGBFromCellColor(J_CELL_COLOR);
+  TEST_ASSERT_EQUAL(NP_RGB(0, 0, BLUE(blue)), blue);
+  TEST_ASSERT_GREATER_THAN(0, BLUE(blue));
+  TEST_ASSERT_EQUAL(NP_RGB(RED(red), GREEN(green), 0),
+                    getRGBFromCellColor(SQ_CELL_COLOR));
+  TEST_ASSERT_EQUAL(NP_RGB(0, GREEN(green), BLUE(blue)),
+                    getRGBFromCellColor(I_CELL_COLOR));
   TEST_ASSERT_EQUAL(NP_RGB(0, 0, 0), getRGBFromCellColor(BG_COLOR));
 }
 
-TEST_CASE("Test getArrayOfBitsFromMask", "[internal]") {
-#define MASK_WIDTH 8
+TEST_CASE("test brightness levels", "[display]") {
+  init_display_palettes();
+  set_display_brightness(0);
+  uint32_t prev = getRGBFromCellColor(S_CELL_COLOR);
+
+  for (int level = 1; level < DISPLAY_NUM_BRIGHTNESS_LEVELS; level++) {
+    TEST_ASSERT_TRUE(set_display_brightness(level));
+    uint32_t curr = getRGBFromCellColor(S_CELL_COLOR);
+    TEST_ASSERT_GREATER_THAN(GREEN(prev), GREEN(curr));
+    TEST_ASSERT_EQUAL(NP_RGB(0, 0, 0), getRGBFromCellColor(BG_COLOR));
+    prev = curr;
+  }
+  // full brightness is full scale after gamma too
+  TEST_ASSERT_EQUAL(NP_RGB(0, 255, 0), prev);
+
+  // out of range and unchanged levels are ignored
+  TEST_ASSERT_FALSE(set_display_brightness(DISPLAY_NUM_BRIGHTNESS_LEVELS));
+  TEST_ASSERT_FALSE(set_display_brightness(DISPLAY_NUM_BRIGHTNESS_LEVELS - 1));
+  set_display_brightness(DISPLAY_DEFAULT_BRIGHTNESS);
+}
+
+TEST_CASE("test gamma table", "[internal]") {
+  TEST_ASSERT_EQUAL_UINT8(0, display_gamma8[0]);
+  TEST_ASSERT_EQUAL_UINT8(255, display_gamma8[255]);
+  for (int i = 1; i < 256; i++) {
+    TEST_ASSERT_TRUE(display_gamma8[i] >= display_gamma8[i - 1]);
+  }
+}
+
+#if CONFIG_NPIX_PANEL_ORIGIN_TOP_RIGHT && CONFIG_NPIX_PANEL_SERPENTINE && \
+    CONFIG_NPIX_PANEL_ORIENTATION_ROWS && DISPLAY_ROWS == 32 && DISPLAY_COLS == 8
+TEST_CASE("test display_led_index for 8x32 panel", "[internal]") {
+  TEST_ASSERT_EQUAL_UINT16(TOP_RIGHT_LED, display_led_index(0, 7));
+  TEST_ASSERT_EQUAL_UINT16(TOP_LEFT_LED, display_led_index(0, 0));
+  TEST_ASSERT_EQUAL_UINT16(BOT_RIGHT_LED, display_led_index(31, 7));
+  TEST_ASSERT_EQUAL_UINT16(BOT_LEFT_LED, display_led_index(31, 0));
+  // second row runs the other way
+  TEST_ASSERT_EQUAL_UINT16(8, display_led_index(1, 0));
+  TEST_ASSERT_EQUAL_UINT16(15, display_led_index(1, 7));
+}
+#endif
+
+TEST_CASE("test display_led_index is a permutation", "[internal]") {
+  static uint8_t seen[PIXEL_COUNT];
+  memset(seen, 0, sizeof(seen));
+
+  for (int row = 0; row < DISPLAY_ROWS; row++) {
+    for (int col = 0; col < DISPLAY_COLS; col++) {
+      uint16_t led = display_led_index(row, col);
+      TEST_ASSERT_LESS_THAN(PIXEL_COUNT, led);
+      TEST_ASSERT_EQUAL_UINT8(0, seen[led]);
+      seen[led] = 1;
+#if CONFIG_NPIX_MAPPING_LUT
+      TEST_ASSERT_EQUAL_UINT16(display_led_index_calc(row, col), led);
+#endif
+    }
+  }
+}
+
+TEST_CASE("test display_text_width", "[internal]") {
+  TEST_ASSERT_EQUAL_INT(0, display_text_width(""));
+  TEST_ASSERT_EQUAL_INT(DISPLAY_FONT_WIDTH, display_text_width("A"));
+  // one blank column between characters, none after the last
+  TEST_ASSERT_EQUAL_INT(3 * DISPLAY_FONT_ADVANCE - 1,
+                        display_text_width("L 9"));
+}
+
+TEST_CASE("test display_piece_ghost", "[internal]") {
+  TetrisBoard tb = init_board();
+  // vertical I piece in column 2, above a block in the same column
+  display_piece piece = {.color = I_CELL_COLOR,
+                         .rows  = {0, 1, 2, 3},
+                         .cols  = {2, 2, 2, 2}};
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    tb.board[piece.rows[i]][piece.cols[i]] = I_CELL_COLOR;
+  }
+  tb.board[20][2] = Z_CELL_COLOR;
+
+  display_piece ghost = display_piece_ghost(&tb, &piece);
+  TEST_ASSERT_EQUAL_INT8(I_CELL_COLOR, ghost.color);
+  TEST_ASSERT_EQUAL_INT8(16, ghost.rows[0]);
+  TEST_ASSERT_EQUAL_INT8(19, ghost.rows[3]);
+  TEST_ASSERT_EQUAL_INT8(2, ghost.cols[3]);
+
+  // without the block it lands on the floor
+  tb.board[20][2] = BG_COLOR;
+  ghost           = display_piece_ghost(&tb, &piece);
+  TEST_ASSERT_EQUAL_INT8(DISPLAY_ROWS - 1, ghost.rows[3]);
+
+  // no ghost for a piece that's already resting, or no piece at all
+  tb.board[4][2] = Z_CELL_COLOR;
+  TEST_ASSERT_EQUAL_INT8(BG_COLOR, display_piece_ghost(&tb, &piece).color);
+  TEST_ASSERT_EQUAL_INT8(BG_COLOR,
+                         display_piece_ghost(&tb, &DISPLAY_NO_PIECE).color);
+}
+
+TEST_CASE("display_board only pushes changed cells", "[display]") {
+  TetrisBoard tb = init_board();
+  clear_display(neopixels);
+
+  // display was just cleared, so an empty board shouldn't send anything
+  display_board(neopixels, &tb);
+  TEST_ASSERT_EQUAL_UINT32(0, get_display_stats().pixels_pushed_last_frame);
+
+  tb.board[10][3] = T_CELL_COLOR;
+  tb.board[11][3] = T_CELL_COLOR;
+  display_board(neopixels, &tb);
+  TEST_ASSERT_EQUAL_UINT32(2, get_display_stats().pixels_pushed_last_frame);
+
+  display_board(neopixels, &tb);
+  TEST_ASSERT_EQUAL_UINT32(0, get_display_stats().pixels_pushed_last_frame);
+}
 
-  uint8_t in_mask = 0b01110001;
-  uint8_t result_bits[MASK_WIDTH];
-  uint8_t expected_bits[MASK_WIDTH] = {0, 1, 1, 1, 0, 0, 0, 1};
-  getArrayOfBitsFromMask(in_mask, result_bits, MASK_WIDTH);
+TEST_CASE("display_board falls back to full refresh", "[display]") {
+  TetrisBoard tb = init_board();
+  clear_display(neopixels);
+  uint32_t full_refreshes = get_display_stats().full_refreshes;
 
-  printf("getArrayofBitsFromMask: Input (expected) was ");
-  printArrayContents(expected_bits, MASK_WIDTH);
-  printf(", output was: ");
-  printArrayContents(result_bits, MASK_WIDTH);
-  printf("\n");
+  for (int row = 0; row < DISPLAY_ROWS; row++) {
+    for (int col = 0; col < DISPLAY_COLS; col++) {
+      tb.board[row][col] = I_CELL_COLOR;
+    }
+  }
+  display_board(neopixels, &tb);
+  TEST_ASSERT_EQUAL_UINT32(PIXEL_COUNT,
+                           get_display_stats().pixels_pushed_last_frame);
+  TEST_ASSERT_EQUAL_UINT32(full_refreshes + 1,
+                           get_display_stats().full_refreshes);
 
-  TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(
-      expected_bits, result_bits, MASK_WIDTH,
-      "getArrayOfBitsFromMask returned incorrect result");
+  // drawing an overlay means the next frame has to be pushed in full
+  invalidate_display();
+  display_board(neopixels, &tb);
+  TEST_ASSERT_EQUAL_UINT32(PIXEL_COUNT,
+                           get_display_stats().pixels_pushed_last_frame);
 }
 
 ////////////////////////////////////////
@@ -113,7 +248,7 @@ TEST_CASE("test Display Colors", "[display]") {
     uint32_t cell_color =
         getRGBFromCellColor(all_cell_colors[row % (NUM_TETRIS_COLORS - 1)]);
     for (int col = 0; col < DISPLAY_COLS; col++) {
-      pixelArr[col] = (tNeopixel){rowcol_to_LEDNum_LUT[row][col], cell_color};
+      pixelArr[col] = (tNeopixel){display_led_index(row, col), cell_color};
     }
     neopixel_SetPixel(neopixels, pixelArr, DISPLAY_COLS);
   }
@@ -159,11 +294,24 @@ TEST_CASE("Display example_board", "[display]") {
 
 TEST_CASE("Test Display play again mask over board", "[display]") {
   display_play_again_icon(neopixels);
-  // display_mask_over_board(neopixels, 2, play_again_icon_mask, 5, 0);
 
   vTaskDelay(pdMS_TO_TICKS(2000));
 }
 
+/**
+ * Scroll a line of text across the middle of the display
+ */
+TEST_CASE("Test Display scrolling text", "[display]") {
+  const char *text = "SCORE 1234";
+  TetrisBoard tb   = init_board();
+
+  for (int col = DISPLAY_COLS; col >= -display_text_width(text); col--) {
+    display_board(neopixels, &tb);
+    display_text_over_board(neopixels, text, DISPLAY_ROWS / 2, col);
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+}
+
 ////////////////////////////////////////
 // helper functions
 ////////////////////////////////////////
@@ -189,19 +337,6 @@ static void setRingFromOutsideToColor(TetrisBoard *tb,
   }
 }
 
-/**
- * Prints array contents without newline
- * @param *array unsigned int
- * @param length unsigned int
- */
-void printArrayContents(const uint8_t *array, const uint8_t length) {
-  printf("{ ");
-  for (int i = 0; i < length - 1; i++) {
-    printf("%d, ", array[i]);
-  }
-  printf("%d }", array[length - 1]);
-}
-
 // clang-format off
 /**
  * Example board created from ini print in tetris game driver
@@ -241,3 +376,89 @@ static const int8_t example_board[32][8] = {
     { 1, 1, 4, 1, 2,-1, 5, 5}
 };
 // clang-format on
+
+TEST_CASE("test display_split_channels", "[display]") {
+  display_channel_span spans[4];
+
+  // one channel drives the whole chain
+  display_split_channels(spans, 1, 4, 256);
+  TEST_ASSERT_EQUAL_UINT16(0, spans[0].first_led);
+  TEST_ASSERT_EQUAL_UINT16(1024, spans[0].num_leds);
+
+  // a panel per channel
+  display_split_channels(spans, 4, 4, 256);
+  for (int ch = 0; ch < 4; ch++) {
+    TEST_ASSERT_EQUAL_UINT16(ch * 256, spans[ch].first_led);
+    TEST_ASSERT_EQUAL_UINT16(256, spans[ch].num_leds);
+  }
+
+  // leftover panels go to the first channels, which stay the longest
+  display_split_channels(spans, 3, 5, 64);
+  TEST_ASSERT_EQUAL_UINT16(0, spans[0].first_led);
+  TEST_ASSERT_EQUAL_UINT16(128, spans[0].num_leds);
+  TEST_ASSERT_EQUAL_UINT16(128, spans[1].first_led);
+  TEST_ASSERT_EQUAL_UINT16(128, spans[1].num_leds);
+  TEST_ASSERT_EQUAL_UINT16(256, spans[2].first_led);
+  TEST_ASSERT_EQUAL_UINT16(64, spans[2].num_leds);
+}
+
+TEST_CASE("test display_span_dirty", "[display]") {
+  uint8_t dirty[32] = {0};
+  // spans that don't start or end on a byte boundary
+  display_channel_span first  = {.first_led = 0, .num_leds = 100};
+  display_channel_span second = {.first_led = 100, .num_leds = 100};
+
+  TEST_ASSERT_FALSE(display_span_dirty(dirty, first));
+  TEST_ASSERT_FALSE(display_span_dirty(dirty, second));
+
+  // last LED of the first span only
+  dirty[99 >> 3] |= 1 << (99 & 7);
+  TEST_ASSERT_TRUE(display_span_dirty(dirty, first));
+  TEST_ASSERT_FALSE(display_span_dirty(dirty, second));
+
+  // and one in a whole byte of the second
+  dirty[99 >> 3] = 0;
+  dirty[150 >> 3] |= 1 << (150 & 7);
+  TEST_ASSERT_FALSE(display_span_dirty(dirty, first));
+  TEST_ASSERT_TRUE(display_span_dirty(dirty, second));
+
+  // past the end of the second span
+  dirty[150 >> 3] = 0;
+  dirty[200 >> 3] |= 1 << (200 & 7);
+  TEST_ASSERT_FALSE(display_span_dirty(dirty, second));
+}
+
+TEST_CASE("test display_fit_viewport", "[display]") {
+  const int rows = DISPLAY_SCENE_ROWS, cols = DISPLAY_SCENE_COLS;
+
+  // same size as the board: drawn as is
+  display_viewport vp = display_fit_viewport(rows, cols, 0);
+  TEST_ASSERT_EQUAL_UINT8(1, vp.scale);
+  TEST_ASSERT_EQUAL_UINT16(0, vp.row_start[0]);
+  TEST_ASSERT_EQUAL_UINT16(rows, vp.row_start[rows]);
+  TEST_ASSERT_EQUAL_UINT16(cols, vp.col_start[cols]);
+
+  // twice the size both ways fills the display with 2x2 blocks
+  vp = display_fit_viewport(rows * 2, cols * 2, 0);
+  TEST_ASSERT_EQUAL_UINT8(2, vp.scale);
+  TEST_ASSERT_EQUAL_UINT16(2, vp.row_start[1]);
+  TEST_ASSERT_EQUAL_UINT16(rows * 2, vp.row_start[rows]);
+  TEST_ASSERT_EQUAL_UINT16(cols * 2, vp.col_start[cols]);
+
+  // four times as wide but only twice as tall: pillarboxed at 2x
+  vp = display_fit_viewport(rows * 2, cols * 4, 0);
+  TEST_ASSERT_EQUAL_UINT8(2, vp.scale);
+  TEST_ASSERT_EQUAL_UINT16(0, vp.row_start[0]);
+  TEST_ASSERT_EQUAL_UINT16(cols, vp.col_start[0]);
+  TEST_ASSERT_EQUAL_UINT16(cols * 3, vp.col_start[cols]);
+
+  // a smaller scale than fits can be asked for, and is centered
+  vp = display_fit_viewport(rows * 3, cols * 3, 1);
+  TEST_ASSERT_EQUAL_UINT8(1, vp.scale);
+  TEST_ASSERT_EQUAL_UINT16(rows, vp.row_start[0]);
+  TEST_ASSERT_EQUAL_UINT16(cols + 1, vp.col_start[1]);
+
+  // but not a bigger one
+  vp = display_fit_viewport(rows * 3, cols * 3, 4);
+  TEST_ASSERT_EQUAL_UINT8(3, vp.scale);
+}
@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include "display_anim.h"
+#include "unity.h"
+
+static display_anim anim;
+
+// frames stepped until the animation stops changing
+static int frames_until_done(void) {
+  int frames = 0;
+  while (display_anim_running(&anim)) {
+    display_anim_step(&anim);
+    frames++;
+  }
+  return frames;
+}
+
+TEST_CASE("idle animation draws no effect", "[anim]") {
+  display_anim_init(50);
+  display_anim_stop(&anim);
+  TEST_ASSERT_FALSE(display_anim_running(&anim));
+
+  display_effect effect = display_anim_step(&anim);
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_EFFECT_NONE, effect.kind);
+  TEST_ASSERT_EQUAL_INT8(0, effect.level_shift);
+}
+
+TEST_CASE("line clear flashes then wipes its rows", "[anim]") {
+  const int8_t rows[DISPLAY_EFFECT_MAX_ROWS] = {30, 31, -1, -1};
+  display_anim_init(50);  // 20ms a frame
+  display_anim_start(&anim, DISPLAY_ANIM_LINE_CLEAR, rows);
+
+  display_effect effect = display_anim_step(&anim);
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_EFFECT_FLASH_ROWS, effect.kind);
+  TEST_ASSERT_EQUAL_INT8_ARRAY(rows, effect.rows, DISPLAY_EFFECT_MAX_ROWS);
+
+  // 60ms in, the rows are shown normally for a moment
+  display_anim_step(&anim);
+  display_anim_step(&anim);
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_EFFECT_NONE, display_anim_step(&anim).kind);
+
+  // the wipe opens up a little more every frame
+  while (effect.kind != DISPLAY_EFFECT_WIPE_ROWS) {
+    effect = display_anim_step(&anim);
+  }
+  uint8_t progress = effect.progress;
+  while (display_anim_running(&anim)) {
+    effect = display_anim_step(&anim);
+    if (effect.kind == DISPLAY_EFFECT_WIPE_ROWS) {
+      TEST_ASSERT_TRUE(effect.progress > progress);
+      progress = effect.progress;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_EFFECT_NONE, effect.kind);
+}
+
+TEST_CASE("animations take the same time at any frame rate", "[anim]") {
+  display_anim_init(50);
+  display_anim_start(&anim, DISPLAY_ANIM_LEVEL_UP, NULL);
+  int frames_50hz = frames_until_done();
+
+  display_anim_init(100);
+  display_anim_start(&anim, DISPLAY_ANIM_LEVEL_UP, NULL);
+  int frames_100hz = frames_until_done();
+
+  // 240ms, plus the step that finds the animation has ended
+  TEST_ASSERT_EQUAL_INT(240 / 20 + 1, frames_50hz);
+  TEST_ASSERT_EQUAL_INT(240 / 10 + 1, frames_100hz);
+}
+
+TEST_CASE("pause fade holds until stopped", "[anim]") {
+  display_anim_init(60);
+  display_anim_start(&anim, DISPLAY_ANIM_PAUSE, NULL);
+  TEST_ASSERT_TRUE(display_anim_step(&anim).level_shift < 0);
+
+  frames_until_done();
+  TEST_ASSERT_TRUE(display_anim_holding(&anim));
+  display_effect held = display_anim_step(&anim);
+  for (int i = 0; i < 100; i++) {
+    display_effect effect = display_anim_step(&anim);
+    TEST_ASSERT_EQUAL_MEMORY(&held, &effect, sizeof(effect));
+  }
+
+  display_anim_stop(&anim);
+  TEST_ASSERT_FALSE(display_anim_holding(&anim));
+  TEST_ASSERT_EQUAL_INT8(0, display_anim_step(&anim).level_shift);
+}
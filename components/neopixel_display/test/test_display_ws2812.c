@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "display_ws2812.h"
+#include "unity.h"
+
+// golden symbols at 10MHz: 0.3us/0.9us for a 0, 0.9us/0.3us for a 1
+#define ZERO  0x00098003
+#define ONE   0x00038009
+#define RESET 0x05DC05DC
+
+TEST_CASE("ws2812 symbols match the wire timing", "[ws2812]") {
+  TEST_ASSERT_EQUAL_HEX32(ZERO, WS2812_SYMBOL_ZERO);
+  TEST_ASSERT_EQUAL_HEX32(ONE, WS2812_SYMBOL_ONE);
+  TEST_ASSERT_EQUAL_HEX32(RESET, WS2812_SYMBOL_RESET);
+}
+
+TEST_CASE("ws2812 encodes a pixel most significant bit first", "[ws2812]") {
+  // green 0xA5, red 0x0F, blue 0x80
+  const uint8_t grb[]     = {0xA5, 0x0F, 0x80};
+  const uint32_t golden[] = {
+      ONE,  ZERO, ONE,  ZERO, ZERO, ONE,  ZERO, ONE,   // 0xA5
+      ZERO, ZERO, ZERO, ZERO, ONE,  ONE,  ONE,  ONE,   // 0x0F
+      ONE,  ZERO, ZERO, ZERO, ZERO, ZERO, ZERO, ZERO,  // 0x80
+      RESET,
+  };
+  uint32_t symbols[WS2812_SYMBOLS(sizeof(grb))];
+
+  size_t count = ws2812_encode(grb, sizeof(grb), symbols);
+  TEST_ASSERT_EQUAL_UINT32(WS2812_SYMBOLS(sizeof(grb)), count);
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(golden, symbols, count);
+}
+
+TEST_CASE("ws2812 encodes every byte value", "[ws2812]") {
+  uint8_t grb[256];
+  static uint32_t symbols[WS2812_SYMBOLS(sizeof(grb))];
+  for (int i = 0; i < 256; i++) grb[i] = i;
+
+  ws2812_encode(grb, sizeof(grb), symbols);
+  for (int i = 0; i < 256; i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      uint32_t expected = (i << bit) & 0x80 ? ONE : ZERO;
+      TEST_ASSERT_EQUAL_HEX32(expected, symbols[i * 8 + bit]);
+    }
+  }
+  TEST_ASSERT_EQUAL_HEX32(RESET, symbols[256 * 8]);
+}
+
+TEST_CASE("ws2812 chunks add up to the whole frame", "[ws2812]") {
+  // two full chunks and a partial one
+  uint8_t grb[WS2812_CHUNK_BYTES * 2 + 5];
+  static uint32_t whole[WS2812_SYMBOLS(sizeof(grb))];
+  static uint32_t chunked[WS2812_SYMBOLS(sizeof(grb))];
+  for (size_t i = 0; i < sizeof(grb); i++) grb[i] = i * 37;
+  size_t whole_count = ws2812_encode(grb, sizeof(grb), whole);
+
+  ws2812_chunker chunker;
+  ws2812_chunker_init(&chunker, grb, sizeof(grb));
+  uint32_t chunk[WS2812_CHUNK_SYMBOLS];
+  size_t count = 0;
+  int chunks   = 0;
+  size_t symbols;
+  while ((symbols = ws2812_encode_chunk(&chunker, chunk)) > 0) {
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(WS2812_CHUNK_SYMBOLS, symbols);
+    memcpy(&chunked[count], chunk, symbols * sizeof(chunk[0]));
+    count += symbols;
+    chunks++;
+  }
+  TEST_ASSERT_EQUAL_INT(3, chunks);
+  TEST_ASSERT_EQUAL_UINT32(whole_count, count);
+  TEST_ASSERT_EQUAL_HEX32_ARRAY(whole, chunked, count);
+
+  // an empty frame is just the reset
+  ws2812_chunker_init(&chunker, grb, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, ws2812_encode_chunk(&chunker, chunk));
+  TEST_ASSERT_EQUAL_HEX32(RESET, chunk[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, ws2812_encode_chunk(&chunker, chunk));
+}
+
+TEST_CASE("ws2812 refresh rate covers data and reset", "[ws2812]") {
+  // 256 pixels take 7.37ms of data, plus the 0.3ms reset
+  TEST_ASSERT_EQUAL_UINT32(130, ws2812_refresh_rate(256));
+  TEST_ASSERT_EQUAL_UINT32(3333, ws2812_refresh_rate(0));
+}
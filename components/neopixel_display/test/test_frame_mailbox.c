@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "frame_mailbox.h"
+#include "unity.h"
+
+static frame_mailbox mb;
+
+static void publish_overlay(uint8_t overlay) {
+  display_frame *frame = frame_mailbox_back(&mb);
+  frame->overlay       = overlay;
+  frame_mailbox_publish(&mb);
+}
+
+TEST_CASE("frame mailbox starts empty", "[mailbox]") {
+  frame_mailbox_init(&mb);
+  TEST_ASSERT_NULL(frame_mailbox_take(&mb));
+}
+
+TEST_CASE("frame mailbox hands over published frame once", "[mailbox]") {
+  frame_mailbox_init(&mb);
+  publish_overlay(DISPLAY_OVERLAY_PAUSE);
+
+  const display_frame *frame = frame_mailbox_take(&mb);
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_OVERLAY_PAUSE, frame->overlay);
+  TEST_ASSERT_NULL(frame_mailbox_take(&mb));
+}
+
+TEST_CASE("frame mailbox keeps only the newest frame", "[mailbox]") {
+  frame_mailbox_init(&mb);
+  publish_overlay(DISPLAY_OVERLAY_NONE);
+  publish_overlay(DISPLAY_OVERLAY_PAUSE);
+  publish_overlay(DISPLAY_OVERLAY_PLAY_AGAIN);
+
+  const display_frame *frame = frame_mailbox_take(&mb);
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_OVERLAY_PLAY_AGAIN, frame->overlay);
+
+  frame_mailbox_stats stats = frame_mailbox_get_stats(&mb);
+  TEST_ASSERT_EQUAL_UINT32(3, stats.published);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.superseded);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.rendered);
+}
+
+TEST_CASE("frame mailbox never hands out the slot being drawn", "[mailbox]") {
+  frame_mailbox_init(&mb);
+
+  for (int i = 0; i < 10; i++) {
+    publish_overlay(i);
+    const display_frame *frame = frame_mailbox_take(&mb);
+    TEST_ASSERT_EQUAL_UINT8(i, frame->overlay);
+    // producer's next slot must never be the one the consumer is reading
+    TEST_ASSERT_TRUE(frame != frame_mailbox_back(&mb));
+  }
+}
+
+TEST_CASE("frame mailbox carries presses from frames never drawn",
+          "[mailbox]") {
+  frame_mailbox_init(&mb);
+  display_frame *frame = frame_mailbox_back(&mb);
+  frame->input         = (frame_input_times){.rx_us = 100, .tick_us = 110};
+  frame_mailbox_publish(&mb);
+  frame        = frame_mailbox_back(&mb);
+  frame->input = (frame_input_times){.rx_us = 200, .tick_us = 210};
+  frame_mailbox_publish(&mb);
+  frame        = frame_mailbox_back(&mb);
+  frame->input = (frame_input_times){.restart_rx_us = 300};
+  frame_mailbox_publish(&mb);
+
+  // the newest frame shows the earliest press that was never drawn
+  const display_frame *taken = frame_mailbox_take(&mb);
+  TEST_ASSERT_EQUAL(100, taken->input.rx_us);
+  TEST_ASSERT_EQUAL(110, taken->input.tick_us);
+  TEST_ASSERT_EQUAL(300, taken->input.restart_rx_us);
+
+  // once a frame has been taken, its presses aren't carried again
+  frame        = frame_mailbox_back(&mb);
+  frame->input = (frame_input_times){0};
+  frame_mailbox_publish(&mb);
+  taken = frame_mailbox_take(&mb);
+  TEST_ASSERT_EQUAL(0, taken->input.rx_us);
+  TEST_ASSERT_EQUAL(0, taken->input.restart_rx_us);
+}
+
+TEST_CASE("frame hash only changes when the frame looks different",
+          "[mailbox]") {
+  static display_frame a, b;
+  memset(&a, 0, sizeof(a));
+  memset(a.board.board, BG_COLOR, sizeof(a.board.board));
+  b = a;
+  TEST_ASSERT_TRUE(display_frame_hash(&a) == display_frame_hash(&b));
+
+  // timing doesn't change how the frame looks
+  b.input.rx_us   = 1234;
+  b.input.tick_us = 5678;
+  TEST_ASSERT_TRUE(display_frame_hash(&a) == display_frame_hash(&b));
+
+  b.board.board[TETRIS_ROWS - 1][TETRIS_COLS - 1] = I_CELL_COLOR;
+  TEST_ASSERT_FALSE(display_frame_hash(&a) == display_frame_hash(&b));
+  b = a;
+  b.overlay = DISPLAY_OVERLAY_PAUSE;
+  TEST_ASSERT_FALSE(display_frame_hash(&a) == display_frame_hash(&b));
+  b = a;
+  b.brightness = 1;
+  TEST_ASSERT_FALSE(display_frame_hash(&a) == display_frame_hash(&b));
+
+  // scrolling text
+  strcpy(a.text, "SCORE 10");
+  b = a;
+  TEST_ASSERT_TRUE(display_frame_hash(&a) == display_frame_hash(&b));
+  b.text_col = -1;
+  TEST_ASSERT_FALSE(display_frame_hash(&a) == display_frame_hash(&b));
+  b = a;
+  strcpy(b.text, "SCORE 11");
+  TEST_ASSERT_FALSE(display_frame_hash(&a) == display_frame_hash(&b));
+}
@@ -0,0 +1,37 @@
+#ifndef INPUT_EVENT_RING_H
+#define INPUT_EVENT_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// must be a power of two
+#define INPUT_EVENT_RING_SIZE 32
+
+// a single button press reported by the remote
+typedef struct input_event {
+  uint8_t program;     // raw program byte from the remote
+  uint8_t button;      // enum wizmote_buttons
+  uint32_t seq;        // remote's sequence number for this press
+  int64_t rx_time_us;  // esp_timer_get_time() when the radio delivered it
+  int64_t time_us;     // esp_timer_get_time() when the press was parsed
+} input_event;
+
+/**
+ * Bounded single-producer/single-consumer ring of input events. The producer
+ * never blocks; when the ring is full, new events are counted as dropped
+ * rather than overwriting ones the consumer hasn't seen yet.
+ */
+typedef struct input_event_ring {
+  input_event events[INPUT_EVENT_RING_SIZE];
+  _Atomic uint32_t head;  // next slot to write, only advanced by producer
+  _Atomic uint32_t tail;  // next slot to read, only advanced by consumer
+  uint32_t dropped;       // events lost to a full ring (producer only)
+  uint32_t max_depth;     // most events ever waiting at once (producer only)
+} input_event_ring;
+
+void input_event_ring_init(input_event_ring *ring);
+bool input_event_ring_push(input_event_ring *ring, const input_event *event);
+bool input_event_ring_pop(input_event_ring *ring, input_event *event);
+
+#endif
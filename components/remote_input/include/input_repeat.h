@@ -0,0 +1,45 @@
+#ifndef INPUT_REPEAT_H
+#define INPUT_REPEAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#define INPUT_REPEAT_NO_DEADLINE INT64_MAX
+
+typedef struct input_repeat_config {
+  int64_t das_us;              // hold time before repeating starts
+  int64_t arr_us;              // interval between repeats
+  int64_t report_interval_us;  // how often the remote reports a held button
+} input_repeat_config;
+
+#define INPUT_REPEAT_DEFAULT_CONFIG                              \
+  ((input_repeat_config){                                        \
+      .das_us             = CONFIG_REMOTE_INPUT_DAS_MS * 1000LL, \
+      .arr_us             = CONFIG_REMOTE_INPUT_ARR_MS * 1000LL, \
+      .report_interval_us = CONFIG_REMOTE_INPUT_REPORT_INTERVAL_MS * 1000LL})
+
+/**
+ * Delayed auto shift / auto repeat state for one remote.
+ *
+ * Only one button can be held at a time, like a d-pad. Repeats are scheduled
+ * from the press timestamp, not from when the game loop happens to run, so
+ * the repeat rate stays exact however late input_repeat_poll() is called.
+ */
+typedef struct input_repeat {
+  input_repeat_config config;
+  uint8_t held_button;      // 0 if nothing is held
+  bool repeating;           // held_button repeats its move
+  int64_t last_report_us;   // last time held_button was reported
+  int64_t next_repeat_us;   // when the next repeat is due, if repeating
+} input_repeat;
+
+void input_repeat_init(input_repeat *rep, const input_repeat_config *config);
+
+bool input_repeat_press(input_repeat *rep, uint8_t button, bool repeatable,
+                        int64_t time_us);
+uint32_t input_repeat_poll(input_repeat *rep, int64_t now_us, uint8_t *button);
+int64_t input_repeat_next_deadline(const input_repeat *rep);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * Lock-free ring buffer carrying remote presses from the receive task to the
+ * game task
+ */
+
+#include "input_event_ring.h"
+
+#include <string.h>
+
+_Static_assert((INPUT_EVENT_RING_SIZE & (INPUT_EVENT_RING_SIZE - 1)) == 0,
+               "INPUT_EVENT_RING_SIZE must be a power of two");
+
+void input_event_ring_init(input_event_ring *ring) {
+  memset(ring, 0, sizeof(*ring));
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+}
+
+/**
+ * Add event to the ring. Only call from the producer.
+ * @returns false if the ring was full and the event was dropped
+ */
+bool input_event_ring_push(input_event_ring *ring, const input_event *event) {
+  uint32_t head  = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail  = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  uint32_t depth = head - tail;
+
+  if (depth >= INPUT_EVENT_RING_SIZE) {
+    ring->dropped++;
+    return false;
+  }
+  ring->events[head & (INPUT_EVENT_RING_SIZE - 1)] = *event;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  if (depth + 1 > ring->max_depth) {
+    ring->max_depth = depth + 1;
+  }
+  return true;
+}
+
+/**
+ * Take the oldest event from the ring. Only call from the consumer.
+ * @returns false if the ring was empty
+ */
+bool input_event_ring_pop(input_event_ring *ring, input_event *event) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  if (head == tail) {
+    return false;
+  }
+  *event = ring->events[tail & (INPUT_EVENT_RING_SIZE - 1)];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return true;
+}
@@ -0,0 +1,96 @@
+/**
+ * Delayed auto shift (DAS) and auto repeat rate (ARR) for remote buttons.
+ *
+ * The Wizmote only reports presses, never releases. While a button is held it
+ * is reported again every report interval, so a report that comes in on that
+ * cadence is the same hold, and one that comes later is a new press: the
+ * button must have been let go in between. A quick double tap is two presses,
+ * as long as the remote's reports are faster than anyone can tap.
+ */
+
+#include "input_repeat.h"
+
+#include <string.h>
+
+// a held button's report can be up to half an interval late before the
+// button counts as released
+static int64_t hold_window(const input_repeat *rep) {
+  return rep->config.report_interval_us * 3 / 2;
+}
+
+void input_repeat_init(input_repeat *rep, const input_repeat_config *config) {
+  memset(rep, 0, sizeof(*rep));
+  rep->config = *config;
+}
+
+/**
+ * Feed a press reported by the remote into the repeat engine.
+ * @param button - button that was reported
+ * @param repeatable - whether holding this button should repeat its move
+ * @param time_us - when the press was received
+ * @returns true if the press should be applied as a move, false if it's just
+ * the remote reporting an already held button again
+ */
+bool input_repeat_press(input_repeat *rep, uint8_t button, bool repeatable,
+                        int64_t time_us) {
+  bool still_held = rep->held_button == button &&
+                    time_us - rep->last_report_us <= hold_window(rep);
+
+  if (still_held) {
+    rep->last_report_us = time_us;
+    return false;
+  }
+
+  // any other button releases whatever was held before. Every button is
+  //  tracked while held, so its reports aren't taken for new presses, but
+  //  only repeatable ones are ever repeated
+  rep->held_button    = button;
+  rep->repeating      = repeatable;
+  rep->last_report_us = time_us;
+  rep->next_repeat_us = time_us + rep->config.das_us;
+  return true;
+}
+
+/**
+ * Work out how many repeats of the held button are due by `now_us`, and
+ * release it if the remote has stopped reporting it. A button that doesn't
+ * repeat never has any due.
+ * @param button - set to the held button if any repeats are due
+ * @returns number of repeated moves to apply
+ */
+uint32_t input_repeat_poll(input_repeat *rep, int64_t now_us, uint8_t *button) {
+  if (rep->held_button == 0) {
+    return 0;
+  }
+
+  // repeats stop at the point the button was released, not at now_us
+  int64_t release_us = rep->last_report_us + hold_window(rep);
+  int64_t until_us   = now_us < release_us ? now_us : release_us;
+  uint32_t repeats   = 0;
+
+  if (rep->repeating && until_us >= rep->next_repeat_us) {
+    repeats = 1 + (until_us - rep->next_repeat_us) / rep->config.arr_us;
+    rep->next_repeat_us += (int64_t)repeats * rep->config.arr_us;
+  }
+  *button = rep->held_button;
+
+  if (now_us >= release_us) {
+    rep->held_button = 0;
+  }
+  return repeats;
+}
+
+/**
+ * @returns time the engine next needs polling at, or INPUT_REPEAT_NO_DEADLINE
+ * if no button is held
+ */
+int64_t input_repeat_next_deadline(const input_repeat *rep) {
+  if (rep->held_button == 0) {
+    return INPUT_REPEAT_NO_DEADLINE;
+  }
+  int64_t release_us = rep->last_report_us + hold_window(rep);
+  if (!rep->repeating) {
+    return release_us;
+  }
+  return rep->next_repeat_us < release_us ? rep->next_repeat_us : release_us;
+}
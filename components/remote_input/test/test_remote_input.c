@@ -0,0 +1,139 @@
+#include <string.h>
+
+#include "input_event_ring.h"
+#include "input_repeat.h"
+#include "unity.h"
+
+#define MS 1000LL
+
+#define BUTTON_LEFT   16
+#define BUTTON_ROTATE 17
+
+static input_event_ring ring;
+static input_repeat rep;
+
+static const input_repeat_config test_config = {
+    .das_us = 170 * MS, .arr_us = 50 * MS, .report_interval_us = 40 * MS};
+
+////////////////////////////////////////
+// input_event_ring
+////////////////////////////////////////
+TEST_CASE("input ring keeps every event in order", "[input]") {
+  input_event_ring_init(&ring);
+  for (uint32_t seq = 1; seq <= 5; seq++) {
+    input_event event = {.button = BUTTON_LEFT, .seq = seq, .time_us = seq};
+    TEST_ASSERT_TRUE(input_event_ring_push(&ring, &event));
+  }
+
+  input_event event;
+  for (uint32_t seq = 1; seq <= 5; seq++) {
+    TEST_ASSERT_TRUE(input_event_ring_pop(&ring, &event));
+    TEST_ASSERT_EQUAL_UINT32(seq, event.seq);
+  }
+  TEST_ASSERT_FALSE(input_event_ring_pop(&ring, &event));
+  TEST_ASSERT_EQUAL_UINT32(5, ring.max_depth);
+}
+
+TEST_CASE("input ring counts events dropped when full", "[input]") {
+  input_event_ring_init(&ring);
+  input_event event = {0};
+  for (int i = 0; i < INPUT_EVENT_RING_SIZE; i++) {
+    TEST_ASSERT_TRUE(input_event_ring_push(&ring, &event));
+  }
+  TEST_ASSERT_FALSE(input_event_ring_push(&ring, &event));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropped);
+
+  // room again once the consumer catches up, including across wraparound
+  for (int i = 0; i < 3 * INPUT_EVENT_RING_SIZE; i++) {
+    TEST_ASSERT_TRUE(input_event_ring_pop(&ring, &event));
+    event.seq = i;
+    TEST_ASSERT_TRUE(input_event_ring_push(&ring, &event));
+  }
+}
+
+////////////////////////////////////////
+// input_repeat
+////////////////////////////////////////
+TEST_CASE("tap moves once and doesn't repeat", "[input]") {
+  uint8_t button;
+  input_repeat_init(&rep, &test_config);
+
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 0));
+  // no more reports, so the button is released before DAS runs out
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 1000 * MS, &button));
+  TEST_ASSERT_EQUAL(INPUT_REPEAT_NO_DEADLINE, input_repeat_next_deadline(&rep));
+}
+
+TEST_CASE("held button repeats at ARR after DAS", "[input]") {
+  uint8_t button;
+  input_repeat_init(&rep, &test_config);
+
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 0));
+  // released at 60ms unless the remote reports it again
+  TEST_ASSERT_EQUAL(60 * MS, input_repeat_next_deadline(&rep));
+
+  // remote keeps reporting the button every 40ms
+  for (int64_t t = 40 * MS; t <= 480 * MS; t += 40 * MS) {
+    TEST_ASSERT_FALSE(input_repeat_press(&rep, BUTTON_LEFT, true, t));
+  }
+  TEST_ASSERT_EQUAL(170 * MS, input_repeat_next_deadline(&rep));
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 169 * MS, &button));
+  TEST_ASSERT_EQUAL_UINT32(1, input_repeat_poll(&rep, 170 * MS, &button));
+  TEST_ASSERT_EQUAL_UINT8(BUTTON_LEFT, button);
+
+  // polling late still gives the exact number of repeats: 220..370
+  TEST_ASSERT_EQUAL_UINT32(4, input_repeat_poll(&rep, 390 * MS, &button));
+  // last report at 480ms, released at 540ms: repeats at 420..520
+  TEST_ASSERT_EQUAL_UINT32(3, input_repeat_poll(&rep, 2000 * MS, &button));
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 3000 * MS, &button));
+}
+
+TEST_CASE("fast double tap is two presses", "[input]") {
+  uint8_t button;
+  input_repeat_init(&rep, &test_config);
+
+  // two taps 100ms apart: too far apart to be the remote reporting a held
+  // button, so both are applied and neither starts repeating
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 100 * MS, &button));
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 100 * MS));
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 1000 * MS, &button));
+
+  // the same even if nothing polls in between
+  input_repeat_init(&rep, &test_config);
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 0));
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 100 * MS));
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 1000 * MS, &button));
+}
+
+TEST_CASE("held buttons that don't repeat are one press", "[input]") {
+  uint8_t button;
+  input_repeat_init(&rep, &test_config);
+
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 0));
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_ROTATE, false, 10 * MS));
+  // the remote reporting rotate again, still held
+  TEST_ASSERT_FALSE(input_repeat_press(&rep, BUTTON_ROTATE, false, 20 * MS));
+  // rotate released LEFT, so it doesn't repeat
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 500 * MS, &button));
+  // and pressing it again is a fresh press
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_LEFT, true, 600 * MS));
+}
+
+TEST_CASE("held buttons that don't repeat never repeat", "[input]") {
+  uint8_t button;
+  input_repeat_init(&rep, &test_config);
+
+  // held long past DAS, reported every interval
+  int64_t t = 0;
+  TEST_ASSERT_TRUE(input_repeat_press(&rep, BUTTON_ROTATE, false, t));
+  for (t = 40 * MS; t <= 1000 * MS; t += 40 * MS) {
+    TEST_ASSERT_FALSE(input_repeat_press(&rep, BUTTON_ROTATE, false, t));
+    TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, t, &button));
+    // nothing to wake up for but the release
+    TEST_ASSERT_EQUAL_INT64(t + 60 * MS, input_repeat_next_deadline(&rep));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, input_repeat_poll(&rep, 2000 * MS, &button));
+  TEST_ASSERT_EQUAL_INT64(INPUT_REPEAT_NO_DEADLINE,
+                          input_repeat_next_deadline(&rep));
+}
@@ -0,0 +1,95 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/**
+ * Game recordings: the seed the game's pieces were drawn with, and every
+ * tg_tick() call made, so replaying them through a fresh game reproduces it
+ * exactly.
+ *
+ * A recording is a stream of LEB128 varints, one per move, holding the
+ * number of gravity ticks (T_NONE) since the last move shifted up past the
+ * move itself; most moves take one byte. The stream is written and read a
+ * flash sector at a time, so neither end ever holds more than one sector of
+ * it, however long the game.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tetris.h"
+
+#define REPLAY_SECTOR_BYTES 4096
+#define REPLAY_MAGIC        0x4c52504e  // "NPRL"
+#define REPLAY_VERSION      1
+
+// sector flags
+#define REPLAY_SECTOR_GAME_START 0x01  // a recording starts at data[0]
+
+// low bits of each record; the move, or REPLAY_END
+#define REPLAY_MOVE_BITS 3
+#define REPLAY_END       7  // followed by the final score
+#define REPLAY_MAX_IDLE  (UINT32_MAX >> REPLAY_MOVE_BITS)
+_Static_assert(T_QUIT < REPLAY_END, "moves must fit below REPLAY_END");
+
+typedef struct replay_sector_header {
+  uint32_t magic;   // REPLAY_MAGIC, anything else is an erased sector
+  uint32_t seq;     // counts up by one for every sector written
+  uint16_t length;  // bytes of data used
+  uint8_t flags;
+  uint8_t version;  // REPLAY_VERSION
+} replay_sector_header;
+
+/**
+ * One flash sector of recording, header and all
+ */
+typedef struct replay_sector {
+  replay_sector_header header;
+  uint8_t data[REPLAY_SECTOR_BYTES - sizeof(replay_sector_header)];
+} replay_sector;
+_Static_assert(sizeof(replay_sector) == REPLAY_SECTOR_BYTES,
+               "replay sectors must fill a flash sector exactly");
+
+/**
+ * Called with every full sector, and the last part filled one at the end of
+ * a game. Sets header.seq and stores it.
+ */
+typedef void (*replay_flush_fn)(void *ctx, replay_sector *sector);
+
+/**
+ * Fills `sector` with the next sector of the recording being read
+ * @returns false if there isn't one
+ */
+typedef bool (*replay_fetch_fn)(void *ctx, replay_sector *sector);
+
+typedef struct replay_writer {
+  replay_sector sector;  // being filled
+  uint32_t idle_ticks;   // gravity ticks since the last move recorded
+  bool recording;
+  uint32_t moves;  // in the game being recorded
+  uint32_t bytes;
+  replay_flush_fn flush;
+  void *flush_ctx;
+} replay_writer;
+
+typedef struct replay_reader {
+  replay_sector sector;  // being read
+  uint16_t pos;          // next byte of sector.data
+  uint32_t seed;
+  uint32_t idle_ticks;  // gravity ticks left before `move`
+  uint8_t move;         // next move; REPLAY_END after the last one
+  bool complete;        // reached the end record, rather than running out
+  uint32_t score;       // final score, once complete
+  replay_fetch_fn fetch;
+  void *fetch_ctx;
+} replay_reader;
+
+void replay_writer_init(replay_writer *w, replay_flush_fn flush, void *ctx);
+void replay_begin(replay_writer *w, uint32_t seed);
+void replay_record(replay_writer *w, enum player_move move);
+void replay_end(replay_writer *w, uint32_t score);
+
+bool replay_reader_init(replay_reader *r, replay_fetch_fn fetch, void *ctx);
+void replay_start_game(const replay_reader *r, TetrisGame *tg);
+bool replay_next(replay_reader *r, enum player_move *move);
+
+#endif
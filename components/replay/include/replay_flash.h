@@ -0,0 +1,23 @@
+#ifndef REPLAY_FLASH_H
+#define REPLAY_FLASH_H
+
+/**
+ * Recordings kept in a flash partition, used as a ring of sectors: the
+ * oldest games are erased to make room for new ones. Each game starts on a
+ * sector of its own.
+ */
+
+#include <stdbool.h>
+
+#include "replay.h"
+#include "sdkconfig.h"
+
+#define REPLAY_PARTITION_LABEL     CONFIG_REPLAY_PARTITION_LABEL
+#define REPLAY_ERASE_AHEAD_SECTORS CONFIG_REPLAY_ERASE_AHEAD_SECTORS
+
+bool replay_flash_init(void);
+void replay_flash_erase_ahead(void);
+void replay_flash_write(void *ctx, replay_sector *sector);
+bool replay_flash_open_last(replay_reader *reader);
+
+#endif
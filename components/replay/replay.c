@@ -0,0 +1,190 @@
+/**
+ * Recording encoder and streaming decoder. Gravity ticks aren't stored one
+ * by one, only counted, so a recording grows with the number of presses
+ * rather than with how long the game went on.
+ */
+
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// reader has to decode the next record before it knows the next move
+#define NO_MOVE 0xff
+
+static void put_byte(replay_writer *w, uint8_t byte) {
+  replay_sector *sector = &w->sector;
+  if (sector->header.length == sizeof(sector->data)) {
+    w->flush(w->flush_ctx, sector);
+    sector->header.length = 0;
+    sector->header.flags  = 0;
+  }
+  sector->data[sector->header.length++] = byte;
+  w->bytes++;
+}
+
+static void put_varint(replay_writer *w, uint32_t value) {
+  while (value >= 0x80) {
+    put_byte(w, value | 0x80);
+    value >>= 7;
+  }
+  put_byte(w, value);
+}
+
+void replay_writer_init(replay_writer *w, replay_flush_fn flush, void *ctx) {
+  memset(w, 0, sizeof(*w));
+  w->flush     = flush;
+  w->flush_ctx = ctx;
+}
+
+/**
+ * Start recording a game, throwing away anything recorded since the last
+ * replay_end(). Seed the RNG with srand(`seed`) before the first piece, the
+ * way replay_start_game() will.
+ */
+void replay_begin(replay_writer *w, uint32_t seed) {
+  w->sector.header = (replay_sector_header){
+      .magic   = REPLAY_MAGIC,
+      .flags   = REPLAY_SECTOR_GAME_START,
+      .version = REPLAY_VERSION,
+  };
+  w->idle_ticks = 0;
+  w->moves      = 0;
+  w->bytes      = 0;
+  w->recording  = true;
+  for (int i = 0; i < 4; i++) {
+    put_byte(w, seed >> (8 * i));
+  }
+}
+
+/**
+ * Record one tg_tick() call. Flushes a sector when one fills up.
+ */
+void replay_record(replay_writer *w, enum player_move move) {
+  if (!w->recording) {
+    return;
+  }
+  // a T_NONE record only turns up when the gravity count would overflow
+  if (move == T_NONE && w->idle_ticks < REPLAY_MAX_IDLE) {
+    w->idle_ticks++;
+    return;
+  }
+  put_varint(w, w->idle_ticks << REPLAY_MOVE_BITS | move);
+  w->idle_ticks = 0;
+  w->moves++;
+}
+
+/**
+ * Finish the recording and flush what's left of it
+ * @param score - final score, for playback to check it against
+ */
+void replay_end(replay_writer *w, uint32_t score) {
+  if (!w->recording) {
+    return;
+  }
+  put_varint(w, w->idle_ticks << REPLAY_MOVE_BITS | REPLAY_END);
+  put_varint(w, score);
+  w->flush(w->flush_ctx, &w->sector);
+  w->recording = false;
+}
+
+static bool valid_sector(const replay_sector *sector, bool game_start) {
+  const replay_sector_header *header = &sector->header;
+  return header->magic == REPLAY_MAGIC && header->version == REPLAY_VERSION &&
+         header->length <= sizeof(sector->data) &&
+         !(header->flags & REPLAY_SECTOR_GAME_START) == !game_start;
+}
+
+static bool get_byte(replay_reader *r, uint8_t *byte) {
+  if (r->pos == r->sector.header.length) {
+    // a new game starting means this one was cut off
+    if (!r->fetch(r->fetch_ctx, &r->sector) ||
+        !valid_sector(&r->sector, false)) {
+      r->sector.header.length = r->pos = 0;
+      return false;
+    }
+    r->pos = 0;
+  }
+  *byte = r->sector.data[r->pos++];
+  return true;
+}
+
+static bool get_varint(replay_reader *r, uint32_t *value) {
+  uint8_t byte;
+  *value = 0;
+  for (int shift = 0; shift < 32; shift += 7) {
+    if (!get_byte(r, &byte)) {
+      return false;
+    }
+    *value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Start reading a recording from its first sector
+ * @returns false if there's no recording there
+ */
+bool replay_reader_init(replay_reader *r, replay_fetch_fn fetch, void *ctx) {
+  memset(r, 0, sizeof(*r));
+  r->fetch     = fetch;
+  r->fetch_ctx = ctx;
+  r->move      = NO_MOVE;
+  if (!fetch(ctx, &r->sector) || !valid_sector(&r->sector, true)) {
+    return false;
+  }
+
+  uint8_t byte;
+  for (int i = 0; i < 4; i++) {
+    if (!get_byte(r, &byte)) {
+      return false;
+    }
+    r->seed |= (uint32_t)byte << (8 * i);
+  }
+  return true;
+}
+
+/**
+ * Seed the RNG and spawn the first piece, as it was for the recorded game
+ * @param tg - freshly created game
+ */
+void replay_start_game(const replay_reader *r, TetrisGame *tg) {
+  srand(r->seed);
+  create_rand_piece(tg);
+}
+
+/**
+ * @param move - set to what to pass to the next tg_tick() call
+ * @returns false once the recording is over, or it was cut off
+ */
+bool replay_next(replay_reader *r, enum player_move *move) {
+  while (true) {
+    if (r->idle_ticks > 0) {
+      r->idle_ticks--;
+      *move = T_NONE;
+      return true;
+    }
+    if (r->move == REPLAY_END) {
+      return false;
+    }
+    if (r->move != NO_MOVE) {
+      *move   = r->move;
+      r->move = NO_MOVE;
+      return true;
+    }
+
+    uint32_t record;
+    if (!get_varint(r, &record)) {
+      r->move = REPLAY_END;
+      return false;
+    }
+    r->idle_ticks = record >> REPLAY_MOVE_BITS;
+    r->move       = record & ((1 << REPLAY_MOVE_BITS) - 1);
+    if (r->move == REPLAY_END) {
+      r->complete = get_varint(r, &r->score);
+    }
+  }
+}
@@ -0,0 +1,184 @@
+/**
+ * Flash storage for recordings. Writes only happen a whole sector at a time,
+ * when the recording's sector buffer fills up or the game ends, and every
+ * sector of the partition is used in turn before any is erased again. The
+ * sectors the next game goes to are erased between games, so recording
+ * normally never erases mid-game.
+ */
+
+#include "replay_flash.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+static const char *TAG = "replay";
+
+static const esp_partition_t *partition;
+static uint32_t num_sectors;
+static uint32_t next_sector;  // where the next write goes
+static uint32_t next_seq;
+// sectors from next_sector on that are erased and ready to write
+static uint32_t erased_ahead;
+
+// where replay_flash_open_last()'s reader has got to
+static struct {
+  uint32_t sector;
+  uint32_t seq;
+  bool started;  // false until the game's first sector has been read
+} cursor;
+
+static bool read_header(uint32_t index, replay_sector_header *header) {
+  return esp_partition_read(partition, index * REPLAY_SECTOR_BYTES, header,
+                            sizeof(*header)) == ESP_OK &&
+         header->magic == REPLAY_MAGIC;
+}
+
+static bool sector_erased(uint32_t index) {
+  uint32_t words[64];
+  for (size_t offset = 0; offset < REPLAY_SECTOR_BYTES;
+       offset += sizeof(words)) {
+    if (esp_partition_read(partition, index * REPLAY_SECTOR_BYTES + offset,
+                           words, sizeof(words)) != ESP_OK) {
+      return false;
+    }
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+      if (words[i] != UINT32_MAX) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// never erase so far ahead that the last game recorded goes too
+static uint32_t max_erased_ahead(void) {
+  uint32_t half = num_sectors / 2;
+  return REPLAY_ERASE_AHEAD_SECTORS < half ? REPLAY_ERASE_AHEAD_SECTORS : half;
+}
+
+/**
+ * Find the replay partition and where the last recording left off
+ * @returns false if there's no partition; nothing is recorded then
+ */
+bool replay_flash_init(void) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                       ESP_PARTITION_SUBTYPE_ANY,
+                                       REPLAY_PARTITION_LABEL);
+  if (partition == NULL) {
+    ESP_LOGW(TAG, "No \"%s\" partition, games won't be recorded",
+             REPLAY_PARTITION_LABEL);
+    return false;
+  }
+  num_sectors = partition->size / REPLAY_SECTOR_BYTES;
+
+  // carry on after the sector with the highest sequence number
+  replay_sector_header header;
+  bool found = false;
+  for (uint32_t i = 0; i < num_sectors; i++) {
+    if (read_header(i, &header) && (!found || header.seq >= next_seq)) {
+      next_sector = (i + 1) % num_sectors;
+      next_seq    = header.seq + 1;
+      found       = true;
+    }
+  }
+
+  // sectors erased before a reset or deep sleep don't need erasing again
+  erased_ahead = 0;
+  while (erased_ahead < max_erased_ahead() &&
+         sector_erased((next_sector + erased_ahead) % num_sectors)) {
+    erased_ahead++;
+  }
+  ESP_LOGI(TAG, "%lu sectors, next write to sector %lu, %lu erased",
+           num_sectors, next_sector, erased_ahead);
+  return true;
+}
+
+/**
+ * Erase the sectors the next game will be recorded to, up to
+ * REPLAY_ERASE_AHEAD_SECTORS of them. Call it between games: each sector
+ * erased holds up the caller for tens of milliseconds, and the ones already
+ * erased are skipped.
+ */
+void replay_flash_erase_ahead(void) {
+  if (partition == NULL) {
+    return;
+  }
+  while (erased_ahead < max_erased_ahead()) {
+    uint32_t index = (next_sector + erased_ahead) % num_sectors;
+    if (esp_partition_erase_range(partition, index * REPLAY_SECTOR_BYTES,
+                                  REPLAY_SECTOR_BYTES) != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to erase sector %lu", index);
+      return;
+    }
+    erased_ahead++;
+  }
+}
+
+/**
+ * replay_flush_fn that writes to the next sector of the partition. The
+ * sector is normally already erased by replay_flash_erase_ahead(); only a
+ * game that has outrun those sectors has to erase here, mid-game.
+ */
+void replay_flash_write(void *ctx, replay_sector *sector) {
+  (void)ctx;
+  if (partition == NULL) {
+    return;
+  }
+  size_t offset      = next_sector * REPLAY_SECTOR_BYTES;
+  sector->header.seq = next_seq;
+  if (erased_ahead > 0) {
+    erased_ahead--;
+  } else if (esp_partition_erase_range(partition, offset,
+                                       REPLAY_SECTOR_BYTES) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to erase sector %lu", next_sector);
+  }
+  if (esp_partition_write(partition, offset, sector, sizeof(*sector)) !=
+      ESP_OK) {
+    ESP_LOGE(TAG, "Failed to write sector %lu", next_sector);
+  }
+  next_sector = (next_sector + 1) % num_sectors;
+  next_seq++;
+}
+
+/**
+ * replay_fetch_fn for the game replay_flash_open_last() found: its first
+ * sector, then on through consecutive sequence numbers
+ */
+static bool fetch_sector(void *ctx, replay_sector *sector) {
+  (void)ctx;
+  if (cursor.started) {
+    cursor.sector = (cursor.sector + 1) % num_sectors;
+    cursor.seq++;
+  }
+  cursor.started = true;
+  return esp_partition_read(partition, cursor.sector * REPLAY_SECTOR_BYTES,
+                            sector, sizeof(*sector)) == ESP_OK &&
+         sector->header.seq == cursor.seq;
+}
+
+/**
+ * Start reading the most recent recording back, a sector at a time
+ * @returns false if there isn't one
+ */
+bool replay_flash_open_last(replay_reader *reader) {
+  if (partition == NULL) {
+    return false;
+  }
+
+  // walk back from the last sector written to the start of its game
+  replay_sector_header header;
+  uint32_t index = next_sector;
+  for (uint32_t seq = next_seq; seq-- > 0 && seq + num_sectors >= next_seq;) {
+    index = (index + num_sectors - 1) % num_sectors;
+    if (!read_header(index, &header) || header.seq != seq) {
+      return false;
+    }
+    if (header.flags & REPLAY_SECTOR_GAME_START) {
+      cursor.sector  = index;
+      cursor.seq     = seq;
+      cursor.started = false;
+      return replay_reader_init(reader, fetch_sector, NULL);
+    }
+  }
+  return false;
+}
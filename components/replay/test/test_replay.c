@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "replay.h"
+#include "unity.h"
+
+#define TEST_SECTORS 6
+
+// sectors flushed by the writer, read back in order by the reader
+static struct {
+  replay_sector sectors[TEST_SECTORS];
+  uint32_t written;
+  uint32_t read;
+} store;
+
+static replay_writer writer;
+static replay_reader reader;
+
+static void store_write(void *ctx, replay_sector *sector) {
+  TEST_ASSERT_TRUE(store.written < TEST_SECTORS);
+  sector->header.seq            = store.written;
+  store.sectors[store.written++] = *sector;
+}
+
+static bool store_fetch(void *ctx, replay_sector *sector) {
+  if (store.read == store.written) {
+    return false;
+  }
+  *sector = store.sectors[store.read++];
+  return true;
+}
+
+static void store_reset(void) {
+  memset(&store, 0, sizeof(store));
+  replay_writer_init(&writer, store_write, NULL);
+}
+
+// deterministic stand-in for a player: mostly gravity, some presses
+static enum player_move test_move(uint32_t *state) {
+  *state = *state * 1664525 + 1013904223;
+  uint32_t r = *state >> 24;
+  return r < 160 ? T_NONE : (enum player_move)(T_UP + r % 4);
+}
+
+TEST_CASE("replay reads back every tick it recorded", "[replay]") {
+  store_reset();
+  replay_begin(&writer, 0xdeadbeef);
+  uint32_t state = 1;
+  for (int i = 0; i < 20000; i++) {
+    replay_record(&writer, test_move(&state));
+  }
+  // a long idle stretch, then a few ticks of gravity after the last move
+  for (int i = 0; i < 100000; i++) {
+    replay_record(&writer, T_NONE);
+  }
+  replay_record(&writer, T_QUIT);
+  replay_record(&writer, T_NONE);
+  replay_record(&writer, T_NONE);
+  replay_end(&writer, 1234);
+  TEST_ASSERT_TRUE(store.written > 1);
+
+  TEST_ASSERT_TRUE(replay_reader_init(&reader, store_fetch, NULL));
+  TEST_ASSERT_EQUAL_HEX32(0xdeadbeef, reader.seed);
+  state = 1;
+  enum player_move move;
+  for (int i = 0; i < 20000; i++) {
+    TEST_ASSERT_TRUE(replay_next(&reader, &move));
+    TEST_ASSERT_EQUAL(test_move(&state), move);
+  }
+  for (int i = 0; i < 100000; i++) {
+    TEST_ASSERT_TRUE(replay_next(&reader, &move));
+    TEST_ASSERT_EQUAL(T_NONE, move);
+  }
+  TEST_ASSERT_TRUE(replay_next(&reader, &move));
+  TEST_ASSERT_EQUAL(T_QUIT, move);
+  TEST_ASSERT_TRUE(replay_next(&reader, &move));
+  TEST_ASSERT_TRUE(replay_next(&reader, &move));
+  TEST_ASSERT_EQUAL(T_NONE, move);
+  TEST_ASSERT_FALSE(replay_next(&reader, &move));
+  TEST_ASSERT_TRUE(reader.complete);
+  TEST_ASSERT_EQUAL(1234, reader.score);
+}
+
+TEST_CASE("replay takes a few bytes per move", "[replay]") {
+  store_reset();
+  replay_begin(&writer, 1);
+  uint32_t state = 2;
+  for (int i = 0; i < 20000; i++) {
+    replay_record(&writer, test_move(&state));
+  }
+  replay_end(&writer, 0);
+  TEST_ASSERT_TRUE(writer.moves > 5000);
+  TEST_ASSERT_TRUE(writer.bytes < writer.moves * 3 / 2);
+}
+
+TEST_CASE("replay stops where a recording was cut off", "[replay]") {
+  store_reset();
+  replay_begin(&writer, 1);
+  uint32_t state = 3;
+  for (int i = 0; i < 30000; i++) {
+    replay_record(&writer, test_move(&state));
+  }
+  replay_end(&writer, 0);
+  TEST_ASSERT_TRUE(store.written > 1);
+  store.written--;  // lost power before the last sector was written
+
+  TEST_ASSERT_TRUE(replay_reader_init(&reader, store_fetch, NULL));
+  state = 3;
+  enum player_move move;
+  int ticks = 0;
+  while (replay_next(&reader, &move)) {
+    TEST_ASSERT_EQUAL(test_move(&state), move);
+    ticks++;
+  }
+  TEST_ASSERT_TRUE(ticks > 0 && ticks < 30000);
+  TEST_ASSERT_FALSE(reader.complete);
+
+  // a sector that doesn't start a game isn't a recording on its own
+  store.read = 1;
+  TEST_ASSERT_FALSE(replay_reader_init(&reader, store_fetch, NULL));
+}
+
+TEST_CASE("replay plays a game back exactly", "[replay]") {
+  store_reset();
+  TetrisGame *tg = create_game();
+  replay_begin(&writer, 42);
+  srand(42);
+  create_rand_piece(tg);
+  uint32_t state = 4;
+  for (int i = 0; i < 5000 && !tg->game_over; i++) {
+    enum player_move move = test_move(&state);
+    replay_record(&writer, move);
+    tg_tick(tg, move);
+  }
+  replay_end(&writer, tg->score);
+
+  // play something else in between, so the RNG has moved on
+  srand(7);
+  rand();
+
+  TetrisGame *played = create_game();
+  TEST_ASSERT_TRUE(replay_reader_init(&reader, store_fetch, NULL));
+  replay_start_game(&reader, played);
+  enum player_move move;
+  while (replay_next(&reader, &move)) {
+    tg_tick(played, move);
+  }
+  TEST_ASSERT_TRUE(reader.complete);
+  TEST_ASSERT_EQUAL(reader.score, played->score);
+  TEST_ASSERT_EQUAL(tg->score, played->score);
+  TEST_ASSERT_EQUAL(tg->level, played->level);
+  TEST_ASSERT_EQUAL(tg->game_over, played->game_over);
+  TEST_ASSERT_EQUAL_MEMORY(&tg->active_board, &played->active_board,
+                           sizeof(tg->active_board));
+  end_game(tg);
+  end_game(played);
+}
@@ -0,0 +1,20 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "telemetry_history.h"
+
+#define TELEMETRY_INTERVAL_MS        CONFIG_TELEMETRY_INTERVAL_MS
+#define TELEMETRY_STACK_MARGIN_BYTES CONFIG_TELEMETRY_STACK_MARGIN_BYTES
+
+void telemetry_start(void);
+bool telemetry_register_task(TaskHandle_t task, uint32_t stack_size_bytes);
+
+bool telemetry_latest(telemetry_sample *sample);
+void telemetry_dump(void);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TELEMETRY_HISTORY_H
+#define TELEMETRY_HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#define TELEMETRY_MAX_TASKS 6
+#define TELEMETRY_HISTORY   CONFIG_TELEMETRY_HISTORY
+
+// CPU share isn't known without FreeRTOS run time stats
+#define TELEMETRY_CPU_UNKNOWN 0xff
+
+typedef struct telemetry_task_sample {
+  uint32_t stack_free_bytes;  // stack high water mark: least ever free
+  uint8_t cpu_percent;        // of one core since the last sample
+} telemetry_task_sample;
+
+typedef struct telemetry_sample {
+  int64_t time_us;
+  uint32_t heap_free_bytes;
+  uint32_t heap_min_free_bytes;  // lowest heap_free_bytes has ever been
+  uint32_t heap_largest_block;   // biggest single allocation that would fit
+  telemetry_task_sample tasks[TELEMETRY_MAX_TASKS];
+} telemetry_sample;
+
+/**
+ * Ring of the most recent telemetry samples, overwriting the oldest
+ */
+typedef struct telemetry_history {
+  telemetry_sample samples[TELEMETRY_HISTORY];
+  uint32_t next;   // slot the next sample goes in
+  uint32_t count;  // samples stored, up to TELEMETRY_HISTORY
+} telemetry_history;
+
+void telemetry_history_init(telemetry_history *hist);
+void telemetry_history_push(telemetry_history *hist,
+                            const telemetry_sample *sample);
+const telemetry_sample *telemetry_history_get(const telemetry_history *hist,
+                                              uint32_t age);
+
+uint8_t telemetry_cpu_percent(uint32_t task_runtime_delta,
+                              int64_t wall_time_delta_us);
+bool telemetry_stack_low(uint32_t stack_free_bytes, uint32_t margin_bytes);
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * Runtime telemetry: stack high water marks, heap usage and fragmentation,
+ * and per-task CPU share, sampled on a timer into a small history ring
+ */
+
+#include "telemetry.h"
+
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "npix_tetris_defs.h"
+
+typedef struct telemetry_task {
+  TaskHandle_t handle;
+  uint32_t stack_size_bytes;
+  uint32_t last_runtime;  // run time counter at the previous sample
+  bool alerted;           // low stack warning already logged
+} telemetry_task;
+
+static telemetry_task tasks[TELEMETRY_MAX_TASKS];
+static uint32_t num_tasks;
+static telemetry_history history;
+static int64_t last_sample_us;
+
+// the sampler runs in the esp_timer task, everyone else just reads
+static portMUX_TYPE telemetry_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t sample_timer;
+
+static uint32_t task_runtime(TaskHandle_t task) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  return ulTaskGetRunTimeCounter(task);
+#else
+  (void)task;
+  return 0;
+#endif
+}
+
+// share of one core `task` has used since the last time this was called
+static uint8_t task_cpu_percent(telemetry_task *task, int64_t elapsed_us) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  uint32_t runtime   = task_runtime(task->handle);
+  uint8_t percent    = telemetry_cpu_percent(runtime - task->last_runtime,
+                                             elapsed_us);
+  task->last_runtime = runtime;
+  return percent;
+#else
+  (void)task;
+  (void)elapsed_us;
+  return TELEMETRY_CPU_UNKNOWN;
+#endif
+}
+
+static void telemetry_sample_now(void *arg) {
+  (void)arg;
+  telemetry_sample sample = {
+      .time_us             = esp_timer_get_time(),
+      .heap_free_bytes     = heap_caps_get_free_size(MALLOC_CAP_8BIT),
+      .heap_min_free_bytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+      .heap_largest_block  = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+  };
+  int64_t elapsed_us = sample.time_us - last_sample_us;
+  last_sample_us     = sample.time_us;
+
+  for (uint32_t i = 0; i < num_tasks; i++) {
+    telemetry_task *task       = &tasks[i];
+    telemetry_task_sample *out = &sample.tasks[i];
+    out->stack_free_bytes      = uxTaskGetStackHighWaterMark(task->handle);
+    out->cpu_percent           = task_cpu_percent(task, elapsed_us);
+
+    // warn once per task, well before the overflow check panics
+    if (!task->alerted && telemetry_stack_low(out->stack_free_bytes,
+                                              TELEMETRY_STACK_MARGIN_BYTES)) {
+      task->alerted = true;
+      ESP_LOGW(TAG, "Task %s is low on stack: %ld of %ld bytes free",
+               pcTaskGetName(task->handle), out->stack_free_bytes,
+               task->stack_size_bytes);
+    }
+  }
+
+  taskENTER_CRITICAL(&telemetry_lock);
+  telemetry_history_push(&history, &sample);
+  taskEXIT_CRITICAL(&telemetry_lock);
+}
+
+/**
+ * Start sampling every TELEMETRY_INTERVAL_MS. Tasks can be registered
+ * before or after this is called.
+ */
+void telemetry_start(void) {
+  telemetry_history_init(&history);
+  last_sample_us = esp_timer_get_time();
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = telemetry_sample_now,
+      .name     = "telemetry",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &sample_timer));
+  ESP_ERROR_CHECK(
+      esp_timer_start_periodic(sample_timer, TELEMETRY_INTERVAL_MS * 1000));
+}
+
+/**
+ * Include `task` in every sample from now on
+ * @param stack_size_bytes - stack size the task was created with
+ * @returns false if TELEMETRY_MAX_TASKS are already registered
+ */
+bool telemetry_register_task(TaskHandle_t task, uint32_t stack_size_bytes) {
+  bool registered = false;
+
+  taskENTER_CRITICAL(&telemetry_lock);
+  if (num_tasks < TELEMETRY_MAX_TASKS) {
+    tasks[num_tasks] = (telemetry_task){
+        .handle           = task,
+        .stack_size_bytes = stack_size_bytes,
+        .last_runtime     = task_runtime(task),
+    };
+    num_tasks++;
+    registered = true;
+  }
+  taskEXIT_CRITICAL(&telemetry_lock);
+
+  if (!registered) {
+    ESP_LOGE(TAG, "Too many tasks for telemetry, %s not tracked",
+             pcTaskGetName(task));
+  }
+  return registered;
+}
+
+/**
+ * Copy out the most recent sample
+ * @returns false if nothing has been sampled yet
+ */
+bool telemetry_latest(telemetry_sample *sample) {
+  taskENTER_CRITICAL(&telemetry_lock);
+  const telemetry_sample *newest = telemetry_history_get(&history, 0);
+  if (newest != NULL) {
+    *sample = *newest;
+  }
+  taskEXIT_CRITICAL(&telemetry_lock);
+  return newest != NULL;
+}
+
+/**
+ * Log the latest sample for every task, plus the heap trend across the
+ * whole history
+ */
+void telemetry_dump(void) {
+  static telemetry_history snapshot;  // too big for the caller's stack
+
+  taskENTER_CRITICAL(&telemetry_lock);
+  snapshot            = history;
+  uint32_t task_count = num_tasks;
+  taskEXIT_CRITICAL(&telemetry_lock);
+
+  const telemetry_sample *newest = telemetry_history_get(&snapshot, 0);
+  const telemetry_sample *oldest =
+      telemetry_history_get(&snapshot, snapshot.count - 1);
+  if (newest == NULL) {
+    ESP_LOGI(TAG, "Telemetry: no samples yet");
+    return;
+  }
+
+  ESP_LOGI(TAG,
+           "Heap: free=%ld (was %ld %llds ago) min_free=%ld "
+           "largest_block=%ld",
+           newest->heap_free_bytes, oldest->heap_free_bytes,
+           (newest->time_us - oldest->time_us) / 1000000,
+           newest->heap_min_free_bytes, newest->heap_largest_block);
+  for (uint32_t i = 0; i < task_count; i++) {
+    const telemetry_task_sample *task = &newest->tasks[i];
+    if (task->cpu_percent == TELEMETRY_CPU_UNKNOWN) {
+      ESP_LOGI(TAG, "Task %-22s stack free=%5ld of %5ld",
+               pcTaskGetName(tasks[i].handle), task->stack_free_bytes,
+               tasks[i].stack_size_bytes);
+    } else {
+      ESP_LOGI(TAG, "Task %-22s stack free=%5ld of %5ld cpu=%3d%%",
+               pcTaskGetName(tasks[i].handle), task->stack_free_bytes,
+               tasks[i].stack_size_bytes, task->cpu_percent);
+    }
+  }
+}
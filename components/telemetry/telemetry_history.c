@@ -0,0 +1,56 @@
+/**
+ * Sample history and the threshold checks telemetry.c applies to it
+ */
+
+#include "telemetry_history.h"
+
+#include <string.h>
+
+void telemetry_history_init(telemetry_history *hist) {
+  memset(hist, 0, sizeof(*hist));
+}
+
+void telemetry_history_push(telemetry_history *hist,
+                            const telemetry_sample *sample) {
+  hist->samples[hist->next] = *sample;
+  hist->next                = (hist->next + 1) % TELEMETRY_HISTORY;
+  if (hist->count < TELEMETRY_HISTORY) {
+    hist->count++;
+  }
+}
+
+/**
+ * @param age - 0 for the newest sample, 1 for the one before, ...
+ * @returns the sample, or NULL if there aren't that many stored
+ */
+const telemetry_sample *telemetry_history_get(const telemetry_history *hist,
+                                              uint32_t age) {
+  if (age >= hist->count) {
+    return NULL;
+  }
+  uint32_t slot =
+      (hist->next + TELEMETRY_HISTORY - 1 - age) % TELEMETRY_HISTORY;
+  return &hist->samples[slot];
+}
+
+/**
+ * @param task_runtime_delta - run time counter increase since last sample, us
+ * @param wall_time_delta_us - time since last sample
+ * @returns percent of one core the task used, clamped to 100
+ */
+uint8_t telemetry_cpu_percent(uint32_t task_runtime_delta,
+                              int64_t wall_time_delta_us) {
+  if (wall_time_delta_us <= 0) {
+    return 0;
+  }
+  uint64_t percent = (uint64_t)task_runtime_delta * 100 / wall_time_delta_us;
+  return percent > 100 ? 100 : percent;
+}
+
+/**
+ * @returns true if a task with this stack high water mark is close enough
+ * to overflowing to warn about
+ */
+bool telemetry_stack_low(uint32_t stack_free_bytes, uint32_t margin_bytes) {
+  return stack_free_bytes < margin_bytes;
+}
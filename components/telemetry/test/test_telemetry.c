@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include "telemetry_history.h"
+#include "unity.h"
+
+static telemetry_history hist;
+
+static void push_sample(int64_t time_us) {
+  telemetry_sample sample = {.time_us = time_us};
+  telemetry_history_push(&hist, &sample);
+}
+
+TEST_CASE("telemetry history returns newest sample first", "[telemetry]") {
+  telemetry_history_init(&hist);
+  TEST_ASSERT_NULL(telemetry_history_get(&hist, 0));
+
+  push_sample(1);
+  push_sample(2);
+  TEST_ASSERT_EQUAL(2, telemetry_history_get(&hist, 0)->time_us);
+  TEST_ASSERT_EQUAL(1, telemetry_history_get(&hist, 1)->time_us);
+  TEST_ASSERT_NULL(telemetry_history_get(&hist, 2));
+}
+
+TEST_CASE("telemetry history overwrites the oldest sample", "[telemetry]") {
+  telemetry_history_init(&hist);
+  for (int i = 0; i < TELEMETRY_HISTORY + 3; i++) {
+    push_sample(i);
+  }
+  TEST_ASSERT_EQUAL_UINT32(TELEMETRY_HISTORY, hist.count);
+  TEST_ASSERT_EQUAL(TELEMETRY_HISTORY + 2,
+                    telemetry_history_get(&hist, 0)->time_us);
+  TEST_ASSERT_EQUAL(3, telemetry_history_get(&hist, TELEMETRY_HISTORY - 1)
+                           ->time_us);
+}
+
+TEST_CASE("telemetry cpu share and stack margin", "[telemetry]") {
+  TEST_ASSERT_EQUAL_UINT8(25, telemetry_cpu_percent(250000, 1000000));
+  TEST_ASSERT_EQUAL_UINT8(100, telemetry_cpu_percent(2000000, 1000000));
+  TEST_ASSERT_EQUAL_UINT8(0, telemetry_cpu_percent(5, 0));
+
+  TEST_ASSERT_TRUE(telemetry_stack_low(511, 512));
+  TEST_ASSERT_FALSE(telemetry_stack_low(512, 512));
+}
@@ -0,0 +1,28 @@
+#ifndef NEOPIXEL_H
+#define NEOPIXEL_H
+/**
+ * Host stub of the zorxx/neopixel API. Only what neopixel_display uses is
+ * provided; see neopixel_stub.h for the frame capture interface.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NP_RGB(r, g, b)                                           \
+  ((((uint32_t)(r) & 0xff) << 16) | (((uint32_t)(g) & 0xff) << 8) | \
+   ((uint32_t)(b) & 0xff))
+
+typedef void *tNeopixelContext;
+
+typedef struct {
+  uint32_t index;
+  uint32_t rgb;
+} tNeopixel;
+
+tNeopixelContext neopixel_Init(uint32_t pixelCount, int gpioPin);
+void neopixel_Deinit(tNeopixelContext ctx);
+bool neopixel_SetPixel(tNeopixelContext ctx, tNeopixel *pixel,
+                       uint32_t pixelCount);
+uint32_t neopixel_GetRefreshRate(tNeopixelContext ctx);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef NEOPIXEL_STUB_H
+#define NEOPIXEL_STUB_H
+/**
+ * Frame capture interface of the host neopixel stub.
+ *
+ * Every neopixel_SetPixel() call is appended to a fixed-size frame log, and
+ * the LED values it sets are applied to a copy of the strip, so tests can
+ * check both what was sent and what the panel would be showing.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "neopixel.h"
+
+// largest strip the stub can hold
+#define NEOPIXEL_STUB_MAX_PIXELS 4096
+// number of neopixel_SetPixel() calls kept in the log
+#define NEOPIXEL_STUB_MAX_CALLS 1024
+// total pixel writes kept in the log, across all calls
+#define NEOPIXEL_STUB_MAX_PIXEL_WRITES 16384
+
+// refresh rate reported by neopixel_GetRefreshRate(), like an 8x32 panel
+#define NEOPIXEL_STUB_REFRESH_RATE_HZ 100
+
+// maps [row][col] of the display to a strip index, eg display_led_index()
+typedef uint16_t (*neopixel_stub_led_index_fn)(uint16_t row, uint16_t col);
+
+void neopixel_stub_reset_log(void);
+
+uint32_t neopixel_stub_num_calls(void);
+uint32_t neopixel_stub_num_pixel_writes(void);
+bool neopixel_stub_log_overflowed(void);
+const tNeopixel *neopixel_stub_get_call(uint32_t call, uint32_t *count);
+
+uint32_t neopixel_stub_get_led(uint32_t index);
+
+void neopixel_stub_dump(FILE *out, uint16_t rows, uint16_t cols,
+                        neopixel_stub_led_index_fn led_index, bool ansi);
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * Host stub of the zorxx/neopixel driver with an in-memory frame log
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "neopixel_stub.h"
+
+typedef struct neopixel_stub_call {
+  uint32_t first;  // offset of this call's pixels in log_pixels
+  uint32_t count;
+} neopixel_stub_call;
+
+// the stub only ever hands out one context; its address is the handle
+static struct {
+  uint32_t pixel_count;
+  bool initialized;
+} stub_ctx;
+
+static uint32_t strip[NEOPIXEL_STUB_MAX_PIXELS];
+
+static neopixel_stub_call log_calls[NEOPIXEL_STUB_MAX_CALLS];
+static tNeopixel log_pixels[NEOPIXEL_STUB_MAX_PIXEL_WRITES];
+static uint32_t num_calls        = 0;
+static uint32_t num_pixel_writes = 0;
+static bool log_overflowed       = false;
+
+tNeopixelContext neopixel_Init(uint32_t pixelCount, int gpioPin) {
+  (void)gpioPin;
+  if (pixelCount > NEOPIXEL_STUB_MAX_PIXELS) {
+    return NULL;
+  }
+  stub_ctx.pixel_count = pixelCount;
+  stub_ctx.initialized = true;
+  memset(strip, 0, sizeof(strip));
+  return &stub_ctx;
+}
+
+void neopixel_Deinit(tNeopixelContext ctx) {
+  assert(ctx == &stub_ctx);
+  stub_ctx.initialized = false;
+}
+
+/**
+ * Apply pixels to the strip and append the call to the frame log.
+ * @note like the real driver, addressing the same index twice in one call is
+ * treated as a bug
+ */
+bool neopixel_SetPixel(tNeopixelContext ctx, tNeopixel *pixel,
+                       uint32_t pixelCount) {
+  assert(ctx == &stub_ctx && stub_ctx.initialized);
+
+  for (uint32_t i = 0; i < pixelCount; i++) {
+    assert(pixel[i].index < stub_ctx.pixel_count && "pixel index out of range");
+    for (uint32_t j = 0; j < i; j++) {
+      assert(pixel[j].index != pixel[i].index && "pixel addressed twice");
+    }
+    strip[pixel[i].index] = pixel[i].rgb;
+  }
+
+  if (num_calls == NEOPIXEL_STUB_MAX_CALLS ||
+      num_pixel_writes + pixelCount > NEOPIXEL_STUB_MAX_PIXEL_WRITES) {
+    log_overflowed = true;
+    return true;
+  }
+  log_calls[num_calls] = (neopixel_stub_call){num_pixel_writes, pixelCount};
+  memcpy(&log_pixels[num_pixel_writes], pixel, pixelCount * sizeof(tNeopixel));
+  num_calls++;
+  num_pixel_writes += pixelCount;
+  return true;
+}
+
+uint32_t neopixel_GetRefreshRate(tNeopixelContext ctx) {
+  (void)ctx;
+  return NEOPIXEL_STUB_REFRESH_RATE_HZ;
+}
+
+/**
+ * Empty the frame log. The strip contents are kept.
+ */
+void neopixel_stub_reset_log(void) {
+  num_calls        = 0;
+  num_pixel_writes = 0;
+  log_overflowed   = false;
+}
+
+uint32_t neopixel_stub_num_calls(void) { return num_calls; }
+
+uint32_t neopixel_stub_num_pixel_writes(void) { return num_pixel_writes; }
+
+bool neopixel_stub_log_overflowed(void) { return log_overflowed; }
+
+/**
+ * @param call - index of neopixel_SetPixel() call since the last reset
+ * @param count - set to number of pixels sent by that call
+ * @returns pixels sent by that call, or NULL if call isn't in the log
+ */
+const tNeopixel *neopixel_stub_get_call(uint32_t call, uint32_t *count) {
+  if (call >= num_calls) {
+    *count = 0;
+    return NULL;
+  }
+  *count = log_calls[call].count;
+  return &log_pixels[log_calls[call].first];
+}
+
+/**
+ * @returns color the LED at strip index `index` is currently set to
+ */
+uint32_t neopixel_stub_get_led(uint32_t index) {
+  assert(index < NEOPIXEL_STUB_MAX_PIXELS);
+  return strip[index];
+}
+
+/**
+ * Print what the panel is currently showing, one line per display row.
+ * @param ansi - draw each LED as a 24 bit ANSI background color instead of
+ * '.' for off and '#' for lit
+ */
+void neopixel_stub_dump(FILE *out, uint16_t rows, uint16_t cols,
+                        neopixel_stub_led_index_fn led_index, bool ansi) {
+  for (uint16_t row = 0; row < rows; row++) {
+    for (uint16_t col = 0; col < cols; col++) {
+      uint32_t rgb = strip[led_index(row, col)];
+      if (ansi) {
+        fprintf(out, "\x1b[48;2;%u;%u;%um  ", (unsigned)((rgb >> 16) & 0xff),
+                (unsigned)((rgb >> 8) & 0xff), (unsigned)(rgb & 0xff));
+      } else {
+        fputc(rgb ? '#' : '.', out);
+      }
+    }
+    fputs(ansi ? "\x1b[0m\n" : "\n", out);
+  }
+}
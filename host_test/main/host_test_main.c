@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+
+/**
+ * Runs all registered tests on the linux target and exits with the number of
+ * failures, so the host build can be used from CI
+ */
+void app_main(void) {
+  printf("\n#### Running all tests on host #####\n\n");
+  UNITY_BEGIN();
+  unity_run_all_tests();
+  int failures = UNITY_END();
+
+  exit(failures);
+}
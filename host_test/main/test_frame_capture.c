@@ -0,0 +1,347 @@
+/**
+ * Host-only tests for neopixel_display, checking what was actually sent to
+ * the (stub) neopixel driver instead of relying on someone watching a panel
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "neopixel_display.h"
+#include "neopixel_stub.h"
+#include "npix_tetris_defs.h"
+#include "unity.h"
+
+static uint16_t led_index(uint16_t row, uint16_t col) {
+  return display_led_index(row, col);
+}
+
+/**
+ * Check every LED on the strip matches the color the board says it should be
+ */
+static void assert_strip_matches_board(const TetrisBoard *tb) {
+  for (int row = 0; row < DISPLAY_ROWS; row++) {
+    for (int col = 0; col < DISPLAY_COLS; col++) {
+      TEST_ASSERT_EQUAL_HEX32(getRGBFromCellColor(tb->board[row][col]),
+                              neopixel_stub_get_led(led_index(row, col)));
+    }
+  }
+}
+
+static uint32_t count_lit_leds(void) {
+  uint32_t lit = 0;
+  for (int i = 0; i < PIXEL_COUNT; i++) lit += neopixel_stub_get_led(i) != 0;
+  return lit;
+}
+
+static bool led_lit(int row, int col) {
+  return neopixel_stub_get_led(led_index(row, col)) != 0;
+}
+
+TEST_CASE("clear_display turns every LED off", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  tb.board[0][0]      = Z_CELL_COLOR;
+  display_board(np, &tb);
+
+  neopixel_stub_reset_log();
+  clear_display(np);
+
+  TEST_ASSERT_EQUAL_UINT32(PIXEL_COUNT, neopixel_stub_num_pixel_writes());
+  for (int i = 0; i < PIXEL_COUNT; i++) {
+    TEST_ASSERT_EQUAL_HEX32(0, neopixel_stub_get_led(i));
+  }
+}
+
+TEST_CASE("display_board draws board at mapped LEDs", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+
+  tb.board[0][DISPLAY_COLS - 1]                = Z_CELL_COLOR;
+  tb.board[DISPLAY_ROWS - 1][0]                = J_CELL_COLOR;
+  tb.board[DISPLAY_ROWS / 2][DISPLAY_COLS / 2] = T_CELL_COLOR;
+
+  neopixel_stub_reset_log();
+  display_board(np, &tb);
+
+  TEST_ASSERT_EQUAL_UINT32(3, neopixel_stub_num_pixel_writes());
+  assert_strip_matches_board(&tb);
+}
+
+TEST_CASE("moving piece only sends changed LEDs", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+
+  // vertical I piece in column 2, then dropped by one row
+  for (int row = 4; row < 8; row++) tb.board[row][2] = I_CELL_COLOR;
+  display_board(np, &tb);
+
+  neopixel_stub_reset_log();
+  tb.board[4][2] = BG_COLOR;
+  tb.board[8][2] = I_CELL_COLOR;
+  display_board(np, &tb);
+
+  // one cell cleared at the top, one lit at the bottom, in a single call
+  TEST_ASSERT_EQUAL_UINT32(1, neopixel_stub_num_calls());
+  uint32_t count;
+  const tNeopixel *sent = neopixel_stub_get_call(0, &count);
+  TEST_ASSERT_EQUAL_UINT32(2, count);
+  TEST_ASSERT_TRUE(sent[0].index == led_index(4, 2) ||
+                   sent[1].index == led_index(4, 2));
+  TEST_ASSERT_TRUE(sent[0].index == led_index(8, 2) ||
+                   sent[1].index == led_index(8, 2));
+  assert_strip_matches_board(&tb);
+}
+
+TEST_CASE("board is fully redrawn after pause icon", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  display_board(np, &tb);
+
+  display_pause_icon(np);
+  TEST_ASSERT_EQUAL_UINT32(8, count_lit_leds());
+
+  display_board(np, &tb);
+  assert_strip_matches_board(&tb);
+}
+
+TEST_CASE("sprite bits map left to right", "[host]") {
+  static const uint32_t rows[] = {0b10001, 0b01000};
+  const display_sprite sprite  = {.rows = rows, .width = 5, .height = 2};
+  tNeopixelContext np          = init_neopixel_display();
+  clear_display(np);
+
+  display_sprite_over_board(np, &sprite, 4, 1);
+  TEST_ASSERT_EQUAL_UINT32(3, count_lit_leds());
+  TEST_ASSERT_TRUE(led_lit(4, 1));
+  TEST_ASSERT_TRUE(led_lit(4, 5));
+  TEST_ASSERT_TRUE(led_lit(5, 2));
+  TEST_ASSERT_EQUAL_HEX32(getRGBFromCellColor(OVERLAY_CELL_COLOR),
+                          neopixel_stub_get_led(led_index(4, 1)));
+}
+
+TEST_CASE("wide sprites are clipped to the display", "[host]") {
+  static const uint32_t rows[] = {0xffffffff, 0xffffffff, 0xffffffff};
+  const display_sprite wide    = {
+      .rows = rows, .width = DISPLAY_SPRITE_MAX_WIDTH, .height = 3};
+  const display_sprite small   = {.rows = rows, .width = 2, .height = 2};
+  tNeopixelContext np          = init_neopixel_display();
+
+  // hangs off the top, left and right
+  clear_display(np);
+  display_sprite_over_board(np, &wide, -1, -10);
+  TEST_ASSERT_EQUAL_UINT32(2 * DISPLAY_COLS, count_lit_leds());
+
+  // only the top left cell of this one lands on the display
+  clear_display(np);
+  display_sprite_over_board(np, &small, DISPLAY_ROWS - 1, DISPLAY_COLS - 1);
+  TEST_ASSERT_EQUAL_UINT32(1, count_lit_leds());
+  TEST_ASSERT_TRUE(led_lit(DISPLAY_ROWS - 1, DISPLAY_COLS - 1));
+
+  // entirely off the display
+  clear_display(np);
+  display_sprite_over_board(np, &wide, 0, DISPLAY_COLS);
+  display_sprite_over_board(np, &wide, 0, -DISPLAY_SPRITE_MAX_WIDTH);
+  display_sprite_over_board(np, &wide, DISPLAY_ROWS, 0);
+  display_sprite_over_board(np, &wide, -3, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, count_lit_leds());
+}
+
+TEST_CASE("text is drawn with the 3x5 font", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  clear_display(np);
+
+  // 010 / 110 / 010 / 010 / 111
+  display_text_over_board(np, "1", 0, 0);
+  TEST_ASSERT_EQUAL_UINT32(8, count_lit_leds());
+  TEST_ASSERT_FALSE(led_lit(0, 0));
+  TEST_ASSERT_TRUE(led_lit(0, 1));
+  TEST_ASSERT_TRUE(led_lit(1, 0));
+  for (int col = 0; col < DISPLAY_FONT_WIDTH; col++) {
+    TEST_ASSERT_TRUE(led_lit(4, col));
+  }
+
+  // scrolled so the "1" is off the left edge and only the "0" shows
+  clear_display(np);
+  display_text_over_board(np, "10", 10, -DISPLAY_FONT_ADVANCE);
+  TEST_ASSERT_EQUAL_UINT32(12, count_lit_leds());
+  TEST_ASSERT_FALSE(led_lit(11, 1));
+
+  // lower case is drawn as upper case, unknown characters as blanks
+  clear_display(np);
+  display_text_over_board(np, "~", 0, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, count_lit_leds());
+  display_text_over_board(np, "a", 0, 0);
+  uint32_t lower = count_lit_leds();
+  clear_display(np);
+  display_text_over_board(np, "A", 0, 0);
+  TEST_ASSERT_EQUAL_UINT32(lower, count_lit_leds());
+}
+
+TEST_CASE("composed frame goes out in one driver call", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  for (int col = 0; col < DISPLAY_COLS; col++) {
+    tb.board[DISPLAY_ROWS - 1][col] = Z_CELL_COLOR;
+  }
+  display_board(np, &tb);
+
+  display_scene scene = {.board    = &tb,
+                         .ghost    = DISPLAY_NO_PIECE,
+                         .piece    = DISPLAY_NO_PIECE,
+                         .text     = "8",
+                         .text_row = 20,
+                         .text_col = 0};
+  display_scene_pause_icon(&scene);
+  neopixel_stub_reset_log();
+  display_compose(np, &scene);
+
+  // pause icon and text, sent together
+  TEST_ASSERT_EQUAL_UINT32(1, neopixel_stub_num_calls());
+  TEST_ASSERT_EQUAL_UINT32(8 + 13, neopixel_stub_num_pixel_writes());
+  TEST_ASSERT_EQUAL_UINT32(DISPLAY_COLS + 8 + 13, count_lit_leds());
+
+  // composing the same scene again sends nothing
+  neopixel_stub_reset_log();
+  display_compose(np, &scene);
+  TEST_ASSERT_EQUAL_UINT32(0, neopixel_stub_num_calls());
+
+  // dropping the overlays puts the board back in one call
+  display_board(np, &tb);
+  TEST_ASSERT_EQUAL_UINT32(1, neopixel_stub_num_calls());
+  assert_strip_matches_board(&tb);
+}
+
+TEST_CASE("falling piece is highlighted over its ghost", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  // square piece at the top, on a board with one filled row at the bottom
+  display_piece piece = {.color = SQ_CELL_COLOR,
+                         .rows  = {0, 0, 1, 1},
+                         .cols  = {3, 4, 3, 4}};
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    tb.board[piece.rows[i]][piece.cols[i]] = SQ_CELL_COLOR;
+  }
+  for (int col = 0; col < DISPLAY_COLS; col++) {
+    tb.board[DISPLAY_ROWS - 1][col] = I_CELL_COLOR;
+  }
+
+  display_scene scene = {.board = &tb,
+                         .ghost = display_piece_ghost(&tb, &piece),
+                         .piece = piece};
+  display_compose(np, &scene);
+
+  uint32_t piece_rgb = active_piece_palette[SQ_CELL_COLOR];
+  uint32_t ghost_rgb = active_ghost_palette[SQ_CELL_COLOR];
+  TEST_ASSERT_FALSE(getRGBFromCellColor(SQ_CELL_COLOR) == piece_rgb);
+  TEST_ASSERT_EQUAL_HEX32(piece_rgb, neopixel_stub_get_led(led_index(0, 3)));
+  TEST_ASSERT_EQUAL_HEX32(piece_rgb, neopixel_stub_get_led(led_index(1, 4)));
+  // resting on the filled bottom row
+  uint16_t ghost_top = led_index(DISPLAY_ROWS - 3, 3);
+  uint16_t ghost_bot = led_index(DISPLAY_ROWS - 2, 4);
+  TEST_ASSERT_EQUAL_HEX32(ghost_rgb, neopixel_stub_get_led(ghost_top));
+  TEST_ASSERT_EQUAL_HEX32(ghost_rgb, neopixel_stub_get_led(ghost_bot));
+
+  // moving the piece down a row only touches the rows it and its ghost use
+  neopixel_stub_reset_log();
+  tb.board[0][3] = tb.board[0][4] = BG_COLOR;
+  tb.board[2][3] = tb.board[2][4] = SQ_CELL_COLOR;
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) piece.rows[i]++;
+  scene.piece = piece;
+  scene.ghost = display_piece_ghost(&tb, &piece);
+  display_compose(np, &scene);
+  TEST_ASSERT_EQUAL_UINT32(1, neopixel_stub_num_calls());
+  TEST_ASSERT_EQUAL_UINT32(4, neopixel_stub_num_pixel_writes());
+  TEST_ASSERT_EQUAL_HEX32(0, neopixel_stub_get_led(led_index(0, 3)));
+  TEST_ASSERT_EQUAL_HEX32(piece_rgb, neopixel_stub_get_led(led_index(2, 3)));
+}
+
+TEST_CASE("row effects only redraw the rows they change", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  display_scene scene = {
+      .board = &tb, .ghost = DISPLAY_NO_PIECE, .piece = DISPLAY_NO_PIECE};
+  display_compose(np, &scene);
+
+  // flashing a cleared row lights the whole of it and nothing else
+  neopixel_stub_reset_log();
+  scene.effect = (display_effect){.kind = DISPLAY_EFFECT_FLASH_ROWS,
+                                  .rows = {DISPLAY_ROWS - 1, -1, -1, -1}};
+  display_compose(np, &scene);
+  TEST_ASSERT_EQUAL_UINT32(DISPLAY_COLS, neopixel_stub_num_pixel_writes());
+  TEST_ASSERT_EQUAL_UINT32(DISPLAY_COLS, count_lit_leds());
+  for (int col = 0; col < DISPLAY_COLS; col++) {
+    TEST_ASSERT_TRUE(led_lit(DISPLAY_ROWS - 1, col));
+  }
+
+  // a curtain one row further down only pushes that row
+  scene.effect = (display_effect){.kind     = DISPLAY_EFFECT_CURTAIN,
+                                  .progress = 255 * 2 / DISPLAY_ROWS,
+                                  .rows     = {-1, -1, -1, -1}};
+  display_compose(np, &scene);
+  neopixel_stub_reset_log();
+  scene.effect.progress = 255 * 3 / DISPLAY_ROWS;
+  display_compose(np, &scene);
+  TEST_ASSERT_EQUAL_UINT32(DISPLAY_COLS, neopixel_stub_num_pixel_writes());
+  TEST_ASSERT_EQUAL_UINT32(3 * DISPLAY_COLS, count_lit_leds());
+}
+
+TEST_CASE("brightness change recolors lit cells only", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  tb.board[5][5]      = SQ_CELL_COLOR;
+  tb.board[6][5]      = SQ_CELL_COLOR;
+  display_board(np, &tb);
+
+  neopixel_stub_reset_log();
+  TEST_ASSERT_TRUE(set_display_brightness(DISPLAY_DEFAULT_BRIGHTNESS + 1));
+  display_board(np, &tb);
+
+  // background stays off, so only the two lit cells are resent
+  TEST_ASSERT_EQUAL_UINT32(2, neopixel_stub_num_pixel_writes());
+  assert_strip_matches_board(&tb);
+  set_display_brightness(DISPLAY_DEFAULT_BRIGHTNESS);
+}
+
+TEST_CASE("frame dump draws one line per row", "[host]") {
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  tb.board[1][0]      = S_CELL_COLOR;
+  display_board(np, &tb);
+
+  char buf[(DISPLAY_COLS + 1) * DISPLAY_ROWS + 1] = {0};
+
+  FILE *out = fmemopen(buf, sizeof(buf), "w");
+  TEST_ASSERT_NOT_NULL(out);
+  neopixel_stub_dump(out, DISPLAY_ROWS, DISPLAY_COLS, led_index, false);
+  fclose(out);
+
+  // second line starts with the lit cell
+  const char *row1 = strchr(buf, '\n') + 1;
+  TEST_ASSERT_EQUAL('#', row1[0]);
+  TEST_ASSERT_EQUAL('.', row1[1]);
+  TEST_ASSERT_EQUAL('.', buf[0]);
+}
+
+/**
+ * Not a pass/fail test - prints how long the render path takes on this
+ * machine, for comparing changes to display_board()
+ */
+TEST_CASE("benchmark display_board", "[host][bench]") {
+  const int frames    = 20000;
+  tNeopixelContext np = init_neopixel_display();
+  TetrisBoard tb      = init_board();
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < frames; i++) {
+    // move a single cell down the board, like a falling piece
+    tb.board[i % DISPLAY_ROWS][i % DISPLAY_COLS]       = BG_COLOR;
+    tb.board[(i + 1) % DISPLAY_ROWS][i % DISPLAY_COLS] = L_CELL_COLOR;
+    display_board(np, &tb);
+    neopixel_stub_reset_log();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+  printf("display_board: %.0f ns/frame over %d frames\n", ns / frames, frames);
+}
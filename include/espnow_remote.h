@@ -1,8 +1,12 @@
 #ifndef ESPNOW_REMOTE_H
 #define ESPNOW_REMOTE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "esp_now.h"
+#include "freertos/FreeRTOS.h"
+#include "input_event_ring.h"
 #include "npix_tetris_defs.h"
 
 // temporary constants (bc there has to be defaults in esp-idf, right?)
@@ -59,23 +63,30 @@ typedef struct espnow_msg_structure {
 } __attribute__((packed)) espnow_msg_structure;
 
 /**
+ * Received packet, copied by value through the receive queue
  * @param uint8_t mac_addr[ESP_NOW_ETH_ALEN];
- * @param uint8_t *data;
- * @param int data_len;
+ * @param uint8_t data[] - start of the payload, up to one Wizmote message
+ * @param int data_len - length of the packet as received (may be longer than
+ * data, in which case the rest was dropped)
  * @param example_espnow_event_id_t id;
+ * @param int64_t rx_time_us - when the packet came in, for latency tracing
  *
  */
 typedef struct example_espnow_event_recv_cb_t {
   uint8_t mac_addr[ESP_NOW_ETH_ALEN];
-  uint8_t *data;
+  uint8_t data[sizeof(espnow_msg_structure)];
   int data_len;
   uint8_t espnow_event_id;
+  int64_t rx_time_us;  // esp_timer_get_time() in the receive callback
 } example_espnow_event_recv_cb_t;
 
-typedef struct remote_button_info {
-  uint8_t program_val;
-  uint8_t button_val;
-} remote_button_info;
+typedef struct remote_recv_stats {
+  uint32_t packets_received;         // packets handed to us by ESP-NOW
+  uint32_t packets_invalid;          // packets with a bad address or no data
+  uint32_t packets_dropped;          // no free receive queue slot
+  uint32_t button_events_dropped;    // game task fell behind on presses
+  uint32_t button_events_max_depth;  // most presses ever waiting at once
+} remote_recv_stats;
 
 // FUNCTIONS
 
@@ -93,7 +104,8 @@ void get_button_name_from_number(const uint8_t button, char *button_name_str);
 esp_err_t espnow_remote_recv_init(void);
 void espnow_remote_recv_deinit(void);
 
-remote_button_info get_buttons_state(void);
-void reset_internal_buttons_state(void);
+bool wait_for_input_events(TickType_t timeout);
+bool next_input_event(input_event *event);
+remote_recv_stats get_remote_recv_stats(void);
 
 #endif
@@ -5,18 +5,38 @@
  *
  */
 
+#include "sdkconfig.h"
+
 #define TAG "esp32-neopixel-tetris"
 
 #define STAT_LED_PIN 2
 #define NEOPIXEL_PIN 21
+// button that wakes the board from deep sleep, -1 for none
+#define WAKE_BUTTON_PIN CONFIG_NPIX_WAKE_GPIO
+// data pins for each output channel when panels are driven in parallel;
+//  channel 0 is always NEOPIXEL_PIN
+#define NEOPIXEL_CHANNEL_PINS {NEOPIXEL_PIN, 22, 23, 19, 18, 5, 17, 16}
+
+// panel geometry is set in menuconfig under "Neopixel Display"
+#define DISPLAY_PANEL_ROWS   CONFIG_NPIX_PANEL_ROWS
+#define DISPLAY_PANEL_COLS   CONFIG_NPIX_PANEL_COLS
+#define DISPLAY_TILES_X      CONFIG_NPIX_TILES_X
+#define DISPLAY_TILES_Y      CONFIG_NPIX_TILES_Y
+#define DISPLAY_PANEL_PIXELS (DISPLAY_PANEL_ROWS * DISPLAY_PANEL_COLS)
+#define DISPLAY_NUM_TILES    (DISPLAY_TILES_X * DISPLAY_TILES_Y)
+#define DISPLAY_CHANNELS     CONFIG_NPIX_CHANNELS
 
-#define DISPLAY_ROWS 32
-#define DISPLAY_COLS 8
+#define DISPLAY_ROWS (DISPLAY_PANEL_ROWS * DISPLAY_TILES_Y)
+#define DISPLAY_COLS (DISPLAY_PANEL_COLS * DISPLAY_TILES_X)
 
-#define PIXEL_COUNT DISPLAY_ROWS* DISPLAY_COLS
+#define PIXEL_COUNT (DISPLAY_ROWS * DISPLAY_COLS)
 
 // if this value is too low, FreeRTOS stack overflow protection will detect
-// corruption
+// corruption. The display framebuffer is static, so drawing no longer needs
+// room for a frame on the stack, but the game task also formats 64-bit logs,
+// searches demo moves and plays back replays on it. Only go lower on the
+// strength of the high water marks telemetry_dump() reports on hardware; it
+// warns when any task gets within TELEMETRY_STACK_MARGIN_BYTES of the end.
 #define TASK_STACK_DEPTH_BYTES 4096
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef RENDER_TASK_H
+#define RENDER_TASK_H
+
+#include <stdint.h>
+
+#include "frame_mailbox.h"
+#include "npix_tetris_defs.h"
+#include "sdkconfig.h"
+
+// Pin the render task to whichever core the Wi-Fi/ESP-NOW stack isn't on, so
+//  LED output and radio traffic never compete for the same core
+#if CONFIG_FREERTOS_UNICORE
+#define RENDER_TASK_CORE tskNO_AFFINITY
+#elif CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define RENDER_TASK_CORE 0
+#else
+#define RENDER_TASK_CORE 1
+#endif
+
+#define RENDER_TASK_PRIORITY 4
+
+typedef struct render_stats {
+  frame_mailbox_stats mailbox;
+  uint32_t skipped;        // frames not drawn because nothing visible changed
+  int64_t first_frame_us;  // esp_timer time of the first frame drawn, or -1
+} render_stats;
+
+void render_task_start(void);
+
+display_frame *render_begin_frame(void);
+void render_publish_frame(void);
+
+render_stats render_get_stats(void);
+
+#endif
@@ -6,6 +6,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>  // MIN()
 #include <time.h>
 
 #include "freertos/FreeRTOS.h"
@@ -13,6 +14,7 @@
 #include "freertos/timers.h"
 // #include "nvs_flash.h"
 #include "esp_random.h"
+#include "esp_timer.h"
 // #include "esp_event.h"
 // #include "esp_netif.h"
 #include "esp_log.h"
@@ -23,9 +25,20 @@
 
 #include "driver/gpio.h"  // for LED panic function
 #include "espnow_remote.h"
+#include "latency_trace.h"
+#include "telemetry.h"
 
-// global struct for last buttons pressed on remote
-static remote_button_info button_info;
+// button presses waiting to be picked up by the game task. The receive task
+// is the only producer and the game task the only consumer
+static input_event_ring s_input_ring;
+static TaskHandle_t s_input_consumer_task;
+static remote_recv_stats recv_stats;
+
+// received packets are copied straight into these statically allocated queue
+// slots, so the receive path never touches the heap
+static StaticQueue_t s_espnow_queue_struct;
+static uint8_t s_espnow_queue_storage[ESPNOW_QUEUE_SIZE *
+                                      sizeof(example_espnow_event_recv_cb_t)];
 
 static uint32_t last_msg_seq = 0;  // seq number of last message
 // static espnow_msg_structure incoming;           // holds incoming message
@@ -120,41 +133,35 @@ void example_espnow_recv_cb(const esp_now_recv_info_t *recv_info,
 
   // example_espnow_event_t evt;
   example_espnow_event_recv_cb_t recv_cb;
-  uint8_t *mac_addr = recv_info->src_addr;
+  uint8_t *mac_addr  = recv_info->src_addr;
+  recv_cb.rx_time_us = esp_timer_get_time();
 
   // check for invalid packet
   if (mac_addr == NULL || data == NULL || len <= 0) {
-    ESP_LOGE(TAG, "Receive cb arg error");
-    //  return;     // these functions arent't ever supposed to return
+    recv_stats.packets_invalid++;
+    return;
   }
+  recv_stats.packets_received++;
 
-  // copy MAC addr and copy data for recv_cb
+  // copy MAC addr and payload into the queue slot itself - this runs in the
+  // Wi-Fi task, so nothing here allocates or logs. Anything past the Wizmote
+  // message is ignored by the parser anyway, so it's not copied
   memcpy(recv_cb.mac_addr, mac_addr, ESP_NOW_ETH_ALEN);
-
-  // this line causes fault????
-  recv_cb.data = malloc(len);
-
-  if (recv_cb.data == NULL) {
-    ESP_LOGE(TAG, "Malloc receive data fail");
-    return;  // these  functions aren't ever supposed to return
-  } else {
-    ESP_LOGD(TAG, "Malloc recv_cb.data len=%d SUCCESS: %p", len, recv_cb.data);
-  }
-  memcpy(recv_cb.data, data, len);
-
-  // add packet to queue to be processed
+  memcpy(recv_cb.data, data, MIN(len, sizeof(recv_cb.data)));
   recv_cb.data_len = len;
-  if (xQueueSend(s_example_espnow_queue, &recv_cb, ESPNOW_MAXDELAY) != pdTRUE) {
-    ESP_LOGE(TAG, "Send receive queue fail");
-    free(recv_cb.data);
+
+  // add packet to queue to be processed; if every slot is taken the packet
+  // is dropped (the Wizmote repeats each press several times anyway)
+  if (xQueueSend(s_example_espnow_queue, &recv_cb, 0) != pdTRUE) {
+    recv_stats.packets_dropped++;
   }
 }
 
 // FROM EXAMPLE
 /* Parse received ESPNOW data. */
 static uint8_t example_espnow_data_parse(uint8_t *data, uint16_t data_len,
-                                         uint8_t *program, uint32_t *seq,
-                                         uint8_t *button) {
+                                         int64_t rx_time_us, uint8_t *program,
+                                         uint32_t *seq, uint8_t *button) {
   espnow_msg_structure *buf = (espnow_msg_structure *)data;
   // uint16_t crc, crc_cal = 0;
 
@@ -176,9 +183,19 @@ static uint8_t example_espnow_data_parse(uint8_t *data, uint16_t data_len,
     return DATA_PARSE_STALE;
   }
 
-  // save button to global variable
-  button_info.button_val  = *button;
-  button_info.program_val = *program;
+  // queue the press for the game task and wake it up. Every press is kept,
+  // so several presses between game ticks are all applied
+  input_event event = {
+      .program    = *program,
+      .button     = *button,
+      .seq        = *seq,
+      .rx_time_us = rx_time_us,
+      .time_us    = esp_timer_get_time(),
+  };
+  if (input_event_ring_push(&s_input_ring, &event) &&
+      s_input_consumer_task != NULL) {
+    xTaskNotifyGive(s_input_consumer_task);
+  }
 
   last_msg_seq = *seq;
 
@@ -201,14 +218,18 @@ static void espnow_recv_task(void *pvParameter) {
 
   while (xQueueReceive(s_example_espnow_queue, &recv_cb, portMAX_DELAY) ==
          pdTRUE) {
-    ret = example_espnow_data_parse(recv_cb.data, recv_cb.data_len, &program,
-                                    &seq, &button);
+    int64_t dequeue_time_us = esp_timer_get_time();
+    latency_trace_record(LATENCY_RADIO_TO_DEQUEUE, recv_cb.rx_time_us,
+                         dequeue_time_us);
 
-    // original data not needed since we've parsed out the parts we want
-    ESP_LOGD(TAG, "Freeing recv_cb.data %p", recv_cb.data);
-    free(recv_cb.data);
+    ret = example_espnow_data_parse(recv_cb.data, recv_cb.data_len,
+                                    recv_cb.rx_time_us, &program, &seq,
+                                    &button);
 
     if (ret == DATA_PARSE_OK) {
+      latency_trace_record(LATENCY_DEQUEUE_TO_PARSE, dequeue_time_us,
+                           esp_timer_get_time());
+
       ESP_LOGD(TAG, "Receive seq=%ld data from: " MACSTR ", len: %d\n", seq,
                MAC2STR(recv_cb.mac_addr), recv_cb.data_len);
 
@@ -266,10 +287,12 @@ static void espnow_recv_task(void *pvParameter) {
 // a lot of this copied from espnow_example_main.c
 // static esp_err_t espnow_remote_recv_init(void) {
 esp_err_t espnow_remote_recv_init(void) {
-  s_example_espnow_queue =
-      xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(example_espnow_event_recv_cb_t));
+  s_example_espnow_queue = xQueueCreateStatic(
+      ESPNOW_QUEUE_SIZE, sizeof(example_espnow_event_recv_cb_t),
+      s_espnow_queue_storage, &s_espnow_queue_struct);
+  input_event_ring_init(&s_input_ring);
   if (s_example_espnow_queue == NULL) {
-    ESP_LOGE(TAG, "Create mutex fail");
+    ESP_LOGE(TAG, "Create queue fail");
     return ESP_FAIL;
   }
 
@@ -303,6 +326,7 @@ esp_err_t espnow_remote_recv_init(void) {
   TaskHandle_t recv_task_handle = NULL;
   xTaskCreate(espnow_recv_task, "espnow_recv_task", TASK_STACK_DEPTH_BYTES,
               recv_task_params, 4, &recv_task_handle);
+  telemetry_register_task(recv_task_handle, TASK_STACK_DEPTH_BYTES);
   // xTaskCreatePinnedToCore(espnow_recv_task, "espnow_recv_task",
   // TASK_STACK_DEPTH_BYTES, recv_task_params, 4, &recv_task_handle, 0);
   ESP_LOGI(
@@ -318,10 +342,40 @@ void espnow_remote_recv_deinit(void) {
   esp_now_deinit();
 }
 
-remote_button_info get_buttons_state(void) { return button_info; }
+/**
+ * Block until there are presses waiting, or `timeout` ticks pass. Only one
+ * task may wait for input; whichever calls this first becomes the consumer.
+ * @param timeout - ticks to wait; 0 to poll, portMAX_DELAY to wait forever
+ * @returns true if there are presses to take with next_input_event()
+ */
+bool wait_for_input_events(TickType_t timeout) {
+  if (s_input_consumer_task == NULL) {
+    s_input_consumer_task = xTaskGetCurrentTaskHandle();
+  }
+  // a press pushed between these two checks still leaves a notification
+  // pending, so the take below returns straight away
+  if (s_input_ring.head != s_input_ring.tail) {
+    return true;
+  }
+  ulTaskNotifyTake(pdTRUE, timeout);
+  return s_input_ring.head != s_input_ring.tail;
+}
+
+/**
+ * Take the oldest press that hasn't been handled yet, without blocking
+ * @returns false if there are none
+ */
+bool next_input_event(input_event *event) {
+  return input_event_ring_pop(&s_input_ring, event);
+}
 
-// reset values of button_info global variable back to zero
-void reset_internal_buttons_state(void) {
-  button_info.button_val  = 0;
-  button_info.program_val = 0;
+/**
+ * @returns counters for the receive path. Each counter is only written by one
+ * task, so they may be slightly out of date relative to each other
+ */
+remote_recv_stats get_remote_recv_stats(void) {
+  remote_recv_stats stats       = recv_stats;
+  stats.button_events_dropped   = s_input_ring.dropped;
+  stats.button_events_max_depth = s_input_ring.max_depth;
+  return stats;
 }
@@ -1,26 +1,125 @@
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>  // MAX()
 #include <time.h>
 
+#include "driver/rtc_io.h"  // wake button
+#include "esp_attr.h"        // RTC_DATA_ATTR
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_now.h"
-#include "esp_sleep.h"  // board poweroff on gameover
+#include "esp_pm.h"      // automatic light sleep
+#include "esp_random.h"  // seeds for recorded games
+#include "esp_sleep.h"   // board poweroff on gameover
+#include "esp_system.h"  // reset reason, to tell a wake from a cold boot
+#include "esp_timer.h"   // input latency timestamps
 #include "esp_wifi.h"
 #include "espnow_remote.h"  // my remote driver
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/timers.h"
+#include "autoplay.h"          // demo player for attract mode
+#include "autoplay_weights.h"  // tuned placement weights
+#include "display_anim.h"      // line clear, pause and game over effects
+#include "game_clock.h"        // fixed-timestep game ticks
+#include "game_snapshot.h"     // game kept through deep sleep
+#include "input_repeat.h"      // auto-repeat for held remote buttons
+#include "latency_trace.h"     // press-to-photon latency histograms
 #include "neopixel.h"          // fast neopixel library
 #include "neopixel_display.h"  // my neopixel array driver
 #include "npix_tetris_defs.h"  // project-wide definitions
 #include "nvs_flash.h"
-#include "tetris.h"  // tetris game library
+#include "render_task.h"   // display output runs on its own task
+#include "replay.h"        // game recordings
+#include "replay_flash.h"  // recordings kept in flash
+#include "telemetry.h"     // stack/heap/cpu usage sampling
+#include "tetris.h"        // tetris game library
 
-static SemaphoreHandle_t mutex;
+// score/level text scrolled under the play again icon at game over
+#define SCORE_TEXT_ROW       10
+#define SCORE_SCROLL_STEP_US 100000
+#define SCORE_SCROLL_PASSES  3
+
+// idle time on the play again screen before the demo game starts
+#define ATTRACT_DELAY_US ((int64_t)AUTOPLAY_ATTRACT_DELAY_S * 1000000)
+#if CONFIG_AUTOPLAY_LOOKAHEAD
+#define AUTOPLAY_LOOKAHEAD AUTOPLAY_ANY_PIECE
+#else
+#define AUTOPLAY_LOOKAHEAD AUTOPLAY_NO_PIECE
+#endif
+
+static void publish_frame(const TetrisGame *tg, uint8_t overlay,
+                          uint8_t brightness);
+static void publish_text_frame(const TetrisGame *tg, uint8_t overlay,
+                               uint8_t brightness, const char *text,
+                               int text_col);
+static enum player_move button_to_move(uint8_t button);
+static bool move_repeats(enum player_move move);
+static TickType_t us_to_ticks_ceil(int64_t us);
+static void game_tick_timer_cb(void *arg);
+static bool sleep_until_input(TickType_t timeout);
+static const TetrisGame *fresh_game(void);
+static TetrisGame *reset_game(void);
+static display_piece falling_piece(const TetrisGame *tg);
+static void tick_game(TetrisGame *tg, enum player_move move);
+static void queue_move(enum player_move move, const input_event *event);
+static void run_game_tick(TetrisGame *tg);
+static void start_anim(uint8_t anim, const int8_t *rows);
+static void record_input_latency(const input_event *event);
+static void play_demo(esp_timer_handle_t tick_timer, uint8_t brightness);
+static void play_replay(esp_timer_handle_t tick_timer, uint8_t brightness);
+static uint8_t restore_snapshot(void);
+static void deep_sleep(const TetrisGame *tg, uint8_t resume,
+                       uint8_t brightness);
+
+// the first press applied since the last frame was published, so the render
+// task can time it all the way to the LEDs
+static struct {
+  int64_t rx_us;
+  int64_t tick_us;
+  int64_t restart_rx_us;  // play again press, until the new game is shown
+} pending_input;
+
+// animation for the render task to start with the next frame published
+static struct {
+  uint8_t anim;
+  uint8_t seq;  // bumped for every animation started
+  int8_t rows[DISPLAY_EFFECT_MAX_ROWS];
+} pending_anim;
+
+// presses waiting for a game tick to run on, oldest first. Every tg_tick()
+// counts towards gravity in the tetris library, so each game tick runs at most
+// one move; presses that arrive faster than that queue up here instead
+#define MOVE_QUEUE_LEN INPUT_EVENT_RING_SIZE
+static struct {
+  enum player_move moves[MOVE_QUEUE_LEN];
+  input_event events[MOVE_QUEUE_LEN];  // press each move came from
+  bool pressed[MOVE_QUEUE_LEN];        // false for auto-repeats
+  uint8_t head;
+  uint8_t count;
+} move_queue;
+
+// the player's game, reset in place for every new game so restarting never
+// allocates
+static TetrisGame game;
+
+// how long the game task has spent blocked with nothing to do this game. Not
+// the same as time the chip slept: other tasks and the radio can keep it up
+static int64_t time_blocked_us;
+
+// every tg_tick() of the player's games, written to flash a sector at a time
+static replay_writer recording;
+
+// the game as it was when the board went into deep sleep; RTC memory keeps it
+// through sleep, but not through a reset
+static RTC_DATA_ATTR game_snapshot sleep_snapshot;
+// what to go back to after waking, set by restore_snapshot() before the game
+// task starts
+static uint8_t resume_from = GAME_SNAPSHOT_RESUME_NONE;
 
 /**
  * Game loop task - handles running tetris game and updating display
@@ -28,143 +127,325 @@ static SemaphoreHandle_t mutex;
 void tetris_game_loop_task(void *pvParameter) {
   (void)pvParameter;
 
-  remote_button_info buttons_state;
+  input_event event;
   char button_name_str[SHORT_STR_LEN];
   bool game_paused = false;
 
   TetrisGame *tg;
-  tNeopixelContext *neopixels;
+  uint8_t brightness = resume_from != GAME_SNAPSHOT_RESUME_NONE
+                           ? sleep_snapshot.brightness
+                           : DISPLAY_DEFAULT_BRIGHTNESS;
+  input_repeat repeat;
+  game_clock tick_clock;
+
+  // wakes this task at every game tick deadline. It's driven by esp_timer
+  // rather than the FreeRTOS tick, so it has microsecond resolution
+  esp_timer_handle_t tick_timer;
+  const esp_timer_create_args_t tick_timer_args = {
+      .callback = game_tick_timer_cb,
+      .arg      = xTaskGetCurrentTaskHandle(),
+      .name     = "game_tick",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&tick_timer_args, &tick_timer));
+
+  // one for the whole task, never reset: the hold that pauses, unpauses or
+  //  starts a game carries on into the next state, where the remote's
+  //  reports of it are dropped rather than taken for new presses
+  input_repeat_init(&repeat, &INPUT_REPEAT_DEFAULT_CONFIG);
 
 // logic for restarting game [goto is a necessary evil here :(]
 restart_game:
-  neopixels = init_neopixel_display();
-
-  tg                    = create_game();
+  // after a wake, restore_snapshot() has already put the game back in `game`
+  // and on the panel
+  tg = resume_from != GAME_SNAPSHOT_RESUME_NONE ? &game : reset_game();
+  bool woke_to_menu     = resume_from == GAME_SNAPSHOT_RESUME_MENU;
   enum player_move move = T_NONE;
+  int64_t game_start_us = esp_timer_get_time();
+  time_blocked_us       = 0;
+  move_queue.count      = 0;
 
-  create_rand_piece(tg);  // create first piece
-
-  clear_display(neopixels);
-  display_board(neopixels, &tg->active_board);
+  if (resume_from == GAME_SNAPSHOT_RESUME_NONE) {
+    // the recording only needs the seed to know every piece the game will
+    // draw
+    uint32_t seed = esp_random();
+    srand(seed);
+    replay_begin(&recording, seed);
+    create_rand_piece(tg);  // create first piece
+    publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+  } else {
+    // deep_sleep() reseeded the RNG and kept the seed in the snapshot, so
+    // the pieces carry on from that fresh seed rather than as they would
+    // have without the sleep. The rest of the game isn't recorded, since a
+    // replay has to start from scratch
+    srand(sleep_snapshot.rng_seed);
+    if (resume_from == GAME_SNAPSHOT_RESUME_GAME) {
+      set_stat_led_state(1);
+      game_paused = true;
+    }
+    game_snapshot_clear(&sleep_snapshot);
+    resume_from = GAME_SNAPSHOT_RESUME_NONE;
+  }
   ESP_LOGD(TAG, "Beginning main game loop\n");
 
-  while (!tg->game_over && move != T_QUIT) {
-    // if the game is currently paused
+  game_clock_init(&tick_clock, GAME_CLOCK_TICK_US, GAME_CLOCK_MAX_CATCHUP_TICKS,
+                  esp_timer_get_time());
+  if (!game_paused) {
+    esp_timer_start_periodic(tick_timer, GAME_CLOCK_TICK_US);
+  }
+
+  while (!woke_to_menu && !tg->game_over && move != T_QUIT) {
+    // if the game is currently paused, sleep until the remote unpauses it, or
+    // OFF puts the board to sleep with the game kept for later
     if (game_paused) {
-      // check if we've unpaused by now
-      if (get_buttons_state().button_val == WIZMOTE_BUTTON_NIGHT) {
+      if (!sleep_until_input(portMAX_DELAY) || !next_input_event(&event) ||
+          !input_repeat_press(&repeat, event.button, false, event.time_us)) {
+        continue;
+      }
+      if (event.button == WIZMOTE_BUTTON_NIGHT) {
         set_stat_led_state(0);
-        reset_internal_buttons_state();
-        display_board(neopixels, &tg->active_board);
+        publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
         ESP_LOGI(TAG, "GAME UNPAUSED");
         game_paused = false;
-        continue;
+        game_clock_resync(&tick_clock, esp_timer_get_time());
+        esp_timer_start_periodic(tick_timer, GAME_CLOCK_TICK_US);
+      } else if (event.button == WIZMOTE_BUTTON_OFF) {
+        ESP_LOGI(TAG, "Putting ESP to sleep, game paused");
+        replay_end(&recording, tg->score);
+        replay_flash_erase_ahead();
+        deep_sleep(tg, GAME_SNAPSHOT_RESUME_GAME, brightness);
       }
-      // if not, wait around and then check again
-      else {
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+      continue;
+    }
+
+    // sleep until a button is pressed, a held button is due to repeat, or
+    // tick_timer says the next game tick is due
+    sleep_until_input(us_to_ticks_ceil(input_repeat_next_deadline(&repeat) -
+                                       esp_timer_get_time()));
+
+    bool board_changed = false;
+
+    // queue every press that came in since last time, oldest first, so quick
+    // presses between ticks are never merged into one
+    while (!game_paused && move != T_QUIT && !tg->game_over &&
+           move_queue.count < MOVE_QUEUE_LEN && next_input_event(&event)) {
+      move = button_to_move(event.button);
+      // the remote reports a held button over and over; only the first
+      // report is a press, the rest just keep it held for auto-repeat
+      if (!input_repeat_press(&repeat, event.button, move_repeats(move),
+                              event.time_us)) {
         continue;
       }
+
+      switch (event.button) {
+        case (WIZMOTE_BUTTON_ON):  // dump latency stats and telemetry
+          strcpy(button_name_str, "ON");
+          latency_trace_dump();
+          telemetry_dump();
+          break;
+        case (WIZMOTE_BUTTON_OFF):  // QUIT
+          strcpy(button_name_str, "QUIT (off)");
+          ESP_LOGE(TAG, "QUITTING GAME!");
+          move = T_QUIT;
+          break;
+        case (WIZMOTE_BUTTON_NIGHT):  // PAUSE
+          strcpy(button_name_str, "PAUSE (night)");
+          set_stat_led_state(1);
+          game_paused = true;
+          esp_timer_stop(tick_timer);
+          ESP_LOGI(TAG, "GAME PAUSED!");
+          break;
+        case (WIZMOTE_BUTTON_BRIGHT_UP):  // brighter palette
+          strcpy(button_name_str, "BRIGHT_UP");
+          if (brightness < DISPLAY_NUM_BRIGHTNESS_LEVELS - 1) {
+            brightness++;
+            board_changed = true;
+          }
+          break;
+        case (WIZMOTE_BUTTON_BRIGHT_DOWN):  // dimmer palette
+          strcpy(button_name_str, "BRIGHT_DOWN");
+          if (brightness > 0) {
+            brightness--;
+            board_changed = true;
+          }
+          break;
+        default:  // LEFT (1), UP (2), DOWN (3), RIGHT (4)
+          break;
+      }
+
+      if (move != T_NONE && move != T_QUIT) {
+        queue_move(move, &event);
+      }
     }
 
-    // this function handles basically everything for the internal tetris game
-    // state
-    tg_tick(tg, move);
+    if (game_paused) {
+      start_anim(DISPLAY_ANIM_PAUSE, NULL);
+      publish_frame(tg, DISPLAY_OVERLAY_PAUSE, brightness);
+      continue;
+    }
 
-    // prevent trying to update display multiple times at once
-    // check if we can take the mutex with a wait time of 10 ticks
-    if (xSemaphoreTake(mutex, (TickType_t)10) == pdTRUE) {
-      // if we can take it, update the display.
-      display_board(neopixels, &tg->active_board);
-      xSemaphoreGive(mutex);
-      // if we couldn't take it, we just don't update the display this iteration
+    // auto-repeat for a held direction. The number of repeats comes from the
+    // press timestamps, so it doesn't depend on how late we got here. Each
+    // repeat takes its turn for a game tick like a press
+    uint8_t held_button;
+    uint32_t repeats =
+        input_repeat_poll(&repeat, esp_timer_get_time(), &held_button);
+    for (uint32_t i = 0; i < repeats && move_queue.count < MOVE_QUEUE_LEN;
+         i++) {
+      queue_move(button_to_move(held_button), NULL);
     }
 
-    switch (buttons_state.button_val) {
-      case (WIZMOTE_BUTTON_ON):  //
-        strcpy(button_name_str, "ON");
-        break;
-      case (WIZMOTE_BUTTON_OFF):  // QUIT
-        strcpy(button_name_str, "QUIT (off)");
-        ESP_LOGE(TAG, "QUITTING GAME!");
-        move = T_QUIT;
-        break;
-      case (WIZMOTE_BUTTON_NIGHT):  // PAUSE
-        strcpy(button_name_str, "PAUSE (night)");
-        set_stat_led_state(1);
-        game_paused = true;
-        ESP_LOGI(TAG, "GAME PAUSED!");
-        move = T_NONE;
-        display_pause_icon(neopixels);
-        break;
+    // game ticks, on a fixed timestep, each with the oldest queued move if
+    // there is one. If we fell behind, the missed ticks all run now (up to
+    // GAME_CLOCK_MAX_CATCHUP_TICKS), so game speed doesn't depend on how long
+    // each tick took
+    uint32_t ticks = game_clock_ticks_due(&tick_clock, esp_timer_get_time());
+    for (uint32_t i = 0; i < ticks && move != T_QUIT && !tg->game_over; i++) {
+      run_game_tick(tg);
+      board_changed = true;
+    }
 
-      case (WIZMOTE_BUTTON_ONE):  // LEFT
-        strcpy(button_name_str, "LEFT (1)");
-        move = T_LEFT;
-        break;
-      case (WIZMOTE_BUTTON_TWO):  // UP
-        strcpy(button_name_str, "UP (2)");
-        move = T_UP;
-        break;
-      case (WIZMOTE_BUTTON_THREE):  // DOWN
-        strcpy(button_name_str, "DOWN (3)");
-        move = T_DOWN;
-        break;
-      case (WIZMOTE_BUTTON_FOUR):  // RIGHT
-        strcpy(button_name_str, "RIGHT (4)");
-        move = T_RIGHT;
-        break;
-      case (WIZMOTE_BUTTON_BRIGHT_UP):  //
-        strcpy(button_name_str, "BRIGHT_UP");
-        break;
-      case (WIZMOTE_BUTTON_BRIGHT_DOWN):  //
-        strcpy(button_name_str, "BRIGHT_DOWN");
-        break;
-      default:
-        move = T_NONE;
+    // a press doesn't wait for the next deadline: its tick runs now, and the
+    // clock skips the one it took, so pressing buttons never speeds up
+    // gravity
+    while (move_queue.count > 0 && move != T_QUIT && !tg->game_over &&
+           game_clock_take_tick(&tick_clock, esp_timer_get_time())) {
+      run_game_tick(tg);
+      board_changed = true;
     }
-    buttons_state = get_buttons_state();
-    reset_internal_buttons_state();
 
-    vTaskDelay(pdMS_TO_TICKS(15));
+    // hand the board to the render task; this never blocks, and if the
+    // previous frame hasn't been drawn yet it's simply replaced
+    if (board_changed) {
+      publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+    }
   }
 
-  display_board(neopixels, &tg->active_board);
+  esp_timer_stop(tick_timer);
+  if (!woke_to_menu) {
+    start_anim(DISPLAY_ANIM_GAME_OVER, NULL);
+    publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+  }
+  replay_end(&recording, tg->score);
+  // between games is the time to erase flash for the next recording
+  replay_flash_erase_ahead();
   printTetrisBoardToLog(&tg->active_board);
   ESP_LOGI(TAG, "Game over! Level=%ld, Score=%ld\n", tg->level, tg->score);
-  // wait for print to finish before aborting
-  vTaskDelay(pdMS_TO_TICKS(300));
-  display_play_again_icon(neopixels);
+  ESP_LOGI(TAG, "Recorded %ld moves in %ld bytes, press 1 to replay",
+           recording.moves, recording.bytes);
+  display_stats dstats = get_display_stats();
+  ESP_LOGI(TAG, "Display: frames=%ld full_refreshes=%ld pixels_pushed=%lld",
+           dstats.frames, dstats.full_refreshes, dstats.pixels_pushed_total);
+  latency_trace_dump();
+  const game_clock_stats *cstats = &tick_clock.stats;
+  ESP_LOGI(TAG,
+           "Game clock: ticks=%ld early=%ld overruns=%ld dropped=%ld late "
+           "p50=%ldus p99=%ldus max=%ldus",
+           cstats->ticks, cstats->early_ticks, cstats->overruns,
+           cstats->dropped_ticks,
+           latency_hist_percentile(&cstats->lateness, 50),
+           latency_hist_percentile(&cstats->lateness, 99),
+           cstats->lateness.max_us);
+  remote_recv_stats recv_stats = get_remote_recv_stats();
+  ESP_LOGI(TAG,
+           "Remote: packets=%ld invalid=%ld dropped=%ld presses_dropped=%ld "
+           "max_presses_queued=%ld",
+           recv_stats.packets_received, recv_stats.packets_invalid,
+           recv_stats.packets_dropped, recv_stats.button_events_dropped,
+           recv_stats.button_events_max_depth);
+  render_stats rstats = render_get_stats();
+  ESP_LOGI(TAG, "Frames: published=%ld rendered=%ld superseded=%ld skipped=%ld",
+           rstats.mailbox.published, rstats.mailbox.rendered,
+           rstats.mailbox.superseded, rstats.skipped);
+  // the same for every game until the next reset; compare a wake from deep
+  //  sleep against a cold boot
+  ESP_LOGI(TAG, "Startup: first frame %lldms after %s",
+           rstats.first_frame_us / 1000,
+           esp_reset_reason() == ESP_RST_DEEPSLEEP ? "waking from deep sleep"
+                                                   : "reset");
+  int64_t game_us = esp_timer_get_time() - game_start_us;
+  ESP_LOGI(TAG, "Game task blocked for %lldms of %lldms",
+           time_blocked_us / 1000, game_us / 1000);
+#if CONFIG_PM_PROFILING
+  // how long the chip actually spent in each power mode, light sleep included
+  esp_pm_dump_locks(stdout);
+#endif
+  telemetry_dump();
+
+  // scroll the score across the panel a few times, then leave just the icon
+  char score_text[DISPLAY_TEXT_MAX_LEN];
+  snprintf(score_text, sizeof(score_text), "SCORE %ld LEVEL %ld", tg->score,
+           tg->level);
+  int score_col          = DISPLAY_SCENE_COLS;
+  int scroll_passes_left = SCORE_SCROLL_PASSES;
+  int64_t next_scroll_us = esp_timer_get_time();
+  int64_t attract_at_us  = INT64_MAX;
 
   ESP_LOGI(TAG, "Waiting for user input on play again:");
   enum play_again_enum { WAIT_RESPOSNE, PLAY_AGAIN, GOTO_SLEEP };
   enum play_again_enum play_again_resp = WAIT_RESPOSNE;
   while (play_again_resp == WAIT_RESPOSNE) {
-    switch (buttons_state.button_val) {
+    if (scroll_passes_left > 0 && esp_timer_get_time() >= next_scroll_us) {
+      if (--score_col < -display_text_width(score_text)) {
+        score_col = DISPLAY_SCENE_COLS;
+        scroll_passes_left--;
+      }
+      publish_text_frame(tg, DISPLAY_OVERLAY_PLAY_AGAIN, brightness,
+                         scroll_passes_left > 0 ? score_text : "", score_col);
+      next_scroll_us += SCORE_SCROLL_STEP_US;
+    }
+    if (scroll_passes_left == 0 && attract_at_us == INT64_MAX &&
+        AUTOPLAY_ATTRACT_DELAY_S > 0) {
+      attract_at_us = esp_timer_get_time() + ATTRACT_DELAY_US;
+    }
+
+    // nobody has touched the remote for a while: show off with a demo game
+    // until they do, then back to this screen to handle the press
+    if (esp_timer_get_time() >= attract_at_us) {
+      play_demo(tick_timer, brightness);
+      publish_text_frame(tg, DISPLAY_OVERLAY_PLAY_AGAIN, brightness, "", 0);
+      attract_at_us = esp_timer_get_time() + ATTRACT_DELAY_US;
+    }
+
+    // once the score is done scrolling, nothing happens until the remote is
+    // pressed or it's time for the demo, so block until then
+    TickType_t timeout =
+        scroll_passes_left > 0
+            ? us_to_ticks_ceil(next_scroll_us - esp_timer_get_time())
+            : us_to_ticks_ceil(attract_at_us - esp_timer_get_time());
+    if (!sleep_until_input(timeout) || !next_input_event(&event) ||
+        !input_repeat_press(&repeat, event.button, false, event.time_us)) {
+      continue;
+    }
+
+    switch (event.button) {
+      case (WIZMOTE_BUTTON_ONE):  // watch the last game again
+        play_replay(tick_timer, brightness);
+        publish_text_frame(tg, DISPLAY_OVERLAY_PLAY_AGAIN, brightness, "", 0);
+        if (attract_at_us != INT64_MAX) {
+          attract_at_us = esp_timer_get_time() + ATTRACT_DELAY_US;
+        }
+        break;
       case (WIZMOTE_BUTTON_OFF):
         ESP_LOGI(TAG, "Quitting game, putting ESP to sleep now");
         play_again_resp = GOTO_SLEEP;
         break;
-      case (WIZMOTE_BUTTON_ON || WIZMOTE_BUTTON_NIGHT):
+      case (WIZMOTE_BUTTON_ON):
+      case (WIZMOTE_BUTTON_NIGHT):
         ESP_LOGI(TAG, "New game requested!");
-        play_again_resp = PLAY_AGAIN;
+        play_again_resp             = PLAY_AGAIN;
+        pending_input.restart_rx_us = event.rx_time_us;
         break;
       default:
-        vTaskDelay(pdMS_TO_TICKS(150));
+        // someone's there, so hold off on the demo
+        if (attract_at_us != INT64_MAX) {
+          attract_at_us = esp_timer_get_time() + ATTRACT_DELAY_US;
+        }
         break;
     }
-
-    buttons_state = get_buttons_state();
-    reset_internal_buttons_state();
   }
 
-  // if we're here, game is over; dealloc tg
-  end_game(tg);
-  deinit_neopixel_display(neopixels);
-
   if (play_again_resp == GOTO_SLEEP) {
-    // Deep sleep requires a hard reset/power cycle to exit
-    esp_deep_sleep_start();
+    deep_sleep(tg, GAME_SNAPSHOT_RESUME_MENU, brightness);
   }
 
   goto restart_game;
@@ -172,9 +453,415 @@ restart_game:
   assert(0 && "task functions should not exit");
 }
 
+/**
+ * Attract mode: the bot plays a game through tg_tick(), one call per game
+ * tick with its move or T_NONE, the same as a player's moves are run. Runs
+ * until the game is over or the remote is pressed; the press is left queued
+ * for the caller.
+ */
+static void play_demo(esp_timer_handle_t tick_timer, uint8_t brightness) {
+  // a game of its own, so the finished game behind the play again screen,
+  //  and what deep sleep saves from there, are left alone
+  static TetrisGame demo_game;
+  demo_game      = *fresh_game();
+  TetrisGame *tg = &demo_game;
+  autoplay_bot bot;
+  game_clock tick_clock;
+  int64_t slowest_move_us = 0;
+
+  ESP_LOGI(TAG, "Starting demo game");
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, AUTOPLAY_LOOKAHEAD);
+  create_rand_piece(tg);
+  publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+  game_clock_init(&tick_clock, GAME_CLOCK_TICK_US, GAME_CLOCK_MAX_CATCHUP_TICKS,
+                  esp_timer_get_time());
+  esp_timer_start_periodic(tick_timer, GAME_CLOCK_TICK_US);
+
+  while (!tg->game_over && !sleep_until_input(portMAX_DELAY)) {
+    uint32_t ticks = game_clock_ticks_due(&tick_clock, esp_timer_get_time());
+    for (uint32_t i = 0; i < ticks && !tg->game_over; i++) {
+      // planning a new piece is the slow part, so time every move
+      int64_t start_us      = esp_timer_get_time();
+      enum player_move move = autoplay_next_move(&bot, tg);
+      int64_t move_us       = esp_timer_get_time() - start_us;
+      slowest_move_us       = MAX(slowest_move_us, move_us);
+
+      tick_game(tg, move);
+    }
+    if (ticks > 0) {
+      publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+    }
+  }
+
+  esp_timer_stop(tick_timer);
+  ESP_LOGI(TAG,
+           "Demo over: score=%ld level=%ld pieces=%ld evals=%ld slowest "
+           "move=%lldus",
+           tg->score, tg->level, bot.pieces, bot.evals, slowest_move_us);
+}
+
+/**
+ * Play the last recorded game back on the panel, through the same tg_tick()
+ * calls at the same game speed: one recorded tick per game tick. Runs until
+ * the recording ends or the remote is pressed; the press is left queued for
+ * the caller.
+ */
+static void play_replay(esp_timer_handle_t tick_timer, uint8_t brightness) {
+  // holds a whole flash sector, too big for the stack
+  static replay_reader reader;
+  if (!replay_flash_open_last(&reader)) {
+    ESP_LOGW(TAG, "No recorded game to replay");
+    return;
+  }
+
+  // a game of its own, like the demo's
+  static TetrisGame replay_game;
+  replay_game    = *fresh_game();
+  TetrisGame *tg = &replay_game;
+  game_clock tick_clock;
+  bool playing = true;
+
+  ESP_LOGI(TAG, "Replaying game with seed %08lx", reader.seed);
+  replay_start_game(&reader, tg);
+  publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+  game_clock_init(&tick_clock, GAME_CLOCK_TICK_US, GAME_CLOCK_MAX_CATCHUP_TICKS,
+                  esp_timer_get_time());
+  esp_timer_start_periodic(tick_timer, GAME_CLOCK_TICK_US);
+
+  while (playing && !sleep_until_input(portMAX_DELAY)) {
+    uint32_t ticks = game_clock_ticks_due(&tick_clock, esp_timer_get_time());
+    for (uint32_t i = 0; i < ticks && playing; i++) {
+      enum player_move move;
+      if ((playing = replay_next(&reader, &move))) {
+        tick_game(tg, move);
+      }
+    }
+    if (ticks > 0) {
+      publish_frame(tg, DISPLAY_OVERLAY_NONE, brightness);
+    }
+  }
+
+  esp_timer_stop(tick_timer);
+  if (reader.complete && (uint32_t)tg->score != reader.score) {
+    ESP_LOGE(TAG, "Replay diverged: score=%ld, recorded %ld", tg->score,
+             reader.score);
+  } else {
+    ESP_LOGI(TAG, "Replay over: score=%ld%s", tg->score,
+             reader.complete ? "" : " (recording cut short)");
+  }
+}
+
+/**
+ * After waking from deep sleep, put the game kept in RTC memory back in
+ * `game` and on the panel. This runs before Wi-Fi and ESP-NOW are brought
+ * up, so the board is back well before the remote works.
+ * @returns what the game task should carry on with, or
+ * GAME_SNAPSHOT_RESUME_NONE if there's no snapshot to go back to
+ */
+static uint8_t restore_snapshot(void) {
+  TetrisGame *tg = reset_game();
+  if (!game_snapshot_restore(&sleep_snapshot, tg)) {
+    ESP_LOGW(TAG, "Woke from deep sleep without a game to resume");
+    return GAME_SNAPSHOT_RESUME_NONE;
+  }
+
+  uint8_t brightness = sleep_snapshot.brightness;
+  if (sleep_snapshot.resume == GAME_SNAPSHOT_RESUME_GAME) {
+    start_anim(DISPLAY_ANIM_PAUSE, NULL);
+    publish_frame(tg, DISPLAY_OVERLAY_PAUSE, brightness);
+  } else {
+    publish_text_frame(tg, DISPLAY_OVERLAY_PLAY_AGAIN, brightness, "", 0);
+  }
+  ESP_LOGI(TAG, "Woke from deep sleep, resuming %s with score %ld",
+           sleep_snapshot.resume == GAME_SNAPSHOT_RESUME_GAME ? "paused game"
+                                                              : "play again",
+           tg->score);
+  return sleep_snapshot.resume;
+}
+
+/**
+ * Keep `tg` in RTC memory and deep sleep until the wake button is pressed,
+ * then come back to `resume` (enum game_snapshot_resume). A reset or power
+ * cycle starts from scratch instead. Never returns.
+ */
+static void deep_sleep(const TetrisGame *tg, uint8_t resume,
+                       uint8_t brightness) {
+  // reseed, so the pieces after waking don't depend on RNG state that's lost
+  uint32_t seed = esp_random();
+  srand(seed);
+  game_snapshot_save(&sleep_snapshot, tg, resume, brightness, seed);
+
+  // blank the panel, and give the render task time to draw it before sleep
+  TetrisGame blank   = *tg;
+  blank.active_board = init_board();
+  blank.game_over    = true;
+  publish_frame(&blank, DISPLAY_OVERLAY_NONE, brightness);
+  vTaskDelay(pdMS_TO_TICKS(100));
+
+#if WAKE_BUTTON_PIN >= 0
+  // held high by the RTC pull-up while asleep; pressing the button pulls it
+  // to ground
+  if (rtc_gpio_is_valid_gpio(WAKE_BUTTON_PIN)) {
+    rtc_gpio_pullup_en(WAKE_BUTTON_PIN);
+    rtc_gpio_pulldown_dis(WAKE_BUTTON_PIN);
+    ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(WAKE_BUTTON_PIN, 0));
+    ESP_LOGI(TAG, "Sleeping until GPIO %d is pulled low", WAKE_BUTTON_PIN);
+  } else {
+    ESP_LOGE(TAG, "GPIO %d can't wake from deep sleep", WAKE_BUTTON_PIN);
+  }
+#endif
+  esp_deep_sleep_start();
+}
+
+/**
+ * Copy game state into a frame and hand it to the render task
+ */
+static void publish_frame(const TetrisGame *tg, uint8_t overlay,
+                          uint8_t brightness) {
+  publish_text_frame(tg, overlay, brightness, "", 0);
+}
+
+/**
+ * Same as publish_frame(), with a line of text drawn over the board at
+ * SCORE_TEXT_ROW
+ * @param text - text to draw, truncated to fit the frame; "" for none
+ * @param text_col - column of the first character, may be off the display
+ */
+static void publish_text_frame(const TetrisGame *tg, uint8_t overlay,
+                               uint8_t brightness, const char *text,
+                               int text_col) {
+  display_frame *frame = render_begin_frame();
+  frame->board         = tg->active_board;
+  frame->piece         = falling_piece(tg);
+  frame->overlay       = overlay;
+  frame->brightness    = brightness;
+  frame->text_row      = SCORE_TEXT_ROW;
+  frame->text_col      = text_col;
+  snprintf(frame->text, sizeof(frame->text), "%s", text);
+  frame->input.rx_us         = pending_input.rx_us;
+  frame->input.tick_us       = pending_input.tick_us;
+  frame->input.restart_rx_us = pending_input.restart_rx_us;
+  frame->anim          = pending_anim.anim;
+  frame->anim_seq      = pending_anim.seq;
+  memcpy(frame->anim_rows, pending_anim.rows, sizeof(frame->anim_rows));
+  pending_input.rx_us = 0;
+  pending_anim.anim   = DISPLAY_ANIM_NONE;
+
+  pending_input.restart_rx_us = 0;
+  render_publish_frame();
+}
+
+/**
+ * Run one tg_tick(), and queue up an animation for anything worth showing:
+ * cleared lines flash, and a new level pulses the board
+ */
+static void tick_game(TetrisGame *tg, enum player_move move) {
+  long score = tg->score;
+  long level = tg->level;
+
+  // the library clears full rows inside tg_tick(), so note them beforehand.
+  // The falling piece is already drawn where it is, so the rows it would
+  // clear by locking in place are full now
+  int8_t full_rows[DISPLAY_EFFECT_MAX_ROWS];
+  int num_full = 0;
+  memset(full_rows, -1, sizeof(full_rows));
+  for (int row = 0; row < TETRIS_ROWS && num_full < DISPLAY_EFFECT_MAX_ROWS;
+       row++) {
+    bool full = true;
+    for (int col = 0; col < TETRIS_COLS && full; col++) {
+      full = tg->active_board.board[row][col] != BG_COLOR;
+    }
+    if (full) {
+      full_rows[num_full++] = row;
+    }
+  }
+
+  tg_tick(tg, move);
+  replay_record(&recording, move);
+
+  if (tg->level > level) {
+    start_anim(DISPLAY_ANIM_LEVEL_UP, NULL);
+  } else if (num_full > 0 && tg->score > score) {
+    start_anim(DISPLAY_ANIM_LINE_CLEAR, full_rows);
+  }
+}
+
+/**
+ * Queue a move for the next game tick that's free
+ * @param event - press the move came from, NULL for an auto-repeat
+ */
+static void queue_move(enum player_move move, const input_event *event) {
+  assert(move_queue.count < MOVE_QUEUE_LEN);
+  uint8_t slot = (move_queue.head + move_queue.count) % MOVE_QUEUE_LEN;
+
+  move_queue.moves[slot]   = move;
+  move_queue.pressed[slot] = event != NULL;
+  if (event != NULL) {
+    move_queue.events[slot] = *event;
+  }
+  move_queue.count++;
+}
+
+/**
+ * Run one game tick, with the oldest queued move if there is one
+ */
+static void run_game_tick(TetrisGame *tg) {
+  if (move_queue.count == 0) {
+    tick_game(tg, T_NONE);
+    return;
+  }
+
+  uint8_t slot    = move_queue.head;
+  move_queue.head = (move_queue.head + 1) % MOVE_QUEUE_LEN;
+  move_queue.count--;
+  // this function handles basically everything for the internal tetris game
+  // state
+  tick_game(tg, move_queue.moves[slot]);
+  if (move_queue.pressed[slot]) {
+    record_input_latency(&move_queue.events[slot]);
+  }
+}
+
+/**
+ * Have the render task start animation `anim` with the next frame published
+ * @param rows - rows for row effects, see display_anim_start()
+ */
+static void start_anim(uint8_t anim, const int8_t *rows) {
+  pending_anim.anim = anim;
+  pending_anim.seq++;
+  if (rows != NULL) {
+    memcpy(pending_anim.rows, rows, sizeof(pending_anim.rows));
+  } else {
+    memset(pending_anim.rows, -1, sizeof(pending_anim.rows));
+  }
+}
+
+/**
+ * Cells of the piece that's currently falling, for the display to highlight
+ * @returns DISPLAY_NO_PIECE once the game is over
+ */
+static display_piece falling_piece(const TetrisGame *tg) {
+  const TetrisPiece *tp = &tg->active_piece;
+  if (tg->game_over) {
+    return DISPLAY_NO_PIECE;
+  }
+
+  display_piece piece = {.color = tp->ptype};
+  for (int i = 0; i < DISPLAY_PIECE_CELLS; i++) {
+    const Coord *cell = &TETROMINOS[tp->ptype][tp->orientation][i];
+    piece.rows[i]     = tp->loc.row + cell->row;
+    piece.cols[i]     = tp->loc.col + cell->col;
+  }
+  return piece;
+}
+
+/**
+ * A freshly created game to copy from. The tetris library only hands out heap
+ * allocated games, so one is created the first time through and kept as a
+ * template; after that starting a game is just a copy.
+ */
+static const TetrisGame *fresh_game(void) {
+  static TetrisGame template;
+  static bool have_template = false;
+
+  if (!have_template) {
+    TetrisGame *created = create_game();
+    template            = *created;
+    have_template       = true;
+    end_game(created);
+  }
+  return &template;
+}
+
+/**
+ * Put `game` back to the state of a freshly created game
+ * @returns the game to play
+ */
+static TetrisGame *reset_game(void) {
+  game = *fresh_game();
+  return &game;
+}
+
+/**
+ * @returns the move a direction button makes, or T_NONE for other buttons
+ */
+static enum player_move button_to_move(uint8_t button) {
+  switch (button) {
+    case (WIZMOTE_BUTTON_ONE):
+      return T_LEFT;
+    case (WIZMOTE_BUTTON_TWO):
+      return T_UP;
+    case (WIZMOTE_BUTTON_THREE):
+      return T_DOWN;
+    case (WIZMOTE_BUTTON_FOUR):
+      return T_RIGHT;
+    default:
+      return T_NONE;
+  }
+}
+
+// rotating repeatedly while held is never what the player wants
+static bool move_repeats(enum player_move move) {
+  return move == T_LEFT || move == T_RIGHT || move == T_DOWN;
+}
+
+// rounded up, so waiting this long never wakes up before `us` has passed
+static TickType_t us_to_ticks_ceil(int64_t us) {
+  const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+  if (us <= 0) {
+    return 0;
+  }
+  if (us >= (int64_t)portMAX_DELAY * tick_us) {
+    return portMAX_DELAY;
+  }
+  return (us + tick_us - 1) / tick_us;
+}
+
+/**
+ * Block until there's input to handle or `timeout` passes, keeping count of
+ * how long the game task spent blocked. With automatic light sleep enabled,
+ * this is where the chip gets to sleep, if nothing else is keeping it awake.
+ */
+static bool sleep_until_input(TickType_t timeout) {
+  int64_t start_us = esp_timer_get_time();
+  bool ready       = wait_for_input_events(timeout);
+
+  time_blocked_us += esp_timer_get_time() - start_us;
+  return ready;
+}
+
+// runs in the esp_timer task; just wake the game task, which does the rest
+static void game_tick_timer_cb(void *arg) {
+  xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+/**
+ * Called once tg_tick has applied a press
+ */
+static void record_input_latency(const input_event *event) {
+  int64_t now_us = esp_timer_get_time();
+  latency_trace_record(LATENCY_PARSE_TO_TICK, event->time_us, now_us);
+  if (pending_input.rx_us == 0) {
+    pending_input.rx_us   = event->rx_time_us;
+    pending_input.tick_us = now_us;
+  }
+}
+
 void app_main(void) {
   ESP_LOGI(TAG, "Starting main");
 
+  // stack, heap and CPU usage sampling; tasks register themselves as they're
+  // created
+  telemetry_start();
+
+  // display has to be up before the game starts publishing frames. It comes
+  // first, so a game kept through deep sleep is back on the panel before the
+  // slow part of startup
+  render_task_start();
+  if (esp_reset_reason() == ESP_RST_DEEPSLEEP) {
+    resume_from = restore_snapshot();
+  }
+
   // Initialize NVS
   esp_err_t ret = nvs_flash_init();
   if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
@@ -184,19 +871,43 @@ void app_main(void) {
   }
   ESP_ERROR_CHECK(ret);
 
-  // ESP_ERROR_CHECK( heap_trace_init_standalone(trace_record, NUM_RECORDS) );
+  // games are recorded from here on, if there's a partition for them
+  replay_writer_init(&recording, replay_flash_write, NULL);
+  replay_flash_init();
+  // the first game starts straight away, so its sectors are erased now.
+  // Waking from deep sleep finds them already erased before sleeping
+  replay_flash_erase_ahead();
+
+#if CONFIG_NPIX_AUTO_LIGHT_SLEEP
+  // scale the CPU clock down when idle, and light sleep whenever every task is
+  // blocked, e.g. between game ticks and while paused
+  esp_pm_config_t pm_config = {
+      .max_freq_mhz       = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+      .min_freq_mhz       = CONFIG_XTAL_FREQ,
+      .light_sleep_enable = true,
+  };
+  ESP_ERROR_CHECK(esp_pm_configure(&pm_config));
+#endif
 
   example_wifi_init();
 
   // ESP_LOGI(TAG, "Starting remote: prior vals last_seq=%ld", last_msg_seq);
   espnow_remote_recv_init();
 
-  // Create mutex before starting tasks
-  mutex = xSemaphoreCreateMutex();
+#if CONFIG_NPIX_AUTO_LIGHT_SLEEP
+  // a radio that's always listening holds a PM lock that keeps the chip out of
+  // light sleep. With modem sleep, ESP-NOW only listens for the wake window
+  // out of every wake interval, and the chip can sleep the rest
+  ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
+  ESP_ERROR_CHECK(esp_now_set_wake_window(CONFIG_NPIX_ESPNOW_WAKE_WINDOW_MS));
+  ESP_ERROR_CHECK(esp_wifi_connectionless_module_set_wake_interval(
+      CONFIG_NPIX_ESPNOW_WAKE_INTERVAL_MS));
+#endif
 
   // start game loop task
   TaskHandle_t tetris_task_handle = NULL;
   xTaskCreate(tetris_game_loop_task, "tetris_game_loop_task",
               TASK_STACK_DEPTH_BYTES, NULL, 4, &tetris_task_handle);
+  telemetry_register_task(tetris_task_handle, TASK_STACK_DEPTH_BYTES);
   ESP_LOGI(TAG, "Tetris task created with handle %p", tetris_task_handle);
 }
@@ -0,0 +1,211 @@
+/**
+ * Render task - owns the neopixel display and draws whatever frame the game
+ * task last published. The game task never waits on LED output.
+ */
+
+#include "render_task.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/param.h>  // MIN(), MAX()
+
+#include "display_anim.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "latency_trace.h"
+#include "neopixel_display.h"
+#include "telemetry.h"
+
+static frame_mailbox mailbox;
+static TaskHandle_t render_task_handle = NULL;
+
+// hash of the last frame published, so identical frames can be skipped
+static uint64_t last_published_hash;
+static bool have_published;
+static uint32_t frames_skipped;
+// presses shown first by frames that were skipped, for the next frame
+// published to take over
+static frame_input_times skipped_input;
+// when the first frame reached the LEDs, -1 until it has
+static int64_t first_frame_us = -1;
+
+static void render_frame(tNeopixelContext neopixels,
+                         const display_frame *frame,
+                         const display_effect *effect);
+static void record_photon_latency(const display_frame *frame);
+
+/**
+ * FreeRTOS task that waits for published frames and draws them, no faster
+ * than the panel can refresh. While an animation is playing it draws every
+ * refresh period, new frame or not, without the game task being involved.
+ */
+static void render_task(void *pvParameter) {
+  (void)pvParameter;
+
+  tNeopixelContext neopixels = init_neopixel_display();
+  // configured frame rate, capped at what the panel can actually refresh at
+  uint32_t refresh_rate  = MIN(get_display_refresh_rate(neopixels),
+                               CONFIG_NPIX_RENDER_MAX_FPS);
+  TickType_t min_period  = MAX(1, pdMS_TO_TICKS(1000UL / refresh_rate));
+  TickType_t last_render = xTaskGetTickCount();
+  ESP_LOGI(TAG, "Render task running at up to %ldHz", refresh_rate);
+
+  // animations are timed in frames at the rate we really draw at, which the
+  // tick period may round down from refresh_rate
+  display_anim_init(configTICK_RATE_HZ / min_period);
+  display_anim anim;
+  display_anim_stop(&anim);
+  display_effect shown_effect = display_anim_step(&anim);
+  uint8_t anim_seq            = 0;
+  // the consumer owns the last frame it took until the next take, so it can
+  // be redrawn with each step of an animation
+  const display_frame *frame = NULL;
+
+  while (1) {
+    // woken by render_publish_frame(), or just the next refresh period when
+    // there's an animation to step
+    ulTaskNotifyTake(pdTRUE, display_anim_running(&anim) ? 0 : portMAX_DELAY);
+
+    // anything published while we were waiting out the refresh period is
+    // picked up here, and only the newest frame is drawn. After sitting idle,
+    // don't try to make up for the refresh periods that went by
+    TickType_t now = xTaskGetTickCount();
+    if (now - last_render > min_period) {
+      last_render = now - min_period;
+    }
+    vTaskDelayUntil(&last_render, min_period);
+
+    const display_frame *next = frame_mailbox_take(&mailbox);
+    if (next != NULL) {
+      frame = next;
+      if (frame->anim_seq != anim_seq) {
+        anim_seq = frame->anim_seq;
+        display_anim_start(&anim, frame->anim, frame->anim_rows);
+      } else if (display_anim_holding(&anim) && frame->anim != anim.id) {
+        display_anim_stop(&anim);
+      }
+    }
+    if (frame == NULL) {
+      continue;
+    }
+
+    display_effect effect = display_anim_step(&anim);
+    if (next != NULL || memcmp(&effect, &shown_effect, sizeof(effect)) != 0) {
+      render_frame(neopixels, frame, &effect);
+      shown_effect = effect;
+    }
+    if (next != NULL) {
+      record_photon_latency(frame);
+    }
+    if (first_frame_us < 0) {
+      // startup time as the player sees it, e.g. cold boot vs. waking up
+      first_frame_us = esp_timer_get_time();
+      ESP_LOGI(TAG, "First frame on the LEDs %lldms after startup",
+               first_frame_us / 1000);
+    }
+  }
+}
+
+static void render_frame(tNeopixelContext neopixels,
+                         const display_frame *frame,
+                         const display_effect *effect) {
+  set_display_brightness(frame->brightness);
+
+  display_scene scene = {
+      .board    = &frame->board,
+      .ghost    = DISPLAY_NO_PIECE,
+      .piece    = frame->piece,
+      .effect   = *effect,
+      .text     = frame->text,
+      .text_row = frame->text_row,
+      .text_col = frame->text_col,
+  };
+#if CONFIG_NPIX_GHOST_PIECE
+  scene.ghost = display_piece_ghost(&frame->board, &frame->piece);
+#endif
+  switch (frame->overlay) {
+    case DISPLAY_OVERLAY_PAUSE:
+      display_scene_pause_icon(&scene);
+      break;
+    case DISPLAY_OVERLAY_PLAY_AGAIN:
+      display_scene_play_again_icon(&scene);
+      break;
+    default:
+      break;
+  }
+  display_compose(neopixels, &scene);
+}
+
+/**
+ * Called once a newly published frame is on the LEDs, which it is as soon as
+ * display_compose() returns. Animation steps redrawing the same frame aren't
+ * counted again.
+ */
+static void record_photon_latency(const display_frame *frame) {
+  int64_t photon_us = esp_timer_get_time();
+  if (frame->input.rx_us != 0) {
+    latency_trace_record(LATENCY_TICK_TO_PHOTON, frame->input.tick_us,
+                         photon_us);
+    latency_trace_record(LATENCY_PRESS_TO_PHOTON, frame->input.rx_us,
+                         photon_us);
+  }
+  if (frame->input.restart_rx_us != 0) {
+    latency_trace_record(LATENCY_RESTART_TO_PHOTON, frame->input.restart_rx_us,
+                         photon_us);
+  }
+}
+
+/**
+ * Create the render task. Must be called before any frames are published.
+ */
+void render_task_start(void) {
+  frame_mailbox_init(&mailbox);
+  xTaskCreatePinnedToCore(render_task, "render_task", TASK_STACK_DEPTH_BYTES,
+                          NULL, RENDER_TASK_PRIORITY, &render_task_handle,
+                          RENDER_TASK_CORE);
+  telemetry_register_task(render_task_handle, TASK_STACK_DEPTH_BYTES);
+  ESP_LOGI(TAG, "Render task created with handle %p on core %d",
+           render_task_handle, RENDER_TASK_CORE);
+}
+
+/**
+ * @returns frame for the game task to fill in. Only call from one task.
+ */
+display_frame *render_begin_frame(void) {
+  return frame_mailbox_back(&mailbox);
+}
+
+/**
+ * Hand the frame from render_begin_frame() to the render task. Never blocks.
+ * If the frame would look exactly like the last one published, it's dropped
+ * here and the render task isn't even woken up; its presses are timed to the
+ * next frame that does get drawn instead.
+ */
+void render_publish_frame(void) {
+  display_frame *frame = frame_mailbox_back(&mailbox);
+  frame_input_times_carry(&frame->input, &skipped_input);
+  skipped_input = (frame_input_times){0};
+
+  uint64_t hash = display_frame_hash(frame);
+  if (have_published && hash == last_published_hash) {
+    frames_skipped++;
+    skipped_input = frame->input;
+    return;
+  }
+  last_published_hash = hash;
+  have_published      = true;
+
+  frame_mailbox_publish(&mailbox);
+  xTaskNotifyGive(render_task_handle);
+}
+
+render_stats render_get_stats(void) {
+  render_stats stats = {
+      .mailbox        = frame_mailbox_get_stats(&mailbox),
+      .skipped        = frames_skipped,
+      .first_frame_us = first_frame_us,
+  };
+  return stats;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+static inline bool rtc_gpio_is_valid_gpio(int gpio) { return gpio >= 0; }
+static inline esp_err_t rtc_gpio_pullup_en(int gpio) { return ESP_OK; }
+static inline esp_err_t rtc_gpio_pulldown_dis(int gpio) { return ESP_OK; }
@@ -0,0 +1,3 @@
+#pragma once
+// there's no RTC memory; nothing outlives the run anyway
+#define RTC_DATA_ATTR
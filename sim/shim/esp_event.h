@@ -0,0 +1,3 @@
+#pragma once
+// nothing the simulated firmware uses
+#include "esp_err.h"
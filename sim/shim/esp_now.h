@@ -0,0 +1,5 @@
+#pragma once
+// ESP-NOW is replaced by the input injector in sim_remote.c
+#include "esp_err.h"
+
+#define ESP_NOW_ETH_ALEN 6
@@ -0,0 +1,43 @@
+#pragma once
+/**
+ * Flash partitions, as one RAM backed "replay" partition behaving like NOR
+ * flash: erase sets whole sectors to 0xff, and writes can only clear bits.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define SIM_PARTITION_SECTOR_BYTES 4096
+#define SIM_PARTITION_DEFAULT_SIZE (256 * 1024)
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP  = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset,
+                             void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset,
+                              const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *part,
+                                    size_t offset, size_t size);
+
+bool sim_partition_load(const char *path);
+bool sim_partition_save(const char *path);
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// deterministic here, seeded by sim_rtos_set_epoch()
+uint32_t esp_random(void);
@@ -0,0 +1,9 @@
+#pragma once
+#include "esp_err.h"
+
+// deep sleep is the end of the simulation
+void esp_deep_sleep_start(void) __attribute__((noreturn));
+
+static inline esp_err_t esp_sleep_enable_ext0_wakeup(int gpio, int level) {
+  return ESP_OK;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_DEEPSLEEP = 8,
+} esp_reset_reason_t;
+
+// every run is a cold boot; deep sleep ends it
+static inline esp_reset_reason_t esp_reset_reason(void) {
+  return ESP_RST_POWERON;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// the firmware only uses semaphores in the RMT output, which isn't simulated
+#include "freertos/FreeRTOS.h"
@@ -0,0 +1,4 @@
+#pragma once
+// as in ESP-IDF, this brings in the task API too
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
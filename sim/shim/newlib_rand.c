@@ -0,0 +1,16 @@
+/**
+ * rand() and srand() the way newlib on the chip has them, so a game recorded
+ * on the device draws the same pieces when it's replayed here.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static uint64_t rand_next = 1;
+
+void srand(unsigned int seed) { rand_next = seed; }
+
+int rand(void) {
+  rand_next = rand_next * 6364136223846793005ull + 1;
+  return (int)((rand_next >> 32) & RAND_MAX);
+}
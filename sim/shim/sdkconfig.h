@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * Configuration the simulator builds the firmware with. These are the Kconfig
+ * defaults, apart from the options that only make sense on the chip.
+ */
+
+// components/neopixel_display
+#define CONFIG_NPIX_PANEL_ROWS             32
+#define CONFIG_NPIX_PANEL_COLS             8
+#define CONFIG_NPIX_TILES_X                1
+#define CONFIG_NPIX_TILES_Y                1
+#define CONFIG_NPIX_VIEWPORT_SCALE         0
+#define CONFIG_NPIX_CHANNELS               1
+#define CONFIG_NPIX_PANEL_ORIGIN_TOP_RIGHT 1
+#define CONFIG_NPIX_PANEL_ORIENTATION_ROWS 1
+#define CONFIG_NPIX_PANEL_SERPENTINE       1
+#define CONFIG_NPIX_OUTPUT_NEOPIXEL        1
+#define CONFIG_NPIX_RENDER_MAX_FPS         60
+#define CONFIG_NPIX_GHOST_PIECE            1
+
+// components/remote_input
+#define CONFIG_REMOTE_INPUT_DAS_MS             170
+#define CONFIG_REMOTE_INPUT_ARR_MS             50
+#define CONFIG_REMOTE_INPUT_REPORT_INTERVAL_MS 50
+
+// components/game_clock
+#define CONFIG_GAME_CLOCK_TICK_US           15000
+#define CONFIG_GAME_CLOCK_MAX_CATCHUP_TICKS 4
+
+// components/latency_trace
+#define CONFIG_LATENCY_TRACE 1
+
+// components/telemetry
+#define CONFIG_TELEMETRY_INTERVAL_MS        1000
+#define CONFIG_TELEMETRY_HISTORY            16
+#define CONFIG_TELEMETRY_STACK_MARGIN_BYTES 512
+
+// components/autoplay
+#define CONFIG_AUTOPLAY_ATTRACT_DELAY_S 30
+#define CONFIG_AUTOPLAY_LOOKAHEAD       1
+
+// components/replay
+#define CONFIG_REPLAY_PARTITION_LABEL     "replay"
+#define CONFIG_REPLAY_ERASE_AHEAD_SECTORS 2
+
+// main; there's no power management to configure
+#define CONFIG_NPIX_AUTO_LIGHT_SLEEP 0
+#define CONFIG_NPIX_WAKE_GPIO        0
+
+// chip. Everything runs on one simulated core
+#define CONFIG_FREERTOS_HZ               100
+#define CONFIG_FREERTOS_UNICORE          1
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ  160
+#define CONFIG_XTAL_FREQ                 40
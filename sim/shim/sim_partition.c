@@ -0,0 +1,124 @@
+/**
+ * The replay partition, in RAM. It can be loaded from and saved to an image
+ * file, in the same layout `parttool.py read_partition` reads off the chip.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_partition.h"
+
+static esp_partition_t replay_partition = {
+    .type  = ESP_PARTITION_TYPE_DATA,
+    .label = "replay",
+};
+static uint8_t *flash;
+
+static bool in_range(const esp_partition_t *part, size_t offset,
+                     size_t size) {
+  return part == &replay_partition && offset <= part->size &&
+         size <= part->size - offset;
+}
+
+// erased, at the default size, the first time anything touches it
+static void ensure_flash(void) {
+  if (flash == NULL) {
+    replay_partition.size = SIM_PARTITION_DEFAULT_SIZE;
+    flash                 = malloc(replay_partition.size);
+    if (flash == NULL) {
+      abort();
+    }
+    memset(flash, 0xff, replay_partition.size);
+  }
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+  (void)subtype;
+  if (type != ESP_PARTITION_TYPE_DATA || label == NULL ||
+      strcmp(label, replay_partition.label) != 0) {
+    return NULL;
+  }
+  ensure_flash();
+  return &replay_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset,
+                             void *dst, size_t size) {
+  if (!in_range(part, offset, size)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memcpy(dst, flash + offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset,
+                              const void *src, size_t size) {
+  if (!in_range(part, offset, size)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const uint8_t *bytes = src;
+  for (size_t i = 0; i < size; i++) {
+    flash[offset + i] &= bytes[i];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part,
+                                    size_t offset, size_t size) {
+  if (!in_range(part, offset, size) ||
+      offset % SIM_PARTITION_SECTOR_BYTES != 0 ||
+      size % SIM_PARTITION_SECTOR_BYTES != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(flash + offset, 0xff, size);
+  return ESP_OK;
+}
+
+/**
+ * Use the image in `path` as the partition; its size is the partition's
+ * @returns false if it can't be read. A missing file isn't an error, the
+ * partition just starts out erased
+ */
+bool sim_partition_load(const char *path) {
+  FILE *in = fopen(path, "rb");
+  if (in == NULL) {
+    ensure_flash();
+    return true;
+  }
+  fseek(in, 0, SEEK_END);
+  long size = ftell(in);
+  rewind(in);
+  if (size <= 0 || size % SIM_PARTITION_SECTOR_BYTES != 0) {
+    fprintf(stderr, "%s: not a whole number of flash sectors\n", path);
+    fclose(in);
+    return false;
+  }
+
+  free(flash);
+  replay_partition.size = size;
+  flash                 = malloc(size);
+  bool ok = flash != NULL && fread(flash, 1, size, in) == (size_t)size;
+  fclose(in);
+  if (!ok) {
+    perror(path);
+  }
+  return ok;
+}
+
+bool sim_partition_save(const char *path) {
+  ensure_flash();
+  FILE *out = fopen(path, "wb");
+  bool ok   = out != NULL &&
+            fwrite(flash, 1, replay_partition.size, out) ==
+                replay_partition.size;
+  if (out != NULL && fclose(out) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    perror(path);
+  }
+  return ok;
+}
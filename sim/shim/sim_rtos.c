@@ -0,0 +1,382 @@
+/**
+ * Cooperative FreeRTOS and esp_timer on a virtual clock, see sim_rtos.h.
+ * Each task gets its own ucontext stack and switches back to the scheduler
+ * whenever it blocks.
+ */
+
+#include "sim_rtos.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SIM_MAX_TASKS  8
+#define SIM_MAX_TIMERS 8
+// host code needs far more stack than the firmware asks for, especially with
+//  sanitizers, so the requested depth is only reported back
+#define SIM_STACK_BYTES (512 * 1024)
+#define TICK_US         (1000000 / configTICK_RATE_HZ)
+
+struct sim_task {
+  ucontext_t context;
+  void *stack;
+  TaskFunction_t fn;
+  void *arg;
+  const char *name;
+  uint32_t stack_depth;
+  uint32_t notify_value;
+  bool waiting_for_notify;
+  int64_t wake_us;  // runnable once the clock reaches this
+};
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  bool armed;
+  int64_t period_us;  // 0 for one shot
+  int64_t alarm_us;
+};
+
+esp_log_level_t sim_log_level = ESP_LOG_WARN;
+
+static struct sim_task tasks[SIM_MAX_TASKS];
+static int num_tasks;
+static struct sim_task *current;  // NULL while the scheduler is running
+static int last_run = -1;
+static ucontext_t scheduler_context;
+
+static struct esp_timer timers[SIM_MAX_TIMERS];
+static int num_timers;
+
+static int64_t now_us;
+static time_t epoch;
+static uint32_t random_state = 1;
+static bool stopped;
+
+// hand control back to the scheduler until the clock reaches `wake_us`
+static void block_until(int64_t wake_us) {
+  struct sim_task *task = current;
+  assert(task != NULL && "blocking call outside a task");
+  task->wake_us = wake_us;
+  swapcontext(&task->context, &scheduler_context);
+}
+
+static void task_entry(void) {
+  current->fn(current->arg);
+  assert(0 && "task functions should not exit");
+}
+
+/**
+ * @returns next task due to run at the current time, going round the tasks
+ * so one that keeps yielding can't starve the others
+ */
+static struct sim_task *next_ready_task(void) {
+  for (int i = 1; i <= num_tasks; i++) {
+    int index = (last_run + i) % num_tasks;
+    if (tasks[index].wake_us <= now_us) {
+      last_run = index;
+      return &tasks[index];
+    }
+  }
+  return NULL;
+}
+
+static void fire_due_timers(void) {
+  for (int i = 0; i < num_timers; i++) {
+    struct esp_timer *timer = &timers[i];
+    if (!timer->armed || timer->alarm_us > now_us) {
+      continue;
+    }
+    if (timer->period_us > 0) {
+      timer->alarm_us += timer->period_us;
+    } else {
+      timer->armed = false;
+    }
+    timer->callback(timer->arg);
+  }
+}
+
+// @returns when the next timer goes off or task wakes up, SIM_NEVER if never
+static int64_t next_event_us(void) {
+  int64_t next = SIM_NEVER;
+  for (int i = 0; i < num_timers; i++) {
+    if (timers[i].armed && timers[i].alarm_us < next) {
+      next = timers[i].alarm_us;
+    }
+  }
+  for (int i = 0; i < num_tasks; i++) {
+    if (tasks[i].wake_us < next) {
+      next = tasks[i].wake_us;
+    }
+  }
+  return next;
+}
+
+/**
+ * Run the created tasks and timers until sim_rtos_stop() is called, nothing
+ * is left that could ever run, or the clock would pass `end_us`
+ * @returns false if it stopped because every task is blocked for good
+ */
+bool sim_rtos_run(int64_t end_us) {
+  while (!stopped) {
+    fire_due_timers();
+    struct sim_task *task = next_ready_task();
+    if (task != NULL) {
+      current = task;
+      swapcontext(&scheduler_context, &task->context);
+      current = NULL;
+      continue;
+    }
+
+    int64_t next = next_event_us();
+    if (next == SIM_NEVER) {
+      return false;
+    }
+    if (next > end_us) {
+      break;
+    }
+    now_us = next;
+  }
+  return true;
+}
+
+/**
+ * End sim_rtos_run() once whatever is running now blocks
+ */
+void sim_rtos_stop(void) { stopped = true; }
+
+bool sim_rtos_stopped(void) { return stopped; }
+
+/**
+ * @returns the timer created with `name`, NULL if there isn't one
+ */
+esp_timer_handle_t sim_rtos_find_timer(const char *name) {
+  for (int i = 0; i < num_timers; i++) {
+    if (timers[i].name != NULL && strcmp(timers[i].name, name) == 0) {
+      return &timers[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Set what time() returns at the start of the run, so anything seeded from
+ * the wall clock is seeded the same way every run. esp_random() is seeded
+ * from it too.
+ */
+void sim_rtos_set_epoch(time_t start) {
+  epoch        = start;
+  random_state = (uint32_t)start * 0x9e3779b9u | 1;
+}
+
+// xorshift32, repeatable run to run unlike the chip's hardware RNG
+uint32_t esp_random(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+time_t time(time_t *out) {
+  time_t t = epoch + now_us / 1000000;
+  if (out != NULL) {
+    *out = t;
+  }
+  return t;
+}
+
+// FreeRTOS tasks
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  (void)priority;
+  (void)core;
+  if (num_tasks == SIM_MAX_TASKS) {
+    return pdFAIL;
+  }
+  struct sim_task *task = &tasks[num_tasks];
+  task->fn              = fn;
+  task->arg             = arg;
+  task->name            = name;
+  task->stack_depth     = stack_depth;
+  task->stack           = malloc(SIM_STACK_BYTES);
+  task->wake_us         = now_us;
+  if (task->stack == NULL) {
+    return pdFAIL;
+  }
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp   = task->stack;
+  task->context.uc_stack.ss_size = SIM_STACK_BYTES;
+  task->context.uc_link          = NULL;
+  makecontext(&task->context, task_entry, 0);
+  num_tasks++;
+  if (handle != NULL) {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name,
+                       uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, handle,
+                                 tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return current; }
+
+const char *pcTaskGetName(TaskHandle_t task) {
+  return (task != NULL ? task : current)->name;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  task->notify_value++;
+  if (task->waiting_for_notify) {
+    task->wake_us = now_us;
+  }
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout) {
+  struct sim_task *task = current;
+  if (task->notify_value == 0) {
+    // a zero timeout still yields, so a task polling for work lets the others
+    //  run
+    task->waiting_for_notify = true;
+    block_until(timeout == portMAX_DELAY
+                    ? SIM_NEVER
+                    : now_us + (int64_t)timeout * TICK_US);
+    task->waiting_for_notify = false;
+  }
+
+  uint32_t value = task->notify_value;
+  if (value > 0) {
+    task->notify_value = clear_on_exit ? 0 : value - 1;
+  }
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  block_until(now_us + (int64_t)ticks * TICK_US);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+  *previous_wake += increment;
+  int64_t wake_us = (int64_t)*previous_wake * TICK_US;
+  block_until(wake_us > now_us ? wake_us : now_us);
+}
+
+TickType_t xTaskGetTickCount(void) { return now_us / TICK_US; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return (task != NULL ? task : current)->stack_depth;
+}
+
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+// esp_timer
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out_handle) {
+  if (num_timers == SIM_MAX_TIMERS) {
+    return ESP_ERR_NO_MEM;
+  }
+  struct esp_timer *timer = &timers[num_timers++];
+  timer->callback         = args->callback;
+  timer->arg              = args->arg;
+  timer->name             = args->name;
+  timer->armed            = false;
+  *out_handle             = timer;
+  return ESP_OK;
+}
+
+static esp_err_t start_timer(esp_timer_handle_t timer, uint64_t first_us,
+                             uint64_t period_us) {
+  if (timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed     = true;
+  timer->alarm_us  = now_us + first_us;
+  timer->period_us = period_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return start_timer(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period_us) {
+  return start_timer(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  return ESP_OK;
+}
+
+// timers live as long as the simulation does; a deleted one just never fires
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  timer->armed = false;
+  timer->name  = NULL;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer->armed; }
+
+int64_t esp_timer_get_time(void) { return now_us; }
+
+// the rest of the chip
+
+void sim_log(esp_log_level_t level, const char *tag, const char *format, ...) {
+  static const char letters[] = "NEWIDV";
+  if (level > sim_log_level) {
+    return;
+  }
+  printf("%c (%lld) %s: ", letters[level], (long long)(now_us / 1000), tag);
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  putchar('\n');
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  (void)caps;
+  return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  (void)caps;
+  return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  (void)caps;
+  return 0;
+}
+
+// the firmware powers off here, so the simulation is over
+void esp_deep_sleep_start(void) {
+  stopped = true;
+  block_until(SIM_NEVER);
+  abort();
+}
@@ -0,0 +1,26 @@
+#ifndef SIM_RTOS_H
+#define SIM_RTOS_H
+
+/**
+ * Scheduler the simulated firmware runs on. Tasks are cooperative and time is
+ * virtual: a task runs until it blocks, and when every task is blocked the
+ * clock jumps straight to the next timer or wakeup. Code takes no virtual time
+ * to run, so a run only depends on its inputs and seed, never on how fast the
+ * host is.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_timer.h"
+
+#define SIM_NEVER INT64_MAX
+
+bool sim_rtos_run(int64_t end_us);
+void sim_rtos_stop(void);
+bool sim_rtos_stopped(void);
+esp_timer_handle_t sim_rtos_find_timer(const char *name);
+void sim_rtos_set_epoch(time_t epoch);
+
+#endif
@@ -0,0 +1,233 @@
+/**
+ * Headless simulator: the whole firmware, main.c and render task included,
+ * running on Linux against sim_rtos.c, with the remote replaced by
+ * sim_remote.c and the LEDs by the neopixel frame capture stub.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "neopixel_display.h"
+#include "neopixel_stub.h"
+#include "render_task.h"
+#include "replay.h"
+#include "replay_flash.h"
+#include "sim_remote.h"
+#include "sim_rtos.h"
+
+#define DEFAULT_SEED  1
+#define DEFAULT_GAMES 100
+
+void app_main(void);
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  -s, --seed N      seed for the game and the random player "
+          "(default %d)\n"
+          "  -g, --games N     random player plays N games (default %d)\n"
+          "  -i, --script FILE inject presses from FILE, - for stdin\n"
+          "  -t, --time S      stop after S simulated seconds\n"
+          "  -d, --dump        print the panel when the run ends\n"
+          "  -f, --flash FILE  replay partition image, loaded if it exists "
+          "and saved\n"
+          "                    at the end\n"
+          "  -r, --replay      play back the last game recorded in --flash "
+          "instead\n"
+          "  -v, --verbose     firmware logging; repeat for debug\n",
+          prog, DEFAULT_SEED, DEFAULT_GAMES);
+}
+
+/**
+ * Play the last recorded game back through the library, without the rest of
+ * the firmware, and check it ends the way it did when it was recorded
+ * @returns exit status
+ */
+static int play_back(FILE *report, bool dump) {
+  // holds a whole flash sector
+  static replay_reader reader;
+  if (!replay_flash_init() || !replay_flash_open_last(&reader)) {
+    fprintf(stderr, "sim: no recorded game to replay\n");
+    return 1;
+  }
+
+  TetrisGame *tg = create_game();
+  replay_start_game(&reader, tg);
+  uint32_t ticks = 0, moves = 0;
+  enum player_move move;
+  while (replay_next(&reader, &move)) {
+    tg_tick(tg, move);
+    ticks++;
+    moves += move != T_NONE;
+  }
+  fprintf(report, "replay: seed=%08x ticks=%u moves=%u score=%ld level=%ld\n",
+          reader.seed, ticks, moves, tg->score, tg->level);
+  if (dump) {
+    for (int row = 0; row < TETRIS_ROWS; row++) {
+      for (int col = 0; col < TETRIS_COLS; col++) {
+        int8_t cell = tg->active_board.board[row][col];
+        fputc(cell == BG_COLOR ? '.' : '0' + cell, report);
+      }
+      fputc('\n', report);
+    }
+  }
+
+  int status = 0;
+  if (!reader.complete) {
+    fprintf(report, "replay: recording was cut short\n");
+  } else if (reader.score != (uint32_t)tg->score) {
+    fprintf(report, "replay: diverged, recorded score was %u\n",
+            reader.score);
+    status = 1;
+  }
+  end_game(tg);
+  return status;
+}
+
+static double wall_seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+      {"seed", required_argument, NULL, 's'},
+      {"games", required_argument, NULL, 'g'},
+      {"script", required_argument, NULL, 'i'},
+      {"time", required_argument, NULL, 't'},
+      {"dump", no_argument, NULL, 'd'},
+      {"flash", required_argument, NULL, 'f'},
+      {"replay", no_argument, NULL, 'r'},
+      {"verbose", no_argument, NULL, 'v'},
+      {NULL, 0, NULL, 0},
+  };
+  uint32_t seed      = DEFAULT_SEED;
+  uint32_t games     = DEFAULT_GAMES;
+  const char *script = NULL;
+  int64_t end_us     = SIM_NEVER;
+  bool dump          = false;
+  const char *flash  = NULL;
+  bool replay        = false;
+  bool verbose       = false;
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:g:i:t:df:rv", options, NULL)) !=
+         -1) {
+    switch (opt) {
+      case 's':
+        seed = strtoul(optarg, NULL, 0);
+        break;
+      case 'g':
+        games = strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        script = optarg;
+        break;
+      case 't':
+        end_us = (int64_t)(strtod(optarg, NULL) * 1e6);
+        break;
+      case 'd':
+        dump = true;
+        break;
+      case 'f':
+        flash = optarg;
+        break;
+      case 'r':
+        replay = true;
+        break;
+      case 'v':
+        verbose       = true;
+        sim_log_level = sim_log_level < ESP_LOG_INFO ? ESP_LOG_INFO
+                                                     : ESP_LOG_DEBUG;
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind < argc || games == 0 || (replay && flash == NULL)) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (flash != NULL && !sim_partition_load(flash)) {
+    return 2;
+  }
+
+  if (script != NULL) {
+    bool from_stdin = script[0] == '-' && script[1] == '\0';
+    FILE *in        = from_stdin ? stdin : fopen(script, "r");
+    if (in == NULL) {
+      perror(script);
+      return 2;
+    }
+    bool loaded = sim_remote_load_script(in, from_stdin ? "stdin" : script);
+    if (!from_stdin) {
+      fclose(in);
+    }
+    if (!loaded) {
+      return 2;
+    }
+  } else {
+    sim_remote_play_random(seed, games);
+  }
+
+  // the firmware prints boards and stats straight to stdout at every game
+  //  over; only keep that with -v, and report on a stream of our own
+  FILE *report = fdopen(dup(STDOUT_FILENO), "w");
+  if (report == NULL ||
+      (!verbose && freopen("/dev/null", "w", stdout) == NULL)) {
+    perror("stdout");
+    return 2;
+  }
+
+  // the firmware seeds every game from esp_random(), which is seeded here
+  srand(seed);
+  sim_rtos_set_epoch(seed);
+  if (replay) {
+    int status = play_back(report, dump);
+    fclose(report);
+    return status;
+  }
+
+  double start_s = wall_seconds();
+  app_main();
+  bool ran      = sim_rtos_run(end_us);
+  double wall_s = wall_seconds() - start_s;
+  fflush(stdout);
+
+  double sim_s            = esp_timer_get_time() / 1e6;
+  sim_remote_stats remote = sim_remote_get_stats();
+  display_stats display   = get_display_stats();
+  render_stats render     = render_get_stats();
+  fprintf(report, "sim: seed=%u games=%u presses=%u\n", seed,
+          remote.games_finished, remote.presses);
+  fprintf(report,
+          "sim: %.1fs simulated in %.3fs (%.0fx real time, %.0f games/min)\n",
+          sim_s, wall_s, wall_s > 0 ? sim_s / wall_s : 0,
+          wall_s > 0 ? remote.games_finished * 60 / wall_s : 0);
+  fprintf(report, "sim: frames published=%u rendered=%u pixels_pushed=%llu\n",
+          (unsigned)render.mailbox.published,
+          (unsigned)render.mailbox.rendered,
+          (unsigned long long)display.pixels_pushed_total);
+  if (dump) {
+    neopixel_stub_dump(report, DISPLAY_ROWS, DISPLAY_COLS, display_led_index,
+                       isatty(STDOUT_FILENO));
+  }
+  fclose(report);
+
+  if (flash != NULL && !sim_partition_save(flash)) {
+    return 2;
+  }
+  if (!ran) {
+    fprintf(stderr, "sim: every task is blocked for good\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+/**
+ * Input injector, implementing the espnow_remote.h API on top of an input
+ * event ring. A one shot esp_timer stands in for the radio: each time it
+ * fires, one press goes into the ring and the game task is notified, exactly
+ * like the receive task does with a parsed packet.
+ *
+ * Scripts are one press per line, "<delay_ms> <button>", where the delay is
+ * from the previous press and the button is a name (on, off, night,
+ * bright_up, bright_down, one/left, two/rotate, three/down, four/right) or a
+ * Wizmote button number. Blank lines and lines starting with '#' are
+ * skipped.
+ */
+
+#include "sim_remote.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "espnow_remote.h"
+#include "freertos/task.h"
+#include "sim_rtos.h"
+
+// random player's time between presses
+#define RANDOM_MIN_GAP_MS 40
+#define RANDOM_MAX_GAP_MS 300
+
+typedef struct sim_press {
+  uint32_t delay_ms;
+  uint8_t button;
+} sim_press;
+
+static const struct {
+  const char *name;
+  uint8_t button;
+} button_names[] = {
+    {"on", WIZMOTE_BUTTON_ON},
+    {"off", WIZMOTE_BUTTON_OFF},
+    {"night", WIZMOTE_BUTTON_NIGHT},
+    {"pause", WIZMOTE_BUTTON_NIGHT},
+    {"bright_down", WIZMOTE_BUTTON_BRIGHT_DOWN},
+    {"bright_up", WIZMOTE_BUTTON_BRIGHT_UP},
+    {"one", WIZMOTE_BUTTON_ONE},
+    {"left", WIZMOTE_BUTTON_ONE},
+    {"two", WIZMOTE_BUTTON_TWO},
+    {"rotate", WIZMOTE_BUTTON_TWO},
+    {"three", WIZMOTE_BUTTON_THREE},
+    {"down", WIZMOTE_BUTTON_THREE},
+    {"four", WIZMOTE_BUTTON_FOUR},
+    {"right", WIZMOTE_BUTTON_FOUR},
+};
+
+static const uint8_t random_moves[] = {WIZMOTE_BUTTON_ONE, WIZMOTE_BUTTON_TWO,
+                                       WIZMOTE_BUTTON_THREE,
+                                       WIZMOTE_BUTTON_FOUR};
+
+static input_event_ring s_input_ring;
+static TaskHandle_t s_input_consumer_task;
+static esp_timer_handle_t inject_timer;
+static sim_remote_stats stats;
+static uint32_t seq;
+
+static sim_press *script;
+static size_t script_len;
+static size_t script_next;
+
+static bool random_player;
+static uint32_t random_state;
+static uint32_t random_games;
+
+// xorshift32, so the player doesn't share rand() with the game
+static uint32_t random_next(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+/**
+ * @returns the button `name` stands for, 0 if it isn't one
+ */
+static uint8_t parse_button(const char *name) {
+  for (size_t i = 0; i < sizeof(button_names) / sizeof(button_names[0]); i++) {
+    if (strcasecmp(name, button_names[i].name) == 0) {
+      return button_names[i].button;
+    }
+  }
+  char *end;
+  long button = strtol(name, &end, 10);
+  return *end == '\0' && button > 0 && button < 256 ? button : 0;
+}
+
+/**
+ * Read a script of presses to inject, replacing the random player
+ * @param name - for error messages
+ * @returns false, after saying why, if the script has a bad line
+ */
+bool sim_remote_load_script(FILE *in, const char *name) {
+  char line[SHORT_STR_LEN];
+  size_t capacity = 0;
+  for (int line_num = 1; fgets(line, sizeof(line), in) != NULL; line_num++) {
+    char *start = line;
+    while (isspace((unsigned char)*start)) {
+      start++;
+    }
+    if (*start == '\0' || *start == '#') {
+      continue;
+    }
+
+    unsigned long delay_ms;
+    char button_name[SHORT_STR_LEN];
+    uint8_t button = 0;
+    if (sscanf(start, "%lu %63s", &delay_ms, button_name) == 2) {
+      button = parse_button(button_name);
+    }
+    if (button == 0) {
+      fprintf(stderr, "%s:%d: expected \"<delay_ms> <button>\"\n", name,
+              line_num);
+      return false;
+    }
+
+    if (script_len == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      script   = realloc(script, capacity * sizeof(script[0]));
+      if (script == NULL) {
+        return false;
+      }
+    }
+    script[script_len++] = (sim_press){delay_ms, button};
+  }
+  random_player = false;
+  return true;
+}
+
+/**
+ * Have a random player mash the direction buttons, start the next game
+ * whenever one ends, and switch off after `games` games
+ */
+void sim_remote_play_random(uint32_t seed, uint32_t games) {
+  random_player = true;
+  random_state  = seed ? seed : 1;
+  random_games  = games;
+}
+
+sim_remote_stats sim_remote_get_stats(void) { return stats; }
+
+static void schedule_press(uint32_t delay_ms) {
+  esp_timer_start_once(inject_timer, (uint64_t)delay_ms * 1000);
+}
+
+static void schedule_next_press(void) {
+  if (random_player) {
+    uint32_t span = RANDOM_MAX_GAP_MS - RANDOM_MIN_GAP_MS + 1;
+    schedule_press(RANDOM_MIN_GAP_MS + random_next() % span);
+  } else if (script_next < script_len) {
+    schedule_press(script[script_next].delay_ms);
+  } else {
+    // let whatever the last press started play out, then end the run
+    schedule_press(SIM_SCRIPT_TAIL_MS);
+  }
+}
+
+/**
+ * @returns what the random player presses next. The game tick timer only
+ * stops when a game ends, since the random player never pauses
+ */
+static uint8_t random_button(void) {
+  esp_timer_handle_t tick_timer = sim_rtos_find_timer("game_tick");
+  if (tick_timer != NULL && !esp_timer_is_active(tick_timer)) {
+    stats.games_finished++;
+    return stats.games_finished < random_games ? WIZMOTE_BUTTON_ON
+                                               : WIZMOTE_BUTTON_OFF;
+  }
+  return random_moves[random_next() % sizeof(random_moves)];
+}
+
+// the radio: deliver the next press, as the receive task would
+static void inject_press(void *arg) {
+  (void)arg;
+  uint8_t button;
+  if (random_player) {
+    button = random_button();
+  } else if (script_next < script_len) {
+    button = script[script_next++].button;
+  } else {
+    sim_rtos_stop();
+    return;
+  }
+
+  int64_t now_us    = esp_timer_get_time();
+  input_event event = {
+      .program    = button == WIZMOTE_BUTTON_ON ? 0x91 : 0x81,
+      .button     = button,
+      .seq        = ++seq,
+      .rx_time_us = now_us,
+      .time_us    = now_us,
+  };
+  stats.presses++;
+  if (input_event_ring_push(&s_input_ring, &event) &&
+      s_input_consumer_task != NULL) {
+    xTaskNotifyGive(s_input_consumer_task);
+  }
+
+  // nothing more to press once the player has switched the game off
+  if (!(random_player && button == WIZMOTE_BUTTON_OFF)) {
+    schedule_next_press();
+  }
+}
+
+// espnow_remote.h
+
+void example_wifi_init(void) {}
+
+esp_err_t espnow_remote_recv_init(void) {
+  input_event_ring_init(&s_input_ring);
+  const esp_timer_create_args_t timer_args = {
+      .callback = inject_press,
+      .name     = "sim_input",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &inject_timer));
+  if (random_player || script_len > 0) {
+    schedule_next_press();
+  }
+  return ESP_OK;
+}
+
+void espnow_remote_recv_deinit(void) { esp_timer_stop(inject_timer); }
+
+bool wait_for_input_events(TickType_t timeout) {
+  if (s_input_consumer_task == NULL) {
+    s_input_consumer_task = xTaskGetCurrentTaskHandle();
+  }
+  if (s_input_ring.head != s_input_ring.tail) {
+    return true;
+  }
+  ulTaskNotifyTake(pdTRUE, timeout);
+  return s_input_ring.head != s_input_ring.tail;
+}
+
+bool next_input_event(input_event *event) {
+  return input_event_ring_pop(&s_input_ring, event);
+}
+
+remote_recv_stats get_remote_recv_stats(void) {
+  remote_recv_stats recv_stats       = {.packets_received = stats.presses};
+  recv_stats.button_events_dropped   = s_input_ring.dropped;
+  recv_stats.button_events_max_depth = s_input_ring.max_depth;
+  return recv_stats;
+}
+
+void set_stat_led_state(bool ledState) {
+  ESP_LOGD(TAG, "Status LED %s", ledState ? "on" : "off");
+}
+
+void get_button_name_from_number(const uint8_t button, char *button_name_str) {
+  for (size_t i = 0; i < sizeof(button_names) / sizeof(button_names[0]); i++) {
+    if (button_names[i].button == button) {
+      strcpy(button_name_str, button_names[i].name);
+      return;
+    }
+  }
+  strcpy(button_name_str, "?");
+}
@@ -0,0 +1,26 @@
+#ifndef SIM_REMOTE_H
+#define SIM_REMOTE_H
+
+/**
+ * Stand-in for the ESP-NOW remote. Presses are injected into the same input
+ * event ring the receive task feeds on the chip, either from a script or by a
+ * random player.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// virtual time a script keeps running for after its last press
+#define SIM_SCRIPT_TAIL_MS 10000
+
+typedef struct sim_remote_stats {
+  uint32_t presses;         // presses injected
+  uint32_t games_finished;  // games the random player saw to game over
+} sim_remote_stats;
+
+bool sim_remote_load_script(FILE *in, const char *name);
+void sim_remote_play_random(uint32_t seed, uint32_t games);
+sim_remote_stats sim_remote_get_stats(void);
+
+#endif
@@ -0,0 +1,4 @@
+#pragma once
+// the autoplay component's Kconfig defaults; nothing else here reads config
+#define CONFIG_AUTOPLAY_ATTRACT_DELAY_S 30
+#define CONFIG_AUTOPLAY_LOOKAHEAD       1
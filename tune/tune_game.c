@@ -0,0 +1,52 @@
+/**
+ * One self-play game, straight through tg_tick() with no display or clock:
+ * one call per tick with the bot's move, or T_NONE for gravity, just as in
+ * the firmware's demo game.
+ *
+ * Games run on several threads at once, and the library draws its pieces
+ * from rand(). rand() and srand() are defined here, so they take the place
+ * of libc's for tetris.c too: each thread gets its own generator, seeded per
+ * game, and the library can't reseed it from the clock. A game's pieces then
+ * only depend on its seed, whichever thread plays it.
+ */
+
+#include "tune_game.h"
+
+#include <stdlib.h>
+
+#include "tetris.h"
+
+static _Thread_local uint32_t rand_state = 1;
+
+int rand(void) {
+  // xorshift32, kept to RAND_MAX like libc's
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state & RAND_MAX;
+}
+
+// seeding is up to tune_play_game()
+void srand(unsigned int seed) { (void)seed; }
+
+/**
+ * Play a game until it's over or `max_pieces` pieces have been placed
+ * @param lookahead - see autoplay_init()
+ */
+tune_game_result tune_play_game(const autoplay_weights *weights, uint32_t seed,
+                                uint8_t lookahead, uint32_t max_pieces) {
+  // spread out nearby seeds; xorshift needs a non-zero state
+  rand_state     = (seed + 1) * 0x9e3779b9u | 1;
+  TetrisGame *tg = create_game();
+  autoplay_bot bot;
+  autoplay_init(&bot, weights, lookahead);
+  create_rand_piece(tg);
+
+  while (!tg->game_over && bot.pieces <= max_pieces) {
+    tg_tick(tg, autoplay_next_move(&bot, tg));
+  }
+
+  tune_game_result result = {.score = tg->score, .pieces = bot.pieces};
+  end_game(tg);
+  return result;
+}
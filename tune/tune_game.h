@@ -0,0 +1,16 @@
+#ifndef TUNE_GAME_H
+#define TUNE_GAME_H
+
+#include <stdint.h>
+
+#include "autoplay.h"
+
+typedef struct tune_game_result {
+  long score;
+  uint32_t pieces;
+} tune_game_result;
+
+tune_game_result tune_play_game(const autoplay_weights *weights, uint32_t seed,
+                                uint8_t lookahead, uint32_t max_pieces);
+
+#endif
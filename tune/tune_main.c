@@ -0,0 +1,424 @@
+/**
+ * Tunes the demo player's weights by self-play, with the cross-entropy
+ * method: each generation samples candidate weight vectors from a normal
+ * distribution, plays every candidate through the same set of seeded games,
+ * and refits the distribution to the best few. Weights only matter relative
+ * to each other, so every candidate is scaled to the same length.
+ *
+ * Games are spread over every core with the work stealing pool. Progress and
+ * throughput go to stderr; the tuned weights are written out as
+ * autoplay_weights.h.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "autoplay.h"
+#include "autoplay_weights.h"
+#include "tune_game.h"
+#include "tune_pool.h"
+
+#define NUM_WEIGHTS 4
+// length every weight vector is scaled to; big enough that rounding to
+//  integers doesn't matter, small enough that scores can't overflow
+#define WEIGHTS_NORM 1000.0
+
+#define DEFAULT_GENERATIONS 20
+#define DEFAULT_CANDIDATES  64
+#define DEFAULT_GAMES       8
+#define DEFAULT_MAX_PIECES  500
+#define ELITE_FRACTION      0.125
+// extra spread added back each generation so the search doesn't collapse
+//  early, tapering off to none by the last generation
+#define SIGMA_NOISE    (0.05 * WEIGHTS_NORM)
+#define SIGMA_START    (0.25 * WEIGHTS_NORM)
+#define HOLDOUT_FACTOR 4  // final check plays this many times more games
+
+typedef struct tune_options {
+  uint32_t seed;
+  int threads;
+  uint32_t generations;
+  uint32_t candidates;
+  uint32_t games;
+  uint32_t max_pieces;
+  uint8_t lookahead;
+  const char *out;
+  bool scaling;
+} tune_options;
+
+// one batch of games: `num_weights` candidates, each playing `games` games
+typedef struct tune_batch {
+  const autoplay_weights *weights;
+  uint32_t games;
+  uint32_t seed_base;
+  uint8_t lookahead;
+  uint32_t max_pieces;
+  tune_game_result *results;  // [candidate * games + game]
+} tune_batch;
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  -s, --seed N         seed for the search and the games\n"
+          "  -j, --threads N      worker threads (default: every core)\n"
+          "  -g, --generations N  (default %d)\n"
+          "  -c, --candidates N   weight vectors per generation (default %d)\n"
+          "  -n, --games N        games per candidate (default %d)\n"
+          "  -p, --max-pieces N   end games after N pieces (default %d)\n"
+          "  -l, --lookahead      bot looks at every possible next piece\n"
+          "  -o, --out FILE       write the weights header to FILE\n"
+          "      --scaling        measure throughput at 1, 2, 4, ... threads "
+          "and exit\n",
+          prog, DEFAULT_GENERATIONS, DEFAULT_CANDIDATES, DEFAULT_GAMES,
+          DEFAULT_MAX_PIECES);
+}
+
+static double wall_seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// splitmix64, for sampling on the main thread only
+static uint64_t search_state;
+
+static uint64_t search_next(void) {
+  uint64_t z = (search_state += 0x9e3779b97f4a7c15ull);
+  z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z          = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// standard normal, by Box-Muller
+static double search_gaussian(void) {
+  double u1 = (search_next() >> 11) * 0x1.0p-53;
+  double u2 = (search_next() >> 11) * 0x1.0p-53;
+  return sqrt(-2 * log(1 - u1)) * cos(2 * M_PI * u2);
+}
+
+static void normalize(double *w) {
+  double length = 0;
+  for (int i = 0; i < NUM_WEIGHTS; i++) {
+    length += w[i] * w[i];
+  }
+  length = sqrt(length);
+  for (int i = 0; i < NUM_WEIGHTS; i++) {
+    w[i] = length > 0 ? w[i] * WEIGHTS_NORM / length : 0;
+  }
+}
+
+static autoplay_weights to_weights(const double *w) {
+  return (autoplay_weights){lround(w[0]), lround(w[1]), lround(w[2]),
+                            lround(w[3])};
+}
+
+static void from_weights(const autoplay_weights *weights, double *w) {
+  w[0] = weights->lines;
+  w[1] = weights->height;
+  w[2] = weights->holes;
+  w[3] = weights->bumpiness;
+}
+
+static void play_job(void *ctx, uint32_t job) {
+  tune_batch *batch    = ctx;
+  uint32_t candidate   = job / batch->games;
+  uint32_t game        = job % batch->games;
+  batch->results[job] = tune_play_game(&batch->weights[candidate],
+                                       batch->seed_base + game,
+                                       batch->lookahead, batch->max_pieces);
+}
+
+/**
+ * Play every candidate through the same `games` seeded games
+ * @param fitness - set to each candidate's mean score
+ * @returns wall time taken, in seconds
+ */
+static double play_batch(tune_pool *pool, const tune_options *opts,
+                         const autoplay_weights *weights,
+                         uint32_t num_weights, uint32_t games,
+                         uint32_t seed_base, double *fitness,
+                         uint64_t *pieces) {
+  tune_batch batch = {
+      .weights    = weights,
+      .games      = games,
+      .seed_base  = seed_base,
+      .lookahead  = opts->lookahead,
+      .max_pieces = opts->max_pieces,
+      .results    = calloc(num_weights * games, sizeof(tune_game_result)),
+  };
+  if (batch.results == NULL) {
+    abort();
+  }
+
+  double start_s = wall_seconds();
+  tune_pool_run(pool, num_weights * games, play_job, &batch);
+  double taken_s = wall_seconds() - start_s;
+
+  for (uint32_t c = 0; c < num_weights; c++) {
+    double total = 0;
+    for (uint32_t g = 0; g < games; g++) {
+      total += batch.results[c * games + g].score;
+      *pieces += batch.results[c * games + g].pieces;
+    }
+    fitness[c] = total / games;
+  }
+  free(batch.results);
+  return taken_s;
+}
+
+static void report_throughput(const char *label, uint32_t games,
+                              uint64_t pieces, double taken_s, int threads) {
+  double games_per_s = games / taken_s;
+  fprintf(stderr,
+          "%s %.1f games/s, %.1f games/s/core, %.0f pieces/s/core\n", label,
+          games_per_s, games_per_s / threads, pieces / taken_s / threads);
+}
+
+/**
+ * Play the same games with 1, 2, 4, ... threads, up to `opts->threads`, and
+ * print how throughput scales
+ */
+static void measure_scaling(const tune_options *opts) {
+  uint32_t games  = opts->games * opts->threads * 4;
+  double base_gps = 0;
+  fprintf(stderr, "scaling over %u games of up to %u pieces:\n", games,
+          opts->max_pieces);
+  fprintf(stderr, "threads  games/s  games/s/core  speedup  efficiency\n");
+  for (int threads = 1;; threads = threads * 2 < opts->threads
+                                        ? threads * 2
+                                        : opts->threads) {
+    tune_pool *pool = tune_pool_create(threads);
+    double fitness;
+    uint64_t pieces = 0;
+    double taken_s  = play_batch(pool, opts, &AUTOPLAY_WEIGHTS, 1, games,
+                                 opts->seed, &fitness, &pieces);
+    tune_pool_destroy(pool);
+
+    double gps = games / taken_s;
+    if (threads == 1) {
+      base_gps = gps;
+    }
+    fprintf(stderr, "%7d  %7.1f  %12.1f  %6.2fx  %9.0f%%\n", threads, gps,
+            gps / threads, gps / base_gps, 100 * gps / base_gps / threads);
+    if (threads == opts->threads) {
+      break;
+    }
+  }
+}
+
+static void write_header(FILE *out, const tune_options *opts,
+                         const autoplay_weights *weights, double score,
+                         uint32_t holdout_games) {
+  fprintf(out,
+          "#ifndef AUTOPLAY_WEIGHTS_H\n"
+          "#define AUTOPLAY_WEIGHTS_H\n"
+          "\n"
+          "#include \"autoplay.h\"\n"
+          "\n"
+          "// generated by tune/: seed=%u generations=%u candidates=%u "
+          "games=%u\n"
+          "//  max_pieces=%u lookahead=%s, mean score %.0f over %u held out "
+          "games\n"
+          "static const autoplay_weights AUTOPLAY_WEIGHTS = {\n"
+          "    .lines     = %d,\n"
+          "    .height    = %d,\n"
+          "    .holes     = %d,\n"
+          "    .bumpiness = %d,\n"
+          "};\n"
+          "\n"
+          "#endif\n",
+          opts->seed, opts->generations, opts->candidates, opts->games,
+          opts->max_pieces,
+          opts->lookahead == AUTOPLAY_ANY_PIECE ? "any" : "none", score,
+          holdout_games, weights->lines, weights->height, weights->holes,
+          weights->bumpiness);
+}
+
+// what compare_fitness_desc() ranks candidates by; main thread only
+static const double *ranking_fitness;
+
+static int compare_fitness_desc(const void *a, const void *b) {
+  double fa = ranking_fitness[*(const uint32_t *)a];
+  double fb = ranking_fitness[*(const uint32_t *)b];
+  return (fa < fb) - (fa > fb);
+}
+
+static int tune(const tune_options *opts) {
+  tune_pool *pool     = tune_pool_create(opts->threads);
+  uint32_t num_elite  = opts->candidates * ELITE_FRACTION;
+  num_elite           = num_elite > 0 ? num_elite : 1;
+  autoplay_weights *weights = calloc(opts->candidates, sizeof(*weights));
+  double *samples     = calloc(opts->candidates * NUM_WEIGHTS, sizeof(double));
+  double *fitness     = calloc(opts->candidates, sizeof(double));
+  uint32_t *ranking   = calloc(opts->candidates, sizeof(uint32_t));
+  if (weights == NULL || samples == NULL || fitness == NULL ||
+      ranking == NULL) {
+    abort();
+  }
+
+  double mean[NUM_WEIGHTS], sigma[NUM_WEIGHTS];
+  from_weights(&AUTOPLAY_WEIGHTS, mean);
+  normalize(mean);
+  for (int i = 0; i < NUM_WEIGHTS; i++) {
+    sigma[i] = SIGMA_START;
+  }
+
+  for (uint32_t gen = 0; gen < opts->generations; gen++) {
+    // the current mean always takes part, so progress is easy to follow
+    for (uint32_t c = 0; c < opts->candidates; c++) {
+      double *w = &samples[c * NUM_WEIGHTS];
+      for (int i = 0; i < NUM_WEIGHTS; i++) {
+        w[i] = c == 0 ? mean[i] : mean[i] + sigma[i] * search_gaussian();
+      }
+      normalize(w);
+      weights[c] = to_weights(w);
+      ranking[c] = c;
+    }
+
+    // every candidate plays the same games, fresh ones each generation
+    uint64_t pieces    = 0;
+    uint32_t seed_base = opts->seed + (gen + 1) * opts->games;
+    double taken_s = play_batch(pool, opts, weights, opts->candidates,
+                                opts->games, seed_base, fitness, &pieces);
+    ranking_fitness = fitness;
+    qsort(ranking, opts->candidates, sizeof(ranking[0]), compare_fitness_desc);
+
+    // refit to the elite
+    double noise = SIGMA_NOISE * (1 - (double)gen / opts->generations);
+    for (int i = 0; i < NUM_WEIGHTS; i++) {
+      double sum = 0, sum_sq = 0;
+      for (uint32_t e = 0; e < num_elite; e++) {
+        double v = samples[ranking[e] * NUM_WEIGHTS + i];
+        sum += v;
+        sum_sq += v * v;
+      }
+      mean[i]         = sum / num_elite;
+      double variance = sum_sq / num_elite - mean[i] * mean[i];
+      sigma[i]        = sqrt(variance > 0 ? variance : 0) + noise;
+    }
+    normalize(mean);
+
+    const autoplay_weights *best = &weights[ranking[0]];
+    fprintf(stderr,
+            "gen %2u: best %8.0f (lines %d height %d holes %d bumpiness %d) "
+            "mean was %8.0f\n",
+            gen, fitness[ranking[0]], best->lines, best->height, best->holes,
+            best->bumpiness, fitness[0]);
+    char label[32];
+    snprintf(label, sizeof(label), "gen %2u:", gen);
+    report_throughput(label, opts->candidates * opts->games, pieces, taken_s,
+                      opts->threads);
+  }
+
+  // check the result against where we started, on games neither has seen
+  autoplay_weights final[2] = {AUTOPLAY_WEIGHTS, to_weights(mean)};
+  double holdout[2];
+  uint64_t pieces         = 0;
+  uint32_t holdout_games  = opts->games * HOLDOUT_FACTOR;
+  uint32_t holdout_seed   = opts->seed + (opts->generations + 1) * opts->games;
+  play_batch(pool, opts, final, 2, holdout_games, holdout_seed, holdout,
+             &pieces);
+  fprintf(stderr, "held out: current %.0f, tuned %.0f over %u games\n",
+          holdout[0], holdout[1], holdout_games);
+
+  FILE *out = opts->out != NULL ? fopen(opts->out, "w") : stdout;
+  if (out == NULL) {
+    perror(opts->out);
+    return 1;
+  }
+  write_header(out, opts, &final[1], holdout[1], holdout_games);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  tune_pool_destroy(pool);
+  free(weights);
+  free(samples);
+  free(fitness);
+  free(ranking);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  enum { OPT_SCALING = 256 };
+  static const struct option options[] = {
+      {"seed", required_argument, NULL, 's'},
+      {"threads", required_argument, NULL, 'j'},
+      {"generations", required_argument, NULL, 'g'},
+      {"candidates", required_argument, NULL, 'c'},
+      {"games", required_argument, NULL, 'n'},
+      {"max-pieces", required_argument, NULL, 'p'},
+      {"lookahead", no_argument, NULL, 'l'},
+      {"out", required_argument, NULL, 'o'},
+      {"scaling", no_argument, NULL, OPT_SCALING},
+      {NULL, 0, NULL, 0},
+  };
+  tune_options opts = {
+      .seed        = 1,
+      .threads     = sysconf(_SC_NPROCESSORS_ONLN),
+      .generations = DEFAULT_GENERATIONS,
+      .candidates  = DEFAULT_CANDIDATES,
+      .games       = DEFAULT_GAMES,
+      .max_pieces  = DEFAULT_MAX_PIECES,
+      .lookahead   = AUTOPLAY_NO_PIECE,
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:j:g:c:n:p:lo:", options, NULL)) !=
+         -1) {
+    switch (opt) {
+      case 's':
+        opts.seed = strtoul(optarg, NULL, 0);
+        break;
+      case 'j':
+        opts.threads = atoi(optarg);
+        break;
+      case 'g':
+        opts.generations = strtoul(optarg, NULL, 0);
+        break;
+      case 'c':
+        opts.candidates = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        opts.games = strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        opts.max_pieces = strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        opts.lookahead = AUTOPLAY_ANY_PIECE;
+        break;
+      case 'o':
+        opts.out = optarg;
+        break;
+      case OPT_SCALING:
+        opts.scaling = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind < argc || opts.threads < 1 || opts.candidates < 2 ||
+      opts.games < 1 || opts.generations < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // builds the piece tables before any worker thread reads them
+  autoplay_bot bot;
+  autoplay_init(&bot, &AUTOPLAY_WEIGHTS, opts.lookahead);
+  search_state = opts.seed;
+
+  if (opts.scaling) {
+    measure_scaling(&opts);
+    return 0;
+  }
+  return tune(&opts);
+}
@@ -0,0 +1,167 @@
+/**
+ * Work stealing pool, see tune_pool.h. Jobs are whole games, so a mutex per
+ * worker's range is plenty; what matters is that nobody waits for work while
+ * someone else still has a queue of it.
+ */
+
+#include "tune_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct tune_worker {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  uint32_t next;  // next job this worker will run
+  uint32_t end;   // one past its last job; thieves take from this end
+  tune_pool *pool;
+} tune_worker;
+
+struct tune_pool {
+  int num_threads;
+  tune_worker *workers;
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+  // current batch
+  tune_job_fn fn;
+  void *ctx;
+  bool quit;
+  uint32_t steals;  // over the pool's lifetime
+  pthread_mutex_t steals_lock;
+};
+
+// @returns true with the next job of `worker` in `job`, false if it has none
+static bool take_job(tune_worker *worker, uint32_t *job) {
+  pthread_mutex_lock(&worker->lock);
+  bool have_job = worker->next < worker->end;
+  if (have_job) {
+    *job = worker->next++;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return have_job;
+}
+
+/**
+ * Move the back half of the busiest other worker's jobs to `thief`
+ * @returns false if nobody has any jobs left to give
+ */
+static bool steal_jobs(tune_worker *thief) {
+  tune_pool *pool = thief->pool;
+  for (;;) {
+    tune_worker *victim = NULL;
+    uint32_t most_left  = 0;
+    for (int i = 0; i < pool->num_threads; i++) {
+      tune_worker *other = &pool->workers[i];
+      if (other == thief) {
+        continue;
+      }
+      pthread_mutex_lock(&other->lock);
+      uint32_t left = other->end - other->next;
+      pthread_mutex_unlock(&other->lock);
+      if (left > most_left) {
+        victim    = other;
+        most_left = left;
+      }
+    }
+    if (victim == NULL) {
+      return false;
+    }
+
+    pthread_mutex_lock(&victim->lock);
+    uint32_t left = victim->end - victim->next;
+    uint32_t take = left - left / 2;  // all of it if there's only one
+    uint32_t from = victim->end - take;
+    victim->end   = from;
+    pthread_mutex_unlock(&victim->lock);
+    if (take == 0) {
+      continue;  // someone else got there first; look again
+    }
+
+    pthread_mutex_lock(&thief->lock);
+    thief->next = from;
+    thief->end  = from + take;
+    pthread_mutex_unlock(&thief->lock);
+
+    pthread_mutex_lock(&pool->steals_lock);
+    pool->steals++;
+    pthread_mutex_unlock(&pool->steals_lock);
+    return true;
+  }
+}
+
+static void *worker_main(void *arg) {
+  tune_worker *worker = arg;
+  tune_pool *pool     = worker->pool;
+  for (;;) {
+    pthread_barrier_wait(&pool->start);
+    if (pool->quit) {
+      return NULL;
+    }
+    uint32_t job;
+    do {
+      while (take_job(worker, &job)) {
+        pool->fn(pool->ctx, job);
+      }
+    } while (steal_jobs(worker));
+    pthread_barrier_wait(&pool->done);
+  }
+}
+
+/**
+ * @returns pool of `num_threads` workers, waiting for tune_pool_run()
+ */
+tune_pool *tune_pool_create(int num_threads) {
+  tune_pool *pool       = calloc(1, sizeof(*pool));
+  tune_worker *workers = calloc(num_threads, sizeof(*workers));
+  if (pool == NULL || workers == NULL) {
+    abort();
+  }
+  pool->workers     = workers;
+  pool->num_threads = num_threads;
+  pthread_barrier_init(&pool->start, NULL, num_threads + 1);
+  pthread_barrier_init(&pool->done, NULL, num_threads + 1);
+  pthread_mutex_init(&pool->steals_lock, NULL);
+  for (int i = 0; i < num_threads; i++) {
+    tune_worker *worker = &pool->workers[i];
+    worker->pool        = pool;
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_create(&worker->thread, NULL, worker_main, worker);
+  }
+  return pool;
+}
+
+/**
+ * Run fn(ctx, job) for every job in [0, num_jobs), spread over the workers,
+ * and return once they've all finished
+ */
+void tune_pool_run(tune_pool *pool, uint32_t num_jobs, tune_job_fn fn,
+                   void *ctx) {
+  pool->fn  = fn;
+  pool->ctx = ctx;
+  for (int i = 0; i < pool->num_threads; i++) {
+    tune_worker *worker = &pool->workers[i];
+    pthread_mutex_lock(&worker->lock);
+    worker->next = (uint64_t)num_jobs * i / pool->num_threads;
+    worker->end  = (uint64_t)num_jobs * (i + 1) / pool->num_threads;
+    pthread_mutex_unlock(&worker->lock);
+  }
+  pthread_barrier_wait(&pool->start);
+  pthread_barrier_wait(&pool->done);
+}
+
+uint32_t tune_pool_steals(const tune_pool *pool) { return pool->steals; }
+
+void tune_pool_destroy(tune_pool *pool) {
+  pool->quit = true;
+  pthread_barrier_wait(&pool->start);
+  for (int i = 0; i < pool->num_threads; i++) {
+    pthread_join(pool->workers[i].thread, NULL);
+    pthread_mutex_destroy(&pool->workers[i].lock);
+  }
+  pthread_barrier_destroy(&pool->start);
+  pthread_barrier_destroy(&pool->done);
+  pthread_mutex_destroy(&pool->steals_lock);
+  free(pool->workers);
+  free(pool);
+}
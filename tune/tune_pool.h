@@ -0,0 +1,24 @@
+#ifndef TUNE_POOL_H
+#define TUNE_POOL_H
+
+/**
+ * Fixed set of worker threads that run batches of independent jobs. Each
+ * worker starts a batch with an even share of the job indices and works
+ * through it front to back; a worker that runs out steals the back half of
+ * whichever other worker has the most left, so uneven job lengths (games
+ * that last much longer than others) don't leave cores idle.
+ */
+
+#include <stdint.h>
+
+typedef void (*tune_job_fn)(void *ctx, uint32_t job);
+
+typedef struct tune_pool tune_pool;
+
+tune_pool *tune_pool_create(int num_threads);
+void tune_pool_run(tune_pool *pool, uint32_t num_jobs, tune_job_fn fn,
+                   void *ctx);
+uint32_t tune_pool_steals(const tune_pool *pool);
+void tune_pool_destroy(tune_pool *pool);
+
+#endif